@@ -0,0 +1,110 @@
+/* UTAad.cpp
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#include "UTAad.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Static data.
+
+const unsigned long UTAadTape::ourNoIndex = static_cast<unsigned long>(-1);
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+//UTAadTape
+
+UTAadTape& UTAadTape::tape()
+{
+	// One tape per thread, so that the calculations of several threads do not mix
+	static thread_local UTAadTape ourTape;
+	return ourTape;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTAadTape::clear()
+{
+	myNodes.clear();
+	myAdjoints.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+unsigned long UTAadTape::newNode(unsigned long argument1, double partial1, unsigned long argument2, double partial2)
+{
+	UTNode node;
+	node.arguments[0] = argument1;
+	node.arguments[1] = argument2;
+	node.partials[0] = partial1;
+	node.partials[1] = partial2;
+	myNodes.push_back(node);
+
+	return myNodes.size() - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTAadTape::computeAdjoints(unsigned long result)
+{
+	if (result >= myNodes.size())
+	{
+		throw runtime_error("UTAadTape: the result is not on the tape.");
+	}
+
+	myAdjoints.assign(myNodes.size(), 0.0);
+	myAdjoints[result] = 1.0;
+
+	// The arguments of a node are always before it
+	for (unsigned long i = result + 1; i-- > 0;)
+	{
+		const double adjoint = myAdjoints[i];
+		if (adjoint == 0.0)
+			continue;
+
+		const UTNode& node = myNodes[i];
+		if (node.arguments[0] != ourNoIndex)
+			myAdjoints[node.arguments[0]] += adjoint * node.partials[0];
+		if (node.arguments[1] != ourNoIndex)
+			myAdjoints[node.arguments[1]] += adjoint * node.partials[1];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+//UTAadNumber
+
+UTAadNumber UTAadNumber::newInput(double value)
+{
+	UTAadNumber x(value);
+	x.myIndex = UTAadTape::tape().newNode();
+	return x;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+UTAadNumber UTAadNumber::newResult(double value, const UTAadNumber& x, double dx)
+{
+	UTAadNumber result(value);
+	if (!x.isConstant())
+		result.myIndex = UTAadTape::tape().newNode(x.myIndex, dx);
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+UTAadNumber UTAadNumber::newResult(double value, const UTAadNumber& x, double dx, const UTAadNumber& y, double dy)
+{
+	// Only the arguments on the tape are recorded
+	if (x.isConstant())
+		return newResult(value, y, dy);
+	if (y.isConstant())
+		return newResult(value, x, dx);
+
+	UTAadNumber result(value);
+	result.myIndex = UTAadTape::tape().newNode(x.myIndex, dx, y.myIndex, dy);
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,150 @@
+/* UTAad.h
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#ifndef UT_AAD_H
+#define UT_AAD_H
+
+#include <cmath>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Adjoint algorithmic differentiation (AAD)
+//
+// UTAadNumber is a number which records each operation on the tape of its thread (UTAadTape::tape()),
+// with the partial derivatives of the result with respect to the arguments.
+// The reverse sweep of the tape (computeAdjoints) then gives the derivatives of one result with respect to
+// all the inputs at once, for a small multiple of the cost of the calculation.
+//
+// The constants (UTAadNumber built from a double) are not recorded.
+// The model functions which are templates of the number type (lnDf, df, logVariance...) can be called with UTAadNumber.
+//
+class UTAadTape
+{
+public:
+
+	// The index of the constants, which are not on the tape
+	static const unsigned long ourNoIndex;
+
+	// Destructor.
+	~UTAadTape() {}
+
+	// Constructor.
+	UTAadTape() {}
+
+	// The tape of the current thread
+	static UTAadTape& tape();
+
+	// Clear the tape (the memory is kept for the next calculation)
+	void clear();
+
+	// Record a node of the tape: its arguments (ourNoIndex if none) and the partial derivatives with respect to them. Return its index.
+	unsigned long newNode(unsigned long argument1 = ourNoIndex, double partial1 = 0.0, unsigned long argument2 = ourNoIndex, double partial2 = 0.0);
+
+	// The number of nodes recorded
+	unsigned long size() const { return myNodes.size(); }
+
+	// Reverse sweep from the node result (adjoint 1), back to the first node of the tape
+	void computeAdjoints(unsigned long result);
+
+	// d result / d node (after computeAdjoints)
+	double adjoint(unsigned long index) const { return index < myAdjoints.size() ? myAdjoints[index] : 0.0; }
+
+private:
+
+	struct UTNode
+	{
+		unsigned long arguments[2];
+		double partials[2];
+	};
+
+	std::vector<UTNode> myNodes;
+	std::vector<double> myAdjoints;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+class UTAadNumber
+{
+public:
+
+	// Constructor: a constant
+	UTAadNumber(double value = 0.0) : myValue(value), myIndex(UTAadTape::ourNoIndex) {}
+
+	// An input of the calculation: a new leaf of the tape
+	static UTAadNumber newInput(double value);
+
+	// The result of an operation: its value, and its partial derivatives with respect to its argument(s)
+	static UTAadNumber newResult(double value, const UTAadNumber& x, double dx);
+	static UTAadNumber newResult(double value, const UTAadNumber& x, double dx, const UTAadNumber& y, double dy);
+
+	// Accessors
+	double value() const { return myValue; }
+	unsigned long index() const { return myIndex; }
+	bool isConstant() const { return myIndex == UTAadTape::ourNoIndex; }
+
+	// d result / d this number, after UTAadTape::tape().computeAdjoints(result.index())
+	double adjoint() const { return isConstant() ? 0.0 : UTAadTape::tape().adjoint(myIndex); }
+
+	// Assignment operators
+	UTAadNumber& operator+=(const UTAadNumber& x);
+	UTAadNumber& operator-=(const UTAadNumber& x);
+	UTAadNumber& operator*=(const UTAadNumber& x);
+	UTAadNumber& operator/=(const UTAadNumber& x);
+
+private:
+
+	double myValue;
+	unsigned long myIndex;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+//
+// inline functions
+
+inline UTAadNumber operator+(const UTAadNumber& x, const UTAadNumber& y) { return UTAadNumber::newResult(x.value() + y.value(), x, 1.0, y, 1.0); }
+inline UTAadNumber operator-(const UTAadNumber& x, const UTAadNumber& y) { return UTAadNumber::newResult(x.value() - y.value(), x, 1.0, y, -1.0); }
+inline UTAadNumber operator*(const UTAadNumber& x, const UTAadNumber& y) { return UTAadNumber::newResult(x.value() * y.value(), x, y.value(), y, x.value()); }
+inline UTAadNumber operator/(const UTAadNumber& x, const UTAadNumber& y) { return UTAadNumber::newResult(x.value() / y.value(), x, 1.0 / y.value(), y, -x.value() / (y.value() * y.value())); }
+inline UTAadNumber operator-(const UTAadNumber& x) { return UTAadNumber::newResult(-x.value(), x, -1.0); }
+inline UTAadNumber operator+(const UTAadNumber& x) { return x; }
+
+inline UTAadNumber operator+(const UTAadNumber& x, double y) { return UTAadNumber::newResult(x.value() + y, x, 1.0); }
+inline UTAadNumber operator+(double x, const UTAadNumber& y) { return UTAadNumber::newResult(x + y.value(), y, 1.0); }
+inline UTAadNumber operator-(const UTAadNumber& x, double y) { return UTAadNumber::newResult(x.value() - y, x, 1.0); }
+inline UTAadNumber operator-(double x, const UTAadNumber& y) { return UTAadNumber::newResult(x - y.value(), y, -1.0); }
+inline UTAadNumber operator*(const UTAadNumber& x, double y) { return UTAadNumber::newResult(x.value() * y, x, y); }
+inline UTAadNumber operator*(double x, const UTAadNumber& y) { return UTAadNumber::newResult(x * y.value(), y, x); }
+inline UTAadNumber operator/(const UTAadNumber& x, double y) { return UTAadNumber::newResult(x.value() / y, x, 1.0 / y); }
+inline UTAadNumber operator/(double x, const UTAadNumber& y) { return UTAadNumber::newResult(x / y.value(), y, -x / (y.value() * y.value())); }
+
+inline UTAadNumber& UTAadNumber::operator+=(const UTAadNumber& x) { return *this = *this + x; }
+inline UTAadNumber& UTAadNumber::operator-=(const UTAadNumber& x) { return *this = *this - x; }
+inline UTAadNumber& UTAadNumber::operator*=(const UTAadNumber& x) { return *this = *this * x; }
+inline UTAadNumber& UTAadNumber::operator/=(const UTAadNumber& x) { return *this = *this / x; }
+
+// The comparisons are on the values (the branches are not differentiated)
+inline bool operator<(const UTAadNumber& x, const UTAadNumber& y) { return x.value() < y.value(); }
+inline bool operator>(const UTAadNumber& x, const UTAadNumber& y) { return x.value() > y.value(); }
+inline bool operator<=(const UTAadNumber& x, const UTAadNumber& y) { return x.value() <= y.value(); }
+inline bool operator>=(const UTAadNumber& x, const UTAadNumber& y) { return x.value() >= y.value(); }
+inline bool operator==(const UTAadNumber& x, const UTAadNumber& y) { return x.value() == y.value(); }
+inline bool operator!=(const UTAadNumber& x, const UTAadNumber& y) { return x.value() != y.value(); }
+
+// The maths functions (found by argument dependent lookup next to the ones of <cmath> in the templates)
+inline UTAadNumber exp(const UTAadNumber& x) { double value = std::exp(x.value()); return UTAadNumber::newResult(value, x, value); }
+inline UTAadNumber log(const UTAadNumber& x) { return UTAadNumber::newResult(std::log(x.value()), x, 1.0 / x.value()); }
+inline UTAadNumber sqrt(const UTAadNumber& x) { double value = std::sqrt(x.value()); return UTAadNumber::newResult(value, x, 0.5 / value); }
+inline UTAadNumber pow(const UTAadNumber& x, double y) { double value = std::pow(x.value(), y); return UTAadNumber::newResult(value, x, y * value / x.value()); }
+inline UTAadNumber fabs(const UTAadNumber& x) { return x.value() < 0.0 ? -x : x; }
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // UT_AAD_H
@@ -0,0 +1,151 @@
+/* UTBrownianBridge.cpp
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#include <cmath>
+#include <stdexcept>
+
+#include "UTBrownianBridge.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Constructor: calculate the construction order and all the weights
+UTBrownianBridge::UTBrownianBridge(const vector<double>& times)
+{
+	unsigned long numberOfTimes = times.size();
+	if (numberOfTimes == 0)
+	{
+		throw runtime_error("UTBrownianBridge: the time line is empty.");
+	}
+
+	for (unsigned long i = 0; i < numberOfTimes; ++i)
+	{
+		if (times[i] < 0.0 || (i > 0 && times[i] < times[i - 1]))
+		{
+			throw runtime_error("UTBrownianBridge: the times should be non negative and non decreasing.");
+		}
+	}
+
+	myBridgeIndex.resize(numberOfTimes);
+	myLeftIndex.resize(numberOfTimes);
+	myRightIndex.resize(numberOfTimes);
+	myLeftWeight.resize(numberOfTimes);
+	myRightWeight.resize(numberOfTimes);
+	myStdDev.resize(numberOfTimes);
+
+	// map[i] is non zero once W at the time of index i is known
+	vector<unsigned long> map(numberOfTimes, 0);
+
+	// The first variate: the last time, from W = 0 at time 0
+	map[numberOfTimes - 1] = 1;
+	myBridgeIndex[0] = numberOfTimes - 1;
+	myLeftIndex[0] = 0;
+	myRightIndex[0] = 0;
+	myLeftWeight[0] = 0.0;
+	myRightWeight[0] = 0.0;
+	myStdDev[0] = sqrt(times[numberOfTimes - 1]);
+
+	// The others: the middle of each unknown interval, interval after interval
+	unsigned long j = 0;
+	for (unsigned long i = 1; i < numberOfTimes; ++i)
+	{
+		// The first unknown time
+		while (map[j])
+			++j;
+
+		// The next known time
+		unsigned long k = j;
+		while (!map[k])
+			++k;
+
+		// The middle
+		unsigned long l = j + ((k - 1 - j) >> 1);
+		map[l] = i;
+
+		myBridgeIndex[i] = l;
+		myLeftIndex[i] = j;
+		myRightIndex[i] = k;
+
+		double leftTime = j > 0 ? times[j - 1] : 0.0;
+		double length = times[k] - leftTime;
+
+		if (length > 0.0)
+		{
+			myLeftWeight[i] = (times[k] - times[l]) / length;
+			myRightWeight[i] = (times[l] - leftTime) / length;
+			myStdDev[i] = sqrt((times[l] - leftTime) * (times[k] - times[l]) / length);
+		}
+		else
+		{
+			// No variance in the interval: W is the left value
+			myLeftWeight[i] = 1.0;
+			myRightWeight[i] = 0.0;
+			myStdDev[i] = 0.0;
+		}
+
+		j = k + 1;
+		if (j >= numberOfTimes)
+			j = 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTBrownianBridge::buildPath(const vector<double>& variates, vector<double>& path) const
+{
+	unsigned long numberOfTimes = size();
+
+	path[numberOfTimes - 1] = myStdDev[0] * variates[0];
+
+	for (unsigned long i = 1; i < numberOfTimes; ++i)
+	{
+		unsigned long j = myLeftIndex[i];
+		unsigned long k = myRightIndex[i];
+		unsigned long l = myBridgeIndex[i];
+
+		double left = j > 0 ? myLeftWeight[i] * path[j - 1] : 0.0;
+		path[l] = left + myRightWeight[i] * path[k] + myStdDev[i] * variates[i];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTBrownianBridge::buildPathBlock(vector<double>& path, unsigned long numberOfPaths, unsigned long stride) const
+{
+	unsigned long numberOfTimes = size();
+
+	// Each step of the bridge is a loop across the paths, which can be vectorized.
+	// A row is overwritten by the step which defines it, after which it is only read.
+	double * w = &path[(numberOfTimes - 1) * stride];
+	const double stdDev0 = myStdDev[0];
+	for (unsigned long p = 0; p < numberOfPaths; ++p)
+		w[p] = stdDev0 * w[p];
+
+	for (unsigned long i = 1; i < numberOfTimes; ++i)
+	{
+		unsigned long j = myLeftIndex[i];
+		const double rightWeight = myRightWeight[i];
+		const double stdDev = myStdDev[i];
+
+		w = &path[myBridgeIndex[i] * stride];
+		const double * right = &path[myRightIndex[i] * stride];
+
+		if (j > 0)
+		{
+			const double leftWeight = myLeftWeight[i];
+			const double * left = &path[(j - 1) * stride];
+			for (unsigned long p = 0; p < numberOfPaths; ++p)
+				w[p] = leftWeight * left[p] + rightWeight * right[p] + stdDev * w[p];
+		}
+		else
+		{
+			for (unsigned long p = 0; p < numberOfPaths; ++p)
+				w[p] = rightWeight * right[p] + stdDev * w[p];
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,58 @@
+/* UTBrownianBridge.h
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#ifndef UT_BROWNIAN_BRIDGE_H
+#define UT_BROWNIAN_BRIDGE_H
+
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Brownian bridge construction of a Brownian motion W observed at the given (non decreasing) times.
+//
+// The first variate defines W at the last time, the second one W at the middle time, and so on by bisection,
+// so that the first variates (the best distributed ones of a low discrepancy sequence) carry most of the variance of the path.
+// All the weights are precomputed by the constructor: building a path does not allocate.
+class UTBrownianBridge
+{
+public:
+
+	// Destructor.
+	~UTBrownianBridge() {}
+
+	// Constructors.
+	UTBrownianBridge() {}
+	UTBrownianBridge(const std::vector<double>& times);
+
+	// Accessors
+	unsigned long size() const { return myBridgeIndex.size(); }
+
+	// The index of the time defined by the i-th variate
+	unsigned long bridgeIndex(unsigned long i) const { return myBridgeIndex[i]; }
+
+	// Calculate W at the times from the standard normal variates
+	void buildPath(const std::vector<double>& variates, std::vector<double>& path) const;
+
+	// Same IN SITU for a block of paths stored as structure of arrays: path[timeIndex * stride + pathIndex].
+	// On input the row bridgeIndex(i) holds the i-th variates of the paths, on output each row holds W at its time.
+	void buildPathBlock(std::vector<double>& path, unsigned long numberOfPaths, unsigned long stride) const;
+
+private:
+
+	// The i-th variate gives W at the time of index myBridgeIndex[i],
+	// from W at myLeftIndex[i] - 1 (or W = 0 at time 0 if myLeftIndex[i] == 0) and W at myRightIndex[i]
+	std::vector<unsigned long> myBridgeIndex;
+	std::vector<unsigned long> myLeftIndex;
+	std::vector<unsigned long> myRightIndex;
+	std::vector<double> myLeftWeight;
+	std::vector<double> myRightWeight;
+	std::vector<double> myStdDev;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // UT_BROWNIAN_BRIDGE_H
@@ -50,6 +50,30 @@ enum class UT_AverageType
 	UT_GEOMETRIC = -1,
 };
 
+///////////////////////////////////////////////////////////////////////////////
+enum class UT_ErrorType
+{
+	UT_INVALID_ERROR_TYPE = 0,
+	UT_ABSOLUTE = 1,
+	UT_RELATIVE = 2,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum class UT_PathConstruction
+{
+	UT_INVALID_PATH_CONSTRUCTION = 0,
+	UT_INCREMENTAL = 1,      // the i-th variate drives the i-th time step
+	UT_BROWNIAN_BRIDGE = 2,  // the first variate drives the last time, the next ones the bisections
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum class UT_GreekMethod
+{
+	UT_INVALID_GREEK_METHOD = 0,
+	UT_PATHWISE = 1,          // derivative of the payoff along the path (continuous payoffs)
+	UT_LIKELIHOOD_RATIO = 2,  // payoff times the derivative of the log density of the path (any payoff)
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 
 //Helper functions
@@ -243,8 +243,8 @@ UTEuropeanOptionBase::impliedSigma(double targetPremium, UT_CallPut callPut)
 
 	UTSolveForImpliedVolatility impVol(*this, callPut, targetPremium);
 
-	// The first value for the guess: the value of sigma stored in this class
-	double rtn = impVol.root(mySigma, dAbsoluteAccuracy, uMaximumNumberOfIterations);
+	// The first guess: from the solver of the pricer (the sigma stored in this class if none), polished by Newton on premium()
+	double rtn = impVol.root(impliedSigmaGuess(targetPremium, callPut), dAbsoluteAccuracy, uMaximumNumberOfIterations);
 
 	// Overwrites the current sigma value by the new one.
 	overwriteSigma(rtn);
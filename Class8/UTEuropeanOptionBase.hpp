@@ -103,6 +103,9 @@ public:
 
 protected:
 
+	// The first guess of impliedSigma: the sigma stored in this class, unless the pricer has an implied vol solver of its own
+	virtual double impliedSigmaGuess(double, UT_CallPut) const { return mySigma; }
+
 	static const double ourInfiniteDistance;
 	static const double ourEpsilon;
 
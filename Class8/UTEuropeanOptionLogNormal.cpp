@@ -6,12 +6,152 @@
 
 #include <float.h>
 #include <iostream>
+#include <limits>
 
 #include "UTMathFunctions.hpp"
 #include "UTEuropeanOptionLogNormal.hpp"
+#include "UTNewton.hpp"
 
 using namespace std;
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Helper functions of the first guess of the implied stdDev (Jaeckel, "Let's be rational", 2015)
+
+namespace
+{
+	// The branches of the normalised time value in the stdDev, for the objective of the Householder steps
+	enum UT_ImpliedBranch
+	{
+		UT_LOWER_BRANCH,
+		UT_MIDDLE_BRANCH,
+		UT_UPPER_BRANCH
+	};
+
+	const double ourMinimumControlParameter = -(1.0 - 1.4901161193847656e-08);  // -(1 - sqrt(DBL_EPSILON))
+	const double ourMaximumControlParameter = 2.0 / (DBL_EPSILON * DBL_EPSILON);
+
+	// The rational cubic of Delbourgo and Gregory through (xL, yL) and (xR, yR) with the slopes dL and dR there: the cubic Hermite for r = 3,
+	// linear for an infinite r
+	double rationalCubicInterpolation(double x, double xL, double xR, double yL, double yR, double dL, double dR, double r)
+	{
+		const double h = xR - xL;
+		if (fabs(h) <= 0.0)
+		{
+			return 0.5 * (yL + yR);
+		}
+
+		const double t = (x - xL) / h;
+		if (!(r < ourMaximumControlParameter))
+		{
+			return yR * t + yL * (1.0 - t);
+		}
+
+		const double u = 1.0 - t;
+		return (yR * t * t * t + (r * yR - h * dR) * t * t * u + (r * yL + h * dL) * t * u * u + yL * u * u * u) / (1.0 + (r - 3.0) * t * u);
+	}
+
+	// The smallest control parameter for which the rational cubic is as monotonic and convex (or concave) as its data
+	double minimumControlParameter(double dL, double dR, double slope, bool preferShapePreservation)
+	{
+		const bool monotonic = dL * slope >= 0.0 && dR * slope >= 0.0;
+		const bool convex = dL <= slope && slope <= dR;
+		const bool concave = dL >= slope && slope >= dR;
+		if (!monotonic && !convex && !concave)
+		{
+			return ourMinimumControlParameter;
+		}
+
+		double r1 = -DBL_MAX;
+		double r2 = -DBL_MAX;
+		if (monotonic)
+		{
+			if (slope != 0.0)
+				r1 = (dR + dL) / slope;
+			else if (preferShapePreservation)
+				r1 = ourMaximumControlParameter;
+		}
+		if (convex || concave)
+		{
+			if (slope - dL != 0.0 && dR - slope != 0.0)
+				r2 = max(fabs((dR - dL) / (dR - slope)), fabs((dR - dL) / (slope - dL)));
+			else if (preferShapePreservation)
+				r2 = ourMaximumControlParameter;
+		}
+		else if (monotonic && preferShapePreservation)
+		{
+			r2 = ourMaximumControlParameter;
+		}
+
+		return max(ourMinimumControlParameter, max(r1, r2));
+	}
+
+	// The control parameter for which the second derivative of the rational cubic at the left (right) end is the given one,
+	// raised to the minimum above
+	double convexRationalCubicControlParameterLeft(double xL, double xR, double yL, double yR, double dL, double dR, double secondDerivativeL,
+		bool preferShapePreservation)
+	{
+		const double h = xR - xL;
+		const double numerator = 0.5 * h * secondDerivativeL + (dR - dL);
+		const double denominator = (yR - yL) / h - dL;
+		double r = numerator == 0.0 ? 0.0 : (denominator == 0.0 ? (numerator > 0.0 ? ourMaximumControlParameter : ourMinimumControlParameter) : numerator / denominator);
+
+		return min(ourMaximumControlParameter, max(r, minimumControlParameter(dL, dR, (yR - yL) / h, preferShapePreservation)));
+	}
+
+	double convexRationalCubicControlParameterRight(double xL, double xR, double yL, double yR, double dL, double dR, double secondDerivativeR,
+		bool preferShapePreservation)
+	{
+		const double h = xR - xL;
+		const double numerator = 0.5 * h * secondDerivativeR + (dR - dL);
+		const double denominator = dR - (yR - yL) / h;
+		double r = numerator == 0.0 ? 0.0 : (denominator == 0.0 ? (numerator > 0.0 ? ourMaximumControlParameter : ourMinimumControlParameter) : numerator / denominator);
+
+		return min(ourMaximumControlParameter, max(r, minimumControlParameter(dL, dR, (yR - yL) / h, preferShapePreservation)));
+	}
+
+	// The lower map fLower(s) = 2 pi |x| / sqrt(27) N(-z)^3, z = |x| / sqrt(3) s, and its first two derivatives in beta at the stdDev s
+	void lowerMap(double x, double s, double& f, double& f1, double& f2)
+	{
+		const double TWO_PI = 6.283185307179586;
+		const double TWO_PI_OVER_SQRT_27 = 1.2091995761561452;
+		const double PI_OVER_SIX = 0.5235987755982988;
+		const double SQRT_THREE = 1.7320508075688772;
+
+		const double ax = fabs(x);
+		const double z = ax / (SQRT_THREE * s);
+		const double y = z * z;
+		const double s2 = s * s;
+		const double cumulative = UTMathFunctions::accurateCumulativeNormal(-z);
+		const double density = 0.3989422804014327 * exp(-0.5 * y);
+
+		f2 = PI_OVER_SIX * y / (s2 * s) * cumulative * (8.0 * SQRT_THREE * s * ax + (3.0 * s2 * (s2 - 8.0) - 8.0 * x * x) * cumulative / density)
+			* exp(2.0 * y + 0.25 * s2);
+		f1 = TWO_PI * y * cumulative * cumulative * exp(y + 0.125 * s2);
+		f = TWO_PI_OVER_SQRT_27 * ax * cumulative * cumulative * cumulative;
+	}
+
+	// Its inverse: the stdDev of fLower
+	double inverseLowerMap(double x, double f)
+	{
+		const double TWO_PI_OVER_SQRT_27 = 1.2091995761561452;
+		const double SQRT_THREE = 1.7320508075688772;
+
+		return fabs(x / (SQRT_THREE * UTMathFunctions::inverseCumulativeNormal(pow(f / (TWO_PI_OVER_SQRT_27 * fabs(x)), 1.0 / 3.0))));
+	}
+
+	// The upper map fUpper(s) = N(-s/2), and its first two derivatives in beta at the stdDev s
+	void upperMap(double x, double s, double& f, double& f1, double& f2)
+	{
+		const double SQRT_PI_OVER_TWO = 1.2533141373155003;
+
+		f = UTMathFunctions::accurateCumulativeNormal(-0.5 * s);
+		const double w = (x / s) * (x / s);
+		f1 = -0.5 * exp(0.5 * w);
+		f2 = SQRT_PI_OVER_TWO * exp(w + 0.125 * s * s) * w / s;
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 // Destructor
@@ -47,6 +187,18 @@ UTEuropeanOptionLogNormal::UTEuropeanOptionLogNormal(
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Constructor with the sigma of the strike on the vol surface (sticky strike)
+UTEuropeanOptionLogNormal::UTEuropeanOptionLogNormal(
+	const UTVolSurface& volSurface,
+	double dForward,
+	double dStrike,
+	double dTimeToExpiry)
+	: UTEuropeanOptionLogNormal(dForward, dStrike, dTimeToExpiry, volSurface.vol(dStrike, dTimeToExpiry))
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 // Overwrites the sigma in the Option Pricer -- updates all that has to be updated (called by the solvers)
 void
 UTEuropeanOptionLogNormal::overwriteSigma(double newSigma)
@@ -269,4 +421,358 @@ UTEuropeanOptionLogNormal::theta(UT_CallPut callPut) const
 	return thetaRtn;
 }
 ///////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+// The implied sigma of a premium, without pricer object
+double
+UTEuropeanOptionLogNormal::blackImpliedSigma(double premium, double forward, double strike, double timeToExpiry, UT_CallPut callPut, unsigned long* iterations)
+{
+	if (forward <= 0.0 || strike <= 0.0 || timeToExpiry <= 0.0)
+	{
+		throw runtime_error("UTEuropeanOptionLogNormal::blackImpliedSigma: the forward, the strike and the time to expiry should be positive.");
+	}
+	if (callPut != UT_CallPut::UT_CALL && callPut != UT_CallPut::UT_PUT && callPut != UT_CallPut::UT_STRADDLE)
+	{
+		throw runtime_error("UTEuropeanOptionLogNormal::blackImpliedSigma: Unknown cal/put type.");
+	}
+
+	unsigned long numberOfIterations;
+	double rtn;
+	if (!impliedSigmaNoCheck(premium, forward, strike, timeToExpiry, callPut, rtn, numberOfIterations))
+	{
+		throw runtime_error("UTEuropeanOptionLogNormal::blackImpliedSigma: the premium should be between the intrinsic value and the premium for an infinite sigma.");
+	}
+
+	if (iterations)
+		*iterations = numberOfIterations;
+
+	return rtn;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Batch implied sigmas: a loop on the solver, without object or allocation
+void
+UTEuropeanOptionLogNormal::blackImpliedSigmaBatch(
+	const double* premiums,
+	const double* forwards,
+	const double* strikes,
+	const double* timesToExpiry,
+	const UT_CallPut* callPuts,
+	unsigned long n,
+	double* sigmas,
+	bool* valid)
+{
+	unsigned long iterations;
+	for (unsigned long i = 0; i < n; ++i)
+	{
+		valid[i] = forwards[i] > 0.0 && strikes[i] > 0.0 && timesToExpiry[i] > 0.0
+			&& (callPuts[i] == UT_CallPut::UT_CALL || callPuts[i] == UT_CallPut::UT_PUT || callPuts[i] == UT_CallPut::UT_STRADDLE)
+			&& impliedSigmaNoCheck(premiums[i], forwards[i], strikes[i], timesToExpiry[i], callPuts[i], sigmas[i], iterations);
+
+		if (!valid[i])
+			sigmas[i] = numeric_limits<double>::quiet_NaN();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The first guess of impliedSigma
+double
+UTEuropeanOptionLogNormal::impliedSigmaGuess(double targetPremium, UT_CallPut callPut) const
+{
+	if (timeToExpiry() <= 0.0)
+	{
+		return sigma();
+	}
+
+	unsigned long iterations;
+	double rtn;
+
+	return impliedSigmaNoCheck(targetPremium, forward(), strike(), timeToExpiry(), callPut, rtn, iterations) ? rtn : sigma();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The implied sigma: from the time value of the out of the money call, which is the same for the call and the put (call-put parity)
+bool
+UTEuropeanOptionLogNormal::impliedSigmaNoCheck(double premium, double forward, double strike, double timeToExpiry, UT_CallPut callPut, double& sigma, unsigned long& iterations)
+{
+	double timeValue;
+	if (callPut == UT_CallPut::UT_CALL)
+		timeValue = premium - UTMathFunctions::max(forward - strike, 0.0);
+	else if (callPut == UT_CallPut::UT_PUT)
+		timeValue = premium - UTMathFunctions::max(strike - forward, 0.0);
+	else
+		timeValue = 0.5 * (premium - fabs(forward - strike));  // A straddle is a call plus a put
+
+	// Between no time value and the limit for an infinite stdDev
+	double beta = timeValue / sqrt(forward * strike);
+	double x = -fabs(log(forward / strike));
+	iterations = 0;
+	if (!(beta >= 0.0 && beta < exp(0.5 * x)))
+	{
+		return false;
+	}
+
+	sigma = normalisedImpliedStdDev(beta, x, iterations) / sqrt(timeToExpiry);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The normalised time value of an out of the money call: exp(x/2) N(x/s + s/2) - exp(-x/2) N(x/s - s/2), x <= 0
+double
+UTEuropeanOptionLogNormal::normalisedTimeValue(double x, double stdDev)
+{
+	// At the money: N(s/2) - N(-s/2), without its cancellation for the small s
+	if (x == 0.0)
+	{
+		return erf(0.3535533905932738 * stdDev);
+	}
+
+	return exp(0.5 * x) * UTMathFunctions::accurateCumulativeNormal(x / stdDev + 0.5 * stdDev)
+		- exp(-0.5 * x) * UTMathFunctions::accurateCumulativeNormal(x / stdDev - 0.5 * stdDev);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Its derivative in the stdDev: exp(x/2) n(x/s + s/2)
+double
+UTEuropeanOptionLogNormal::normalisedVega(double x, double stdDev)
+{
+	const double ONE_OVER_SQRT_TWO_PI = 0.398942280401433;
+	double d1 = x / stdDev + 0.5 * stdDev;
+
+	return ONE_OVER_SQRT_TWO_PI * exp(0.5 * (x - d1 * d1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The stdDev of a normalised time value
+double
+UTEuropeanOptionLogNormal::normalisedImpliedStdDev(double beta, double x, unsigned long& iterations)
+{
+	const unsigned long maximumNumberOfIterations = 2;
+
+	iterations = 0;
+
+	const double betaMax = exp(0.5 * x);
+	if (beta == 0.0)
+	{
+		return 0.0;
+	}
+
+	// The inflection point of the time value in the stdDev, and the points where its tangent there is 0 and betaMax
+	const double stdDevC = sqrt(-2.0 * x);
+	const double betaC = normalisedTimeValue(x, stdDevC);
+	const double vegaC = normalisedVega(x, stdDevC);
+
+	// The first guess on four branches (Jaeckel), each a rational cubic interpolation between points where the time value and its
+	// derivatives are known, of the stdDev itself in the middle, or of a map of beta whose inverse in the stdDev is explicit outside:
+	// - lower: fLower(s) = 2 pi |x| / sqrt(27) N(-|x| / sqrt(3) s)^3, the asymptotic of beta for s -> 0, from beta = 0;
+	// - upper: fUpper(s) = N(-s/2), the asymptotic of betaMax - beta for s -> infinity (exact at the money), up to betaMax.
+	// The objective of the Householder steps depends on the branch too: 1 / log(beta) on the lower one, log(betaMax - beta) on the upper one
+	// (when beta is close enough to betaMax), beta in the middle. All of them are close to linear in the stdDev, so two steps are enough.
+	UT_ImpliedBranch branch = UT_MIDDLE_BRANCH;
+	double stdDev;
+	double stdDevLow = 0.0;
+	double stdDevHigh = DBL_MAX;
+	if (beta < betaC)
+	{
+		const double stdDevL = stdDevC - betaC / vegaC;
+		const double betaL = normalisedTimeValue(x, stdDevL);
+		if (beta < betaL)
+		{
+			double fL, fL1, fL2;
+			lowerMap(x, stdDevL, fL, fL1, fL2);
+			double r = convexRationalCubicControlParameterRight(0.0, betaL, 0.0, fL, 1.0, fL1, fL2, true);
+			double f = rationalCubicInterpolation(beta, 0.0, betaL, 0.0, fL, 1.0, fL1, r);
+			if (!(f > 0.0))
+			{
+				// The quadratic from f(0) = 0, f'(0) = 1 and f(betaL)
+				double t = beta / betaL;
+				f = (fL * t + betaL * (1.0 - t)) * t;
+			}
+
+			stdDev = inverseLowerMap(x, f);
+			stdDevHigh = stdDevL;
+			branch = UT_LOWER_BRANCH;
+		}
+		else
+		{
+			const double vegaL = normalisedVega(x, stdDevL);
+			double r = convexRationalCubicControlParameterRight(betaL, betaC, stdDevL, stdDevC, 1.0 / vegaL, 1.0 / vegaC, 0.0, false);
+			stdDev = rationalCubicInterpolation(beta, betaL, betaC, stdDevL, stdDevC, 1.0 / vegaL, 1.0 / vegaC, r);
+			stdDevLow = stdDevL;
+			stdDevHigh = stdDevC;
+		}
+	}
+	else
+	{
+		const double stdDevU = vegaC > DBL_MIN ? stdDevC + (betaMax - betaC) / vegaC : stdDevC;
+		const double betaU = normalisedTimeValue(x, stdDevU);
+		if (beta <= betaU)
+		{
+			const double vegaU = normalisedVega(x, stdDevU);
+			double r = convexRationalCubicControlParameterLeft(betaC, betaU, stdDevC, stdDevU, 1.0 / vegaC, 1.0 / vegaU, 0.0, false);
+			stdDev = rationalCubicInterpolation(beta, betaC, betaU, stdDevC, stdDevU, 1.0 / vegaC, 1.0 / vegaU, r);
+			stdDevLow = stdDevC;
+			stdDevHigh = stdDevU;
+		}
+		else
+		{
+			double fU, fU1, fU2;
+			upperMap(x, stdDevU, fU, fU1, fU2);
+			double f = 0.0;
+			if (fabs(fU2) < 1.0e150)
+			{
+				double r = convexRationalCubicControlParameterLeft(betaU, betaMax, fU, 0.0, fU1, -0.5, fU2, true);
+				f = rationalCubicInterpolation(beta, betaU, betaMax, fU, 0.0, fU1, -0.5, r);
+			}
+			if (!(f > 0.0))
+			{
+				// The quadratic from f(betaU), f(betaMax) = 0 and f'(betaMax) = -1/2
+				double h = betaMax - betaU;
+				double t = (beta - betaU) / h;
+				f = (fU * (1.0 - t) + 0.5 * h * t) * (1.0 - t);
+			}
+
+			stdDev = -2.0 * UTMathFunctions::inverseCumulativeNormal(f);
+			stdDevLow = stdDevU;
+			if (beta > 0.5 * betaMax)
+				branch = UT_UPPER_BRANCH;
+		}
+	}
+
+	// Householder steps, inside the bracket of the root: the time value increases with the stdDev
+	const double logBeta = log(beta);
+	while (iterations < maximumNumberOfIterations)
+	{
+		double value = normalisedTimeValue(x, stdDev);
+		double vega = normalisedVega(x, stdDev);
+		double a = x * x / (stdDev * stdDev * stdDev) - 0.25 * stdDev;
+		double volga = vega * a;
+		double thirdDerivative = vega * (a * a - 3.0 * x * x / (stdDev * stdDev * stdDev * stdDev) - 0.25);
+
+		if (value < beta)
+			stdDevLow = stdDev;
+		else
+			stdDevHigh = stdDev;
+
+		double step;
+		if (branch == UT_LOWER_BRANCH && value > 0.0)
+			step = householderStepInverseLog(value, vega, volga, thirdDerivative, logBeta);
+		else if (branch == UT_UPPER_BRANCH && value < betaMax)
+			step = householderStepLogDistance(value, vega, volga, thirdDerivative, betaMax, beta);
+		else
+			step = householderStep(value - beta, vega, volga, thirdDerivative);
+		++iterations;
+
+		// Third order on an objective which is close to linear: after a step of less than 1e-4 (relative), the error is at the rounding
+		if (fabs(step) < 1.0e-4 * stdDev || value == beta)
+		{
+			return stdDev + step;
+		}
+
+		double newStdDev = stdDev + step;
+		if (!(newStdDev > stdDevLow && newStdDev < stdDevHigh))
+		{
+			newStdDev = stdDevHigh < DBL_MAX ? 0.5 * (stdDevLow + stdDevHigh) : 2.0 * stdDev;
+		}
+		stdDev = newStdDev;
+	}
+
+	return stdDev;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Batch pricer: the options are priced by chunks, whose intermediate results are on the stack
+void
+UTEuropeanOptionLogNormal::blackBatch(
+	const double* __restrict forwards,
+	const double* __restrict strikes,
+	const double* __restrict timesToExpiry,
+	const double* __restrict sigmas,
+	const UT_CallPut* __restrict callPuts,
+	unsigned long n,
+	double* __restrict premiums,
+	double* __restrict deltas,
+	double* __restrict gammas,
+	double* __restrict vegas,
+	double* __restrict thetas)
+{
+	// Check the option types once, out of the loops (no short circuit, which would be a branch)
+	bool known = true;
+	for (unsigned long i = 0; i < n; ++i)
+		known &= (callPuts[i] == UT_CallPut::UT_CALL) | (callPuts[i] == UT_CallPut::UT_PUT) | (callPuts[i] == UT_CallPut::UT_STRADDLE);
+
+	if (!known)
+	{
+		throw runtime_error("UTEuropeanOptionLogNormal::blackBatch: Unknown cal/put type.");
+	}
+
+	const double ONE_OVER_SQRT_TWO_PI = 0.398942280401433;
+	const unsigned long chunkSize = 256;
+	double d1[chunkSize];
+	double d2[chunkSize];
+	double stdDevs[chunkSize];
+	double sqrtTimes[chunkSize];
+	double cumNormD1[chunkSize];
+	double cumNormD2[chunkSize];
+	double gaussD1[chunkSize];
+	double gaussD2[chunkSize];
+
+	for (unsigned long start = 0; start < n; start += chunkSize)
+	{
+		const unsigned long size = n - start < chunkSize ? n - start : chunkSize;
+		const double* forward = forwards + start;
+		const double* strike = strikes + start;
+		const double* timeToExpiry = timesToExpiry + start;
+		const double* sigma = sigmas + start;
+		const UT_CallPut* callPut = callPuts + start;
+
+		// The distances: with a stdDev of 1 and a strike of 1 when the option has no vol or no strike, so that they are always defined.
+		// The density at d2 is the one at d1 times F / K.
+		for (unsigned long j = 0; j < size; ++j)
+		{
+			double sqrtTime = sqrt(UTMathFunctions::select(timeToExpiry[j] > 0.0, timeToExpiry[j], 0.0));
+			double stdDev = sigma[j] * sqrtTime;
+			bool degenerate = (stdDev < ourEpsilon) | (strike[j] <= 0.0);  // no short circuit, which would be a branch
+			double safeStdDev = UTMathFunctions::select(degenerate, 1.0, stdDev);
+			double safeStrike = UTMathFunctions::select(degenerate, 1.0, strike[j]);
+
+			d1[j] = UTMathFunctions::polynomialLog(forward[j] / safeStrike) / safeStdDev + 0.5 * safeStdDev;
+			d2[j] = d1[j] - safeStdDev;
+			gaussD1[j] = ONE_OVER_SQRT_TWO_PI * UTMathFunctions::polynomialExp(-0.5 * d1[j] * d1[j]);
+			gaussD2[j] = gaussD1[j] * forward[j] / safeStrike;
+			stdDevs[j] = UTMathFunctions::select(degenerate, 0.0, stdDev);
+			sqrtTimes[j] = UTMathFunctions::select(sqrtTime > 0.0, sqrtTime, 1.0);
+		}
+
+		UTMathFunctions::cumulativeNormal(d1, gaussD1, cumNormD1, size);
+		UTMathFunctions::cumulativeNormal(d2, gaussD2, cumNormD2, size);
+
+		// A put is a call minus the forward, a straddle is a call plus a put: each value is scale * call + shift * (F - K)
+		for (unsigned long j = 0; j < size; ++j)
+		{
+			const int type = static_cast<int>(callPut[j]);
+			const double scale = UTMathFunctions::select(type == static_cast<int>(UT_CallPut::UT_STRADDLE), 2.0, 1.0);
+			const double shift = UTMathFunctions::select(type == static_cast<int>(UT_CallPut::UT_CALL), 0.0, -1.0);
+			const double live = UTMathFunctions::select(timeToExpiry[j] < 0.0, 0.0, 1.0);
+			const bool noVol = stdDevs[j] == 0.0;
+			const double step = UTMathFunctions::select(forward[j] >= strike[j], 1.0, 0.0);
+
+			// No gamma without vol: the gauss is 0, and the stdDev is replaced by 1 to keep the division defined
+			double nd1 = UTMathFunctions::select(noVol, step, cumNormD1[j]);
+			double nd2 = UTMathFunctions::select(noVol, step, cumNormD2[j]);
+			double gauss = UTMathFunctions::select(noVol, 0.0, gaussD1[j]);
+
+			double intrinsicCall = UTMathFunctions::select(forward[j] > strike[j], forward[j] - strike[j], 0.0);
+			double intrinsic = scale * intrinsicCall + shift * (forward[j] - strike[j]);
+			double premium = scale * (forward[j] * nd1 - strike[j] * nd2) + shift * (forward[j] - strike[j]);
+
+			premiums[start + j] = live * UTMathFunctions::select(premium > intrinsic, premium, intrinsic);
+			deltas[start + j] = live * (scale * nd1 + shift);
+			gammas[start + j] = live * scale * gauss / (forward[j] * UTMathFunctions::select(noVol, 1.0, stdDevs[j]));
+			vegas[start + j] = live * scale * forward[j] * sqrtTimes[j] * gauss;
+			thetas[start + j] = -0.5 * live * scale * forward[j] * sigma[j] * gauss / sqrtTimes[j];
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
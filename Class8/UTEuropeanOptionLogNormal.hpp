@@ -7,7 +7,11 @@
 #ifndef UT_EUROPEAN_OPTION_LOGNORMAL_H
 #define UT_EUROPEAN_OPTION_LOGNORMAL_H
 
+#include <cmath>
+#include <stdexcept>
 #include "UTEuropeanOptionBase.hpp"
+#include "UTMathFunctions.hpp"
+#include "UTVolSurface.hpp"
 
 
 class UTEuropeanOptionLogNormal : public UTEuropeanOptionBase
@@ -25,6 +29,13 @@ public:
 		double dTimeToExpiry,
 		double dSigma = 0.0);  // This is a LogNormal Volatility !!!
 
+	// Constructor with the sigma of the strike on the vol surface, sticky strike as the engines (see UTVolSurface::vol(strike, time))
+	UTEuropeanOptionLogNormal(
+		const UTVolSurface& volSurface,
+		double dForward,
+		double dStrike,
+		double dTimeToExpiry);
+
 
 public:
 
@@ -46,11 +57,66 @@ public:
 	// Overwrites the sigma in the Option Pricer -- updates all that has to be updated (called by the solvers)
 	virtual void overwriteSigma(double newSigma);
 
+	// The Option Premium of a (not expired) call or put from the forward and the stdDev (sigma * sqrt(time to expiry)),
+	// for any number type (double or UTAadNumber, see UTAad.hpp). Same as premium() for the same inputs.
+	template <class T> static T blackPremium(const T& forward, double strike, const T& stdDev, UT_CallPut callPut);
+
+	// The implied sigma of a premium without pricer object ("let's be rational" solver). The premium is brought to the time value of
+	// an out of the money call divided by sqrt(F K), which only depends on x = log(F/K) <= 0 and the stdDev s: a rational cubic first guess
+	// on one of four branches of the time value (split at its inflection point in s and at the tangents there, with the asymptotic maps
+	// of s -> 0 and s -> infinity on the outer ones) is refined by two third order Householder steps at most (their number in iterations
+	// if given), to the rounding.
+	// It uses the exact normal distribution: premium() of the result, with the 7.5e-8 approximation of cumulativeNormal, is as close.
+	static double blackImpliedSigma(double premium, double forward, double strike, double timeToExpiry, UT_CallPut callPut, unsigned long* iterations = nullptr);
+
+	// Batch version (index i < n): valid[i] is false for the premiums with no implied sigma (sigmas[i] is then a quiet NaN,
+	// which is not to be tested with a self-comparison: it is folded away under fast floating point). No memory is allocated.
+	static void blackImpliedSigmaBatch(
+		const double* premiums,
+		const double* forwards,
+		const double* strikes,
+		const double* timesToExpiry,
+		const UT_CallPut* callPuts,
+		unsigned long n,
+		double* sigmas,
+		bool* valid);
+
+	// Batch version of the pricer for a book of options given as arrays (index i < n): same results as
+	// premium(), delta(), gamma(), vega() and theta() of UTEuropeanOptionLogNormal(forwards[i], strikes[i], timesToExpiry[i], sigmas[i]).
+	// The forwards must be positive, and the arrays must not overlap. No memory is allocated.
+	// Expired and zero vol options are selected with masks rather than branches, and exp and log are the polynomial ones of
+	// UTMathFunctions, so that the loops are vectorized by the compiler with precise floating point (see UTMathFunctions::select).
+	static void blackBatch(
+		const double* __restrict forwards,
+		const double* __restrict strikes,
+		const double* __restrict timesToExpiry,
+		const double* __restrict sigmas,
+		const UT_CallPut* __restrict callPuts,
+		unsigned long n,
+		double* __restrict premiums,
+		double* __restrict deltas,
+		double* __restrict gammas,
+		double* __restrict vegas,
+		double* __restrict thetas);
+
+protected:
+
+	// The first guess of impliedSigma: blackImpliedSigma
+	virtual double impliedSigmaGuess(double targetPremium, UT_CallPut callPut) const;
+
 private:
 
 	// Called by constructor - Calculates all the intermediate results and numbers
 	void preliminaryCalculations();
 
+	// The implied sigma: false (and sigma unchanged) if there is none
+	static bool impliedSigmaNoCheck(double premium, double forward, double strike, double timeToExpiry, UT_CallPut callPut, double& sigma, unsigned long& iterations);
+
+	// The normalised time value of an out of the money call (x <= 0), its derivative and its inverse in the stdDev (for beta in [0, exp(x/2)))
+	static double normalisedTimeValue(double x, double stdDev);
+	static double normalisedVega(double x, double stdDev);
+	static double normalisedImpliedStdDev(double beta, double x, unsigned long& iterations);
+
 	// Private Data
 
 	// Member variables (pre-calculated data)
@@ -68,4 +134,41 @@ private:
 
 };
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+//
+// template functions
+
+template <class T>
+T UTEuropeanOptionLogNormal::blackPremium(const T& forward, double strike, const T& stdDev, UT_CallPut callPut)
+{
+	using std::log;
+
+	if (callPut != UT_CallPut::UT_CALL && callPut != UT_CallPut::UT_PUT)
+	{
+		throw std::runtime_error("UTEuropeanOptionLogNormal::blackPremium: Unknown cal/put type.");
+	}
+
+	T intrinsic = callPut == UT_CallPut::UT_CALL ? forward - strike : strike - forward;
+	if (intrinsic < 0.0)
+	{
+		intrinsic = T(0.0);
+	}
+
+	// No vol, or no strike: the intrinsic value
+	if (stdDev < ourEpsilon || strike <= 0.0)
+	{
+		return intrinsic;
+	}
+
+	T d1 = log(forward / strike) / stdDev + 0.5 * stdDev;
+	T d2 = d1 - stdDev;
+
+	T premiumRtn = callPut == UT_CallPut::UT_CALL
+		? forward * UTMathFunctions::cumulativeNormal(d1) - strike * UTMathFunctions::cumulativeNormal(d2)
+		: strike * UTMathFunctions::cumulativeNormal(-d2) - forward * UTMathFunctions::cumulativeNormal(-d1);
+
+	return premiumRtn < intrinsic ? intrinsic : premiumRtn;
+}
+
 #endif // UT_EUROPEAN_OPTION_LOGNORMAL_H
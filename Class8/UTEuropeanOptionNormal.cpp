@@ -6,6 +6,8 @@
 
 #include "UTMathFunctions.hpp"
 #include "UTEuropeanOptionNormal.hpp"
+#include <float.h>
+#include <limits>
 #include <stdexcept>
 
 using namespace std;
@@ -242,5 +244,288 @@ UTEuropeanOptionNormal::theta(UT_CallPut callPut) const
 	return thetaRtn;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// The implied sigma of a premium, without pricer object
+double
+UTEuropeanOptionNormal::bachelierImpliedSigma(double premium, double forward, double strike, double timeToExpiry, UT_CallPut callPut, unsigned long* iterations)
+{
+	if (timeToExpiry <= 0.0)
+	{
+		throw runtime_error("UTEuropeanOptionNormal::bachelierImpliedSigma: the time to expiry should be positive.");
+	}
+	if (callPut != UT_CallPut::UT_CALL && callPut != UT_CallPut::UT_PUT && callPut != UT_CallPut::UT_STRADDLE)
+	{
+		throw runtime_error("UTEuropeanOptionNormal::bachelierImpliedSigma: Unknown option Type");
+	}
+
+	unsigned long numberOfIterations;
+	double rtn;
+	if (!impliedSigmaNoCheck(premium, forward, strike, timeToExpiry, callPut, rtn, numberOfIterations))
+	{
+		throw runtime_error("UTEuropeanOptionNormal::bachelierImpliedSigma: the premium should not be less than the intrinsic value.");
+	}
+
+	if (iterations)
+		*iterations = numberOfIterations;
+
+	return rtn;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Batch implied sigmas: a loop on the solver, without object or allocation
+void
+UTEuropeanOptionNormal::bachelierImpliedSigmaBatch(
+	const double* premiums,
+	const double* forwards,
+	const double* strikes,
+	const double* timesToExpiry,
+	const UT_CallPut* callPuts,
+	unsigned long n,
+	double* sigmas,
+	bool* valid)
+{
+	unsigned long iterations;
+	for (unsigned long i = 0; i < n; ++i)
+	{
+		valid[i] = timesToExpiry[i] > 0.0
+			&& (callPuts[i] == UT_CallPut::UT_CALL || callPuts[i] == UT_CallPut::UT_PUT || callPuts[i] == UT_CallPut::UT_STRADDLE)
+			&& impliedSigmaNoCheck(premiums[i], forwards[i], strikes[i], timesToExpiry[i], callPuts[i], sigmas[i], iterations);
+
+		if (!valid[i])
+			sigmas[i] = numeric_limits<double>::quiet_NaN();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The first guess of impliedSigma
+double
+UTEuropeanOptionNormal::impliedSigmaGuess(double targetPremium, UT_CallPut callPut) const
+{
+	if (timeToExpiry() <= 0.0)
+	{
+		return sigma();
+	}
+
+	unsigned long iterations;
+	double rtn;
+
+	return impliedSigmaNoCheck(targetPremium, forward(), strike(), timeToExpiry(), callPut, rtn, iterations) ? rtn : sigma();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The implied sigma: from the time value of the out of the money option, which is the same for the call and the put (call-put parity)
+bool
+UTEuropeanOptionNormal::impliedSigmaNoCheck(double premium, double forward, double strike, double timeToExpiry, UT_CallPut callPut, double& sigma, unsigned long& iterations)
+{
+	const double SQRT_TWO_PI = 2.506628274631;
+
+	double timeValue;
+	if (callPut == UT_CallPut::UT_CALL)
+		timeValue = premium - UTMathFunctions::max(forward - strike, 0.0);
+	else if (callPut == UT_CallPut::UT_PUT)
+		timeValue = premium - UTMathFunctions::max(strike - forward, 0.0);
+	else
+		timeValue = 0.5 * (premium - fabs(forward - strike));  // A straddle is a call plus a put
+
+	// At the money, the time value is stdDev / sqrt(2 pi)
+	double distance = fabs(forward - strike);
+	iterations = 0;
+	if (distance == 0.0)
+	{
+		if (!(timeValue >= 0.0))
+		{
+			return false;
+		}
+
+		sigma = SQRT_TWO_PI * timeValue / sqrt(timeToExpiry);
+		return true;
+	}
+
+	// Not less than the intrinsic value
+	double tau = timeValue / distance;
+	if (!(tau >= 0.0 && tau < DBL_MAX))
+	{
+		return false;
+	}
+
+	sigma = normalisedImpliedStdDev(tau, iterations) * distance / sqrt(timeToExpiry);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The normalised time value: s n(1/s) - N(-1/s)
+double
+UTEuropeanOptionNormal::normalisedTimeValue(double stdDev)
+{
+	const double ONE_OVER_SQRT_TWO_PI = 0.398942280401433;
+
+	return stdDev * ONE_OVER_SQRT_TWO_PI * exp(-0.5 / (stdDev * stdDev)) - UTMathFunctions::accurateCumulativeNormal(-1.0 / stdDev);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The stdDev of a normalised time value
+double
+UTEuropeanOptionNormal::normalisedImpliedStdDev(double tau, unsigned long& iterations)
+{
+	const double ONE_OVER_SQRT_TWO_PI = 0.398942280401433;
+	const double SQRT_TWO_PI = 2.506628274631;
+	const unsigned long maximumNumberOfIterations = 10;
+
+	iterations = 0;
+
+	if (tau == 0.0)
+	{
+		return 0.0;
+	}
+
+	// The branches: below a stdDev of 1 the time value is like exp(-1 / 2 s^2)
+	const double tauC = normalisedTimeValue(1.0);
+	const bool lowerBranch = tau < tauC;
+
+	// The first guess
+	// - lower: s^2 as a function of u = 1 / log(tau): cubic Hermite between s = 1 and u = 0, where s^2 is like -u / 2;
+	// - upper: from tau + 1/2 like (s + 1 / 2s) / sqrt(2 pi), which is exact for an infinite stdDev.
+	double stdDev;
+	if (lowerBranch)
+	{
+		const double logTauC = log(tauC);
+		const double uC = 1.0 / logTauC;
+		const double slopeC = -2.0 * logTauC * logTauC * tauC / (ONE_OVER_SQRT_TWO_PI * exp(-0.5));  // d(s^2)/du = 2 s / (du/ds)
+		const double slope0 = -0.5;
+		const double t = 1.0 - 1.0 / (log(tau) * uC);
+		const double variance = (2.0 * t * t * t - 3.0 * t * t + 1.0)
+			- uC * ((t * t * t - 2.0 * t * t + t) * slopeC + (t * t * t - t * t) * slope0);
+
+		stdDev = variance > 0.0 ? sqrt(variance) : 1.0 / sqrt(2.0 * log(tauC / tau) + 1.0);
+	}
+	else
+	{
+		const double c = SQRT_TWO_PI * (tau + 0.5);
+		stdDev = 0.5 * (c + sqrt(UTMathFunctions::max(c * c - 2.0, 0.0)));
+	}
+
+	// Householder steps, inside the bracket of the root: the time value increases with the stdDev
+	const double logTau = log(tau);
+	double stdDevLow = 0.0;
+	double stdDevHigh = DBL_MAX;
+	while (iterations < maximumNumberOfIterations)
+	{
+		double value = normalisedTimeValue(stdDev);
+		double vega = ONE_OVER_SQRT_TWO_PI * exp(-0.5 / (stdDev * stdDev));
+		double volga = vega / (stdDev * stdDev * stdDev);
+		double thirdDerivative = volga * (1.0 / (stdDev * stdDev) - 3.0) / stdDev;
+
+		if (value < tau)
+			stdDevLow = stdDev;
+		else
+			stdDevHigh = stdDev;
+
+		double step = lowerBranch && value > 0.0
+			? householderStepInverseLog(value, vega, volga, thirdDerivative, logTau)
+			: householderStep(value - tau, vega, volga, thirdDerivative);
+		++iterations;
+
+		// Third order on an objective which is close to linear: after a step of less than 1e-4 (relative), the error is at the rounding
+		if (fabs(step) < 1.0e-4 * stdDev || value == tau)
+		{
+			return stdDev + step;
+		}
+
+		double newStdDev = stdDev + step;
+		if (!(newStdDev > stdDevLow && newStdDev < stdDevHigh))
+		{
+			newStdDev = stdDevHigh < DBL_MAX ? 0.5 * (stdDevLow + stdDevHigh) : 2.0 * stdDev;
+		}
+		stdDev = newStdDev;
+	}
+
+	return stdDev;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Batch pricer: the options are priced by chunks, whose intermediate results are on the stack
+void
+UTEuropeanOptionNormal::bachelierBatch(
+	const double* __restrict forwards,
+	const double* __restrict strikes,
+	const double* __restrict timesToExpiry,
+	const double* __restrict sigmas,
+	const UT_CallPut* __restrict callPuts,
+	unsigned long n,
+	double* __restrict premiums,
+	double* __restrict deltas,
+	double* __restrict gammas,
+	double* __restrict vegas,
+	double* __restrict thetas)
+{
+	// Check the option types once, out of the loops (no short circuit, which would be a branch)
+	bool known = true;
+	for (unsigned long i = 0; i < n; ++i)
+		known &= (callPuts[i] == UT_CallPut::UT_CALL) | (callPuts[i] == UT_CallPut::UT_PUT) | (callPuts[i] == UT_CallPut::UT_STRADDLE);
+
+	if (!known)
+	{
+		throw runtime_error("UTEuropeanOptionNormal::bachelierBatch: Unknown option Type");
+	}
+
+	const double ONE_OVER_SQRT_TWO_PI = 0.398942280401433;
+	const unsigned long chunkSize = 256;
+	double distances[chunkSize];
+	double stdDevs[chunkSize];
+	double sqrtTimes[chunkSize];
+	double cumNormD[chunkSize];
+	double gaussD[chunkSize];
+
+	for (unsigned long start = 0; start < n; start += chunkSize)
+	{
+		const unsigned long size = n - start < chunkSize ? n - start : chunkSize;
+		const double* forward = forwards + start;
+		const double* strike = strikes + start;
+		const double* timeToExpiry = timesToExpiry + start;
+		const double* sigma = sigmas + start;
+		const UT_CallPut* callPut = callPuts + start;
+
+		// The distances: with a stdDev of 1 when the option has no vol, so that they are always defined
+		for (unsigned long j = 0; j < size; ++j)
+		{
+			double sqrtTime = sqrt(UTMathFunctions::select(timeToExpiry[j] > 0.0, timeToExpiry[j], 0.0));
+			double stdDev = sigma[j] * sqrtTime;
+			bool noVol = stdDev < ourEpsilon;
+
+			distances[j] = (forward[j] - strike[j]) / UTMathFunctions::select(noVol, 1.0, stdDev);
+			gaussD[j] = ONE_OVER_SQRT_TWO_PI * UTMathFunctions::polynomialExp(-0.5 * distances[j] * distances[j]);
+			stdDevs[j] = UTMathFunctions::select(noVol, 0.0, stdDev);
+			sqrtTimes[j] = UTMathFunctions::select(sqrtTime > 0.0, sqrtTime, 1.0);
+		}
+
+		UTMathFunctions::cumulativeNormal(distances, gaussD, cumNormD, size);
+
+		// A put is a call minus the forward, a straddle is a call plus a put: each value is scale * call + shift * (F - K)
+		for (unsigned long j = 0; j < size; ++j)
+		{
+			const int type = static_cast<int>(callPut[j]);
+			const double scale = UTMathFunctions::select(type == static_cast<int>(UT_CallPut::UT_STRADDLE), 2.0, 1.0);
+			const double shift = UTMathFunctions::select(type == static_cast<int>(UT_CallPut::UT_CALL), 0.0, -1.0);
+			const double live = UTMathFunctions::select(timeToExpiry[j] < 0.0, 0.0, 1.0);
+			const bool noVol = stdDevs[j] == 0.0;
+			const double moneyness = forward[j] - strike[j];
+
+			// No gamma without vol: the gauss is 0, and the stdDev is replaced by 1 to keep the division defined
+			double nd = UTMathFunctions::select(noVol, UTMathFunctions::select(moneyness >= 0.0, 1.0, 0.0), cumNormD[j]);
+			double gauss = UTMathFunctions::select(noVol, 0.0, gaussD[j]);
+
+			double intrinsic = scale * UTMathFunctions::select(moneyness > 0.0, moneyness, 0.0) + shift * moneyness;
+			double premium = scale * (stdDevs[j] * gauss + moneyness * nd) + shift * moneyness;
+
+			premiums[start + j] = live * UTMathFunctions::select(premium > intrinsic, premium, intrinsic);
+			deltas[start + j] = live * (scale * nd + shift);
+			gammas[start + j] = live * scale * gauss / UTMathFunctions::select(noVol, 1.0, stdDevs[j]);
+			vegas[start + j] = live * scale * sqrtTimes[j] * gauss;
+			thetas[start + j] = -0.5 * live * scale * sigma[j] * gauss / sqrtTimes[j];
+		}
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -45,11 +45,59 @@ public:
 	// Overwrites the sigma in the Option Pricer -- updates all that has to be updated (called by the solvers)
 	virtual void overwriteSigma(double newSigma);
 
+	// The implied sigma of a premium without pricer object ("let's be rational" solver). The premium is brought to the time value of
+	// the out of the money option divided by |F - K|, which only depends on the stdDev divided by |F - K|: a rational first guess
+	// on the branch of the time value (below or above a stdDev of |F - K|) is refined by third order Householder steps
+	// (their number in iterations if given), to the rounding.
+	// It uses the exact normal distribution: premium() of the result, with the 7.5e-8 approximation of cumulativeNormal, is as close.
+	static double bachelierImpliedSigma(double premium, double forward, double strike, double timeToExpiry, UT_CallPut callPut, unsigned long* iterations = nullptr);
+
+	// Batch version (index i < n): valid[i] is false for the premiums with no implied sigma (sigmas[i] is then a quiet NaN). No memory is allocated.
+	static void bachelierImpliedSigmaBatch(
+		const double* premiums,
+		const double* forwards,
+		const double* strikes,
+		const double* timesToExpiry,
+		const UT_CallPut* callPuts,
+		unsigned long n,
+		double* sigmas,
+		bool* valid);
+
+	// Batch version of the pricer for a book of options given as arrays (index i < n): same results as
+	// premium(), delta(), gamma(), vega() and theta() of UTEuropeanOptionNormal(forwards[i], strikes[i], timesToExpiry[i], sigmas[i]).
+	// The arrays must not overlap. No memory is allocated.
+	// Expired and zero vol options are selected with masks rather than branches, and exp and log are the polynomial ones of
+	// UTMathFunctions, so that the loops are vectorized by the compiler with precise floating point (see UTMathFunctions::select).
+	static void bachelierBatch(
+		const double* __restrict forwards,
+		const double* __restrict strikes,
+		const double* __restrict timesToExpiry,
+		const double* __restrict sigmas,
+		const UT_CallPut* __restrict callPuts,
+		unsigned long n,
+		double* __restrict premiums,
+		double* __restrict deltas,
+		double* __restrict gammas,
+		double* __restrict vegas,
+		double* __restrict thetas);
+
+protected:
+
+	// The first guess of impliedSigma: bachelierImpliedSigma
+	virtual double impliedSigmaGuess(double targetPremium, UT_CallPut callPut) const;
+
 private:
 
 	// Called by constructor - Calculates all the intermediate results and numbers
 	void preliminaryCalculations();
 
+	// The implied sigma: false (and sigma unchanged) if there is none
+	static bool impliedSigmaNoCheck(double premium, double forward, double strike, double timeToExpiry, UT_CallPut callPut, double& sigma, unsigned long& iterations);
+
+	// The time value of an out of the money option with |F - K| = 1, and its inverse in the stdDev (for a finite tau >= 0)
+	static double normalisedTimeValue(double stdDev);
+	static double normalisedImpliedStdDev(double tau, unsigned long& iterations);
+
 	// Private Data
 
 	// Member variables (pre-calculated data)
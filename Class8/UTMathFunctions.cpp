@@ -7,6 +7,7 @@
 #include <cmath>
 
 #include "UTMathFunctions.hpp"
+#include "UTAad.hpp"
 
 using namespace std;
 
@@ -117,4 +118,125 @@ double UTMathFunctions::cumulativeNormal(double x)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+// AAD probability density: its derivative is -x * density
+UTAadNumber UTMathFunctions::normalDensity(const UTAadNumber& x)
+{
+	double density = normalDensity(x.value());
+	return UTAadNumber::newResult(density, x, -x.value() * density);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AAD standard normal cumulative distribution function: its derivative is the density
+UTAadNumber UTMathFunctions::cumulativeNormal(const UTAadNumber& x)
+{
+	return UTAadNumber::newResult(cumulativeNormal(x.value()), x, normalDensity(x.value()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Batch probability density for a standard Gaussian distribution
+void UTMathFunctions::normalDensity(const double* x, double* result, unsigned long n)
+{
+	const double ONE_OVER_SQRT_TWO_PI = 0.398942280401433;
+
+	for (unsigned long i = 0; i < n; ++i)
+		result[i] = ONE_OVER_SQRT_TWO_PI*polynomialExp(-x[i] * x[i] / 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Batch standard normal cumulative distribution function: both branches of the scalar function are calculated and the right one is selected
+void UTMathFunctions::cumulativeNormal(const double* x, double* result, unsigned long n)
+{
+	const double ONE_OVER_SQRT_TWO_PI = 0.398942280401433;
+	const double a0 = 0.319381530;
+	const double a1 = -0.356563782;
+	const double a2 = 1.781477937;
+	const double a3 = -1.821255978;
+	const double a4 = 1.330274429;
+
+	for (unsigned long i = 0; i < n; ++i)
+	{
+		double xi = x[i];
+		double density = ONE_OVER_SQRT_TWO_PI*polynomialExp(-xi*xi / 2);
+
+		// The lower tail probability of -|x|
+		double tmp = 1.0 / (1.0 + 0.2316419*fabs(xi));
+		double polynomialTail = density*(tmp*(a0 + tmp*(a1 + tmp*(a2 + tmp*(a3 + tmp*a4)))));
+		double asymptoticTail = density / sqrt(1. + xi*xi);
+		double tail = select(fabs(xi) > 7.0, asymptoticTail, polynomialTail);
+
+		result[i] = select(xi > 0.0, 1.0 - tail, tail);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Batch standard normal cumulative distribution function from the densities
+void UTMathFunctions::cumulativeNormal(const double* x, const double* density, double* result, unsigned long n)
+{
+	const double a0 = 0.319381530;
+	const double a1 = -0.356563782;
+	const double a2 = 1.781477937;
+	const double a3 = -1.821255978;
+	const double a4 = 1.330274429;
+
+	for (unsigned long i = 0; i < n; ++i)
+	{
+		double xi = x[i];
+
+		// The lower tail probability of -|x|
+		double tmp = 1.0 / (1.0 + 0.2316419*fabs(xi));
+		double polynomialTail = density[i]*(tmp*(a0 + tmp*(a1 + tmp*(a2 + tmp*(a3 + tmp*a4)))));
+		double asymptoticTail = density[i] / sqrt(1. + xi*xi);
+		double tail = select(fabs(xi) > 7.0, asymptoticTail, polynomialTail);
+
+		result[i] = select(xi > 0.0, 1.0 - tail, tail);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Batch InversecumulativeNormal: both branches of the scalar function are calculated and the right one is selected
+void UTMathFunctions::inverseCumulativeNormal(const double* u, double* result, unsigned long n)
+{
+	const double a0 = 2.50662823884;
+	const double a1 = -18.61500062529;
+	const double a2 = 41.39119773534;
+	const double a3 = -25.44106049637;
+
+	const double b0 = -8.47351093090;
+	const double b1 = 23.08336743743;
+	const double b2 = -21.06224101826;
+	const double b3 = 3.13082909833;
+
+	const double c0 = 0.3374754822726147;
+	const double c1 = 0.9761690190917186;
+	const double c2 = 0.1607979714918209;
+	const double c3 = 0.0276438810333863;
+	const double c4 = 0.0038405729373609;
+	const double c5 = 0.0003951896511919;
+	const double c6 = 0.0000321767881768;
+	const double c7 = 0.0000002888167364;
+	const double c8 = 0.0000003960315187;
+
+	for (unsigned long i = 0; i < n; ++i)
+	{
+		double ui = u[i];
+		double x = ui - 0.5;
+
+		// Beasley-Springer
+		double y = x*x;
+		double central = x*(((a3 * y + a2)*y + a1)*y + a0) /
+			((((b3 * y + b2)*y + b1)*y + b0)*y + 1.0);
+
+		// Moro: always in (0, 0.5], so the logarithms are defined even when the result is not used
+		double r = select(x > 0.0, 1.0 - ui, ui);
+		r = polynomialLog(-polynomialLog(r));
+		r = c0 + r*(c1 + r*(c2 + r*(c3 + r*(c4 + r*(c5 + r*(c6 +
+			r*(c7 + r*c8)))))));
+		double tail = select(x < 0.0, -r, r);
+
+		result[i] = select(fabs(x) < 0.42, central, tail);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
@@ -8,6 +8,10 @@
 #define UT_MATH_FUNCTIONS_H
 
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+
+class UTAadNumber;
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -65,6 +69,45 @@ public:
 
 	static double inverseCumulativeNormal(double x);
 
+	// Exact to the rounding, in relative terms in the lower tail (from erfc): for the implied vol solvers
+	static double accurateCumulativeNormal(double x) { return 0.5 * std::erfc(-0.7071067811865475 * x); }
+
+	// AAD versions (see UTAad.hpp)
+	static UTAadNumber normalDensity(const UTAadNumber& x);
+
+	static UTAadNumber cumulativeNormal(const UTAadNumber& x);
+
+	////
+	// The building blocks of the batch loops: only arithmetic and bit operations, inlined, so that the loops which call them
+	// are vectorized by the compiler with precise floating point (/fp:precise), without the vector math library of /fp:fast.
+
+	// exp and log from their polynomial approximations (fdlibm): within 1 ulp of std::exp and std::log.
+	// polynomialLog is for x > 0 (subnormals included): it is not defined for 0, negative numbers, infinity and NaN.
+	static double polynomialExp(double x);
+	static double polynomialLog(double x);
+
+	// condition ? a : b with bit masks: a and b are both calculated by the caller, and the compiler does not make a branch of it
+	// (a branch on a floating point condition is not vectorized when the arms could raise an exception, as with /fp:precise).
+	static double select(bool condition, double a, double b);
+
+	////
+	// Batch versions: result[i] = f(x[i]) for i < n (result may be x).
+	// Same approximations as the scalar functions, written with select, polynomialExp and polynomialLog so that the loops
+	// are vectorized by the compiler with precise floating point. The sqrt of the tails is vectorized by MSVC; GCC needs
+	// -fno-math-errno for it, since errno would be set for a negative argument.
+
+	// Exact to the rounding.
+	static void normalDensity(const double* x, double* result, unsigned long n);
+
+	// Abramowitz-Stegun 26.2.17 with the asymptotic tail below -7 and above 7: maximum absolute error 7.5e-8.
+	static void cumulativeNormal(const double* x, double* result, unsigned long n);
+
+	// The same, when the densities at x are already known (result may be density): saves the exponentials.
+	static void cumulativeNormal(const double* x, const double* density, double* result, unsigned long n);
+
+	// Beasley-Springer/Moro: maximum absolute error 3e-9 for u in [1e-10, 1 - 1e-10] (|result| <= 6.4). u must be in (0, 1).
+	static void inverseCumulativeNormal(const double* u, double* result, unsigned long n);
+
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -90,6 +133,110 @@ UTMathFunctions::sign(double x)
 	return 1.;
 }
 
+// The mask is all ones when the condition holds
+inline double
+UTMathFunctions::select(bool condition, double a, double b)
+{
+	std::uint64_t mask = 0 - static_cast<std::uint64_t>(condition);
+	std::uint64_t bitsA, bitsB;
+	std::memcpy(&bitsA, &a, sizeof(double));
+	std::memcpy(&bitsB, &b, sizeof(double));
+	bitsA = (bitsA & mask) | (bitsB & ~mask);
+	std::memcpy(&a, &bitsA, sizeof(double));
+	return a;
+}
+
+// exp(x) = 2^k exp(r) with x = k log(2) + r, |r| <= log(2) / 2: k is rounded by the addition of 1.5 * 2^52, which leaves it
+// in the low bits of the sum, and 2^k is built from its exponent bits in two halves, so that the underflow to the subnormals
+// and to 0 (x < -745) and the overflow to infinity (x > 709.8) are the ones of std::exp. NaN gives NaN.
+inline double
+UTMathFunctions::polynomialExp(double x)
+{
+	const double ROUND = 6755399441055744.0;  // 1.5 * 2^52
+	const std::uint64_t ROUND_BITS = 0x4338000000000000ULL;
+	const double LOG2_E = 1.44269504088896338700e+00;
+	const double LN2_HI = 6.93147180369123816490e-01;
+	const double LN2_LO = 1.90821492927058770002e-10;
+	const double P1 = 1.66666666666666019037e-01;
+	const double P2 = -2.77777777770155933842e-03;
+	const double P3 = 6.61375632143793436117e-05;
+	const double P4 = -1.65339022054652515390e-06;
+	const double P5 = 4.13813679705723846039e-08;
+
+	x = select(x < -746.0, -746.0, x);
+	x = select(x > 710.0, 710.0, x);
+
+	double k = (x * LOG2_E + ROUND) - ROUND;
+	double halfK = (0.5 * k + ROUND) - ROUND;
+	double hi = x - k * LN2_HI;
+	double lo = k * LN2_LO;
+	double r = hi - lo;
+
+	double r2 = r * r;
+	double c = r - r2 * (P1 + r2 * (P2 + r2 * (P3 + r2 * (P4 + r2 * P5))));
+	double y = 1.0 - ((lo - (r * c) / (2.0 - c)) - hi);
+
+	// 2^halfK and 2^(k - halfK) from the integers in the low bits of ROUND + halfK and ROUND + k - halfK
+	double shifted1 = halfK + ROUND;
+	double shifted2 = (k - halfK) + ROUND;
+	std::uint64_t bits1, bits2;
+	std::memcpy(&bits1, &shifted1, sizeof(double));
+	std::memcpy(&bits2, &shifted2, sizeof(double));
+	bits1 = (bits1 - ROUND_BITS + 1023) << 52;
+	bits2 = (bits2 - ROUND_BITS + 1023) << 52;
+	double scale1, scale2;
+	std::memcpy(&scale1, &bits1, sizeof(double));
+	std::memcpy(&scale2, &bits2, sizeof(double));
+
+	return y * scale1 * scale2;
+}
+
+// log(x) = k log(2) + log(1 + f) with 1 + f in [sqrt(2) / 2, sqrt(2)) from the exponent and the mantissa bits of x
+// (the subnormals are scaled by 2^54 first), and log(1 + f) = 2 atanh(s) with s = f / (2 + f) from its minimax polynomial in s^2
+inline double
+UTMathFunctions::polynomialLog(double x)
+{
+	const double TWO54 = 1.80143985094819840000e+16;
+	const double ROUND = 6755399441055744.0;  // 1.5 * 2^52
+	const std::uint64_t ROUND_BITS = 0x4338000000000000ULL;
+	const double LN2_HI = 6.93147180369123816490e-01;
+	const double LN2_LO = 1.90821492927058770002e-10;
+	const double LG1 = 6.666666666666735130e-01;
+	const double LG2 = 3.999999999940941908e-01;
+	const double LG3 = 2.857142874366239149e-01;
+	const double LG4 = 2.222219843214978396e-01;
+	const double LG5 = 1.818357216161805012e-01;
+	const double LG6 = 1.531383769920937332e-01;
+	const double LG7 = 1.479819860511658591e-01;
+
+	bool subnormal = x < 2.2250738585072014e-308;
+	x *= select(subnormal, TWO54, 1.0);
+
+	// The exponent (as ROUND + the biased exponent) and the mantissa in [1, 2), brought to [sqrt(2) / 2, sqrt(2))
+	std::uint64_t bits;
+	std::memcpy(&bits, &x, sizeof(double));
+	std::uint64_t exponentBits = ((bits >> 52) & 0x7ff) + ROUND_BITS;
+	bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+	double m, exponent;
+	std::memcpy(&m, &bits, sizeof(double));
+	std::memcpy(&exponent, &exponentBits, sizeof(double));
+
+	double k = (exponent - ROUND) - select(subnormal, 1023.0 + 54.0, 1023.0);
+	bool high = m > 1.41421356237309504880;
+	m *= select(high, 0.5, 1.0);
+	k += select(high, 1.0, 0.0);
+
+	double f = m - 1.0;
+	double s = f / (2.0 + f);
+	double z = s * s;
+	double w = z * z;
+	double t1 = w * (LG2 + w * (LG4 + w * LG6));
+	double t2 = z * (LG1 + w * (LG3 + w * (LG5 + w * LG7)));
+	double hfsq = 0.5 * f * f;
+
+	return k * LN2_HI - ((hfsq - (s * (hfsq + t1 + t2) + k * LN2_LO)) - f);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
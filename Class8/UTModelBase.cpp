@@ -19,5 +19,25 @@ const UTModelBase* UTModelBase::subModel(unsigned long i) const
 	return nullptr;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void UTModelBase::df(const double* times, double* result, unsigned long n) const
+{
+	for (unsigned long i = 0; i < n; ++i)
+		result[i] = df(times[i]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const vector<double>& UTModelBase::volPillars() const
+{
+	static const vector<double> ourNoPillar;
+	return ourNoPillar;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const UTModelYieldCurve* UTModelBase::yieldCurve() const
+{
+	return nullptr;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
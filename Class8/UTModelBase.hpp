@@ -8,6 +8,9 @@
 #define UT_MODEL_BASE_H
 
 #include <string>
+#include <vector>
+
+class UTModelYieldCurve;
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -22,6 +25,8 @@ public:
 	// Make UTSolveForModelComponent a friend so that model can be calibrated.
 	friend class UTSolveForModelComponent;
 	friend class UTSolveForModelComponent2;
+	friend class UTSolveForYieldCurve;
+	friend class UTSolveForVolPillar;
 
 	static std::string const ourClassTag;
 
@@ -37,8 +42,19 @@ public:
 	// Functions.
 	virtual  std::string classTag() const = 0;
 	virtual double df(double time) const = 0;
+
+	// Batch discount factors: result[i] = df(times[i]) for i < n (result may be times). Fastest with the times in increasing order.
+	virtual void df(const double* times, double* result, unsigned long n) const;
 	virtual double forwardRate(double startTime, double endTime) const = 0;
 
+	// The pillars of the model, the inputs of the AAD sensitivities (see UTValuationEngineBase::calculatePillarSensitivities):
+	// the rates of the (sub) yield curve, and the vols (none for a yield curve).
+	virtual const std::vector<double>& ratePillars() const = 0;
+	virtual const std::vector<double>& volPillars() const;
+
+	// The yield curve of the rate pillars (nullptr if none)
+	virtual const UTModelYieldCurve* yieldCurve() const;
+
 
 	// Return a reference to the ith sub-model
 	virtual const UTModelBase* subModel(unsigned long i) const;
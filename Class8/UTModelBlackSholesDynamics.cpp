@@ -7,6 +7,8 @@
 #include "UTModelBlackSholesDynamics.hpp"
 #include "UTModelYieldCurve.hpp"
 #include "UTWrapper.hpp"
+#include <algorithm>
+#include <stdexcept>
 
 using namespace std;
 
@@ -28,12 +30,14 @@ UTModelBlackSholesDynamics::UTModelBlackSholesDynamics()
 	: UTModelBase(),
 	mySpot(100.0), myTimeLine(1, 1.0), myVols(1, 0.3), myInterpolatee(UT_INST_VOL), myInterpolationMethod(UT_FLAT)
 {
+	calculateCumulativeVariances();
 }
 ///////////////////////////////////////////////////////////////////////////////
 UTModelBlackSholesDynamics::UTModelBlackSholesDynamics(double spot, double flatVol, double flatRate)
 	: UTModelBase(),
 	mySpot(spot), myTimeLine(1, 1.0), myVols(1, flatVol), myInterpolatee(UT_INST_VOL), myInterpolationMethod(UT_FLAT), myYieldCurve(new UTModelYieldCurve(flatRate))
 {
+	calculateCumulativeVariances();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -45,6 +49,7 @@ UTModelBlackSholesDynamics::UTModelBlackSholesDynamics(double spot,
 	: UTModelBase(),
 	mySpot(spot), myTimeLine(timeLine), myVols(vols), myInterpolatee(interpolateeType), myInterpolationMethod(interpolationMethod)
 {
+	calculateCumulativeVariances();
 }
 ///////////////////////////////////////////////////////////////////////////////
 UTModelBase* UTModelBlackSholesDynamics::clone() const
@@ -89,10 +94,96 @@ double UTModelBlackSholesDynamics::logVariance(double startTime, double endTime)
 		return 0.0;
 	}
 
-	// Get the size of the time line.
+	unsigned long startPillar = lower_bound(myTimeLine.begin(), myTimeLine.end(), startTime) - myTimeLine.begin();
+	unsigned long endPillar = lower_bound(myTimeLine.begin() + startPillar, myTimeLine.end(), endTime) - myTimeLine.begin();
+
+	return cumulativeVariance(endTime, endPillar) - cumulativeVariance(startTime, startPillar);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTModelBlackSholesDynamics::cumulativeVariance(double time, unsigned long i) const
+{
+	// The vol i is the one up to the pillar i, the last one is extrapolated
+	auto gridSize = myTimeLine.size();
+
+	if (i == 0)
+	{
+		return myVols[0] * myVols[0] * time;
+	}
+	else if (i < gridSize)
+	{
+		return myCumulativeVariances[i - 1] + myVols[i] * myVols[i] * (time - myTimeLine[i - 1]);
+	}
+
+	return myCumulativeVariances[gridSize - 1] + myVols[gridSize - 1] * myVols[gridSize - 1] * (time - myTimeLine[gridSize - 1]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTModelBlackSholesDynamics::calculateCumulativeVariances(unsigned long firstPillar)
+{
+	auto gridSize = myTimeLine.size();
+	myCumulativeVariances.resize(gridSize);
+
+	double sum = firstPillar > 0 ? myCumulativeVariances[firstPillar - 1] : 0.0;
+	double previousTime = firstPillar > 0 ? myTimeLine[firstPillar - 1] : 0.0;
+
+	for (unsigned long i = firstPillar; i < gridSize; ++i)
+	{
+		sum += myVols[i] * myVols[i] * (myTimeLine[i] - previousTime);
+		myCumulativeVariances[i] = sum;
+		previousTime = myTimeLine[i];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTModelBlackSholesDynamics::logDriftsAndStandardDeviations(const double* times, double* drifts, double* standardDeviations, unsigned long n) const
+{
+	// The logs of the discount factors and the cumulative variances at the times, IN SITU
+	myYieldCurve->lnDf(times, drifts, n);
+
+	auto gridSize = myTimeLine.size();
+	unsigned long i = 0;
+	for (unsigned long k = 0; k < n; ++k)
+	{
+		if (k > 0 && times[k] < times[k - 1])
+		{
+			throw runtime_error("UTModelBlackSholesDynamics: the times of the drifts must be in increasing order.");
+		}
+
+		while (i < gridSize && myTimeLine[i] < times[k])
+			++i;
+		standardDeviations[k] = cumulativeVariance(times[k], i);
+	}
+
+	// The steps: the same as logDrift and logVariance between the times
+	double previousLnDf = 0.0;
+	double previousVariance = 0.0;
+	for (unsigned long k = 0; k < n; ++k)
+	{
+		double lnDf = drifts[k];
+		double cumulativeVariance = standardDeviations[k];
+		double variance = cumulativeVariance - previousVariance;
+
+		drifts[k] = lnDf - previousLnDf - 0.5 * variance;
+		standardDeviations[k] = sqrt(variance);
+
+		previousLnDf = lnDf;
+		previousVariance = cumulativeVariance;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTModelBlackSholesDynamics::logVarianceVolDerivative(double startTime, double endTime) const
+{
+	// Same walk as logVariance: d/de of integral (vol + e)^2 at e = 0.
+
+	if (endTime < startTime)
+	{
+		return 0.0;
+	}
+
 	auto gridSize = myTimeLine.size();
 
-	// Initialize some locals
 	double previousTime = startTime;
 	double currentTime = 0.0;
 	double sum = 0.0;
@@ -102,15 +193,30 @@ double UTModelBlackSholesDynamics::logVariance(double startTime, double endTime)
 	{
 		if (currentTime > previousTime)
 		{
-			sum += myVols[i] * myVols[i] * (currentTime - previousTime);
+			sum += 2.0 * myVols[i] * (currentTime - previousTime);
 			previousTime = currentTime;
 		}
 		++i;
 	}
 
-	return sum + myVols[i] * myVols[i] * (endTime - previousTime);
+	return sum + 2.0 * myVols[i] * (endTime - previousTime);
+}
 
+///////////////////////////////////////////////////////////////////////////////
+double UTModelBlackSholesDynamics::logVariancePillarDerivative(double startTime, double endTime, unsigned long pillar) const
+{
+	auto gridSize = myTimeLine.size();
+
+	if (endTime < startTime || pillar >= gridSize)
+	{
+		return 0.0;
+	}
+
+	// The vol of the pillar is the one from the pillar before (from 0 for the first one) up to it (for ever for the last one)
+	double segmentStart = pillar > 0 ? max(startTime, myTimeLine[pillar - 1]) : startTime;
+	double segmentEnd = pillar + 1 < gridSize ? min(endTime, myTimeLine[pillar]) : endTime;
 
+	return segmentEnd > segmentStart ? 2.0 * myVols[pillar] * (segmentEnd - segmentStart) : 0.0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -118,5 +224,16 @@ double UTModelBlackSholesDynamics::vol(double time) const
 {
 	return sqrt(logVariance(0, time) / time);
 }
+
+///////////////////////////////////////////////////////////////////////////////
+double UTModelBlackSholesDynamics::vol(double time, double strike) const
+{
+	if (!myVolSurface)
+	{
+		return vol(time);
+	}
+
+	return myVolSurface->vol(strike, time);
+}
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
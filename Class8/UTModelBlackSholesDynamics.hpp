@@ -7,11 +7,14 @@
 #ifndef UT_MODEL_BLACK_SHOLES_DYNAMICS_H
 #define UT_MODEL_BLACK_SHOLES_DYNAMICS_H
 
+#include <cmath>
+#include <memory>
 #include <string>
 #include <vector>
 #include "UTModelBase.hpp"
 #include "UTModelYieldCurve.hpp"
 #include "UTWrapper.hpp"
+#include "UTVolSurface.hpp"
 
 
 class UTModelYieldCurve;
@@ -59,6 +62,10 @@ public:
 	void setModelYieldCurve(const UTModelYieldCurve& yieldCurveModel) {
 		myYieldCurve = static_cast<UTModelYieldCurve*>(yieldCurveModel.clone());
 	};
+
+	// Set the implied vol surface the European options are priced with (see vol(time, strike)): none by default
+	void setVolSurface(const std::shared_ptr<const UTVolSurface>& volSurface) { myVolSurface = volSurface; }
+	const std::shared_ptr<const UTVolSurface>& volSurface() const { return myVolSurface; }
 	
 
 	// Clone
@@ -71,6 +78,9 @@ public:
 	// Return the discount factor given a date
 	virtual double df(double time) const;
 
+	// Batch discount factors (from the sub yield curve)
+	virtual void df(const double* times, double* result, unsigned long n) const { myYieldCurve->df(times, result, n); }
+
 	// Return the forward rate given two dates  
 	virtual double forwardRate(double startTime, double endTime) const;
 
@@ -79,14 +89,46 @@ public:
 
 	double logDrift(double startTtime, double endTime) const;
 
+	// The variance of the log spot between the two dates: the difference of the precomputed cumulative variances at the two dates (binary searches)
 	double logVariance(double startTime, double endTime) const;
 
+	// Batch drifts and standard deviations of the log spot over the steps of a time line (times in increasing order):
+	// from 0 to times[0], then from times[i - 1] to times[i]. The lookups are linear merges with the time lines of the model.
+	void logDriftsAndStandardDeviations(const double* times, double* drifts, double* standardDeviations, unsigned long n) const;
+
+	// Derivative of logVariance(startTime, endTime) with respect to a parallel shift of the vols: 2 * integral of the vol.
+	double logVarianceVolDerivative(double startTime, double endTime) const;
+
+	// Derivative of logVariance(startTime, endTime) with respect to the vol of the pillar: 2 * vol * the time it spends on the pillar.
+	double logVariancePillarDerivative(double startTime, double endTime, unsigned long pillar) const;
+
 	double vol(double time) const;
 
+	// The implied vol of the strike at the time: from the vol surface if set, sticky strike (see UTVolSurface::vol(strike, time)), otherwise vol(time)
+	double vol(double time, double strike) const;
+
+	// The pillars: the rates of the sub yield curve and the vols
+	virtual const std::vector<double>& ratePillars() const { return myYieldCurve->ratePillars(); }
+	virtual const std::vector<double>& volPillars() const { return myVols; }
+	virtual const UTModelYieldCurve* yieldCurve() const { return &*myYieldCurve; }
+
+	// The same functions of the given pillars instead of the ones of the model, for any number type (double or UTAadNumber, see UTAad.hpp):
+	// the rates come as the interpolation of the yield curve (see UTModelYieldCurve::calculateInterpolation)
+	template <class T> T df(double time, const UTModelYieldCurve::UTInterpolation<T>& curve) const { return myYieldCurve->df(time, curve); }
+	template <class T> T forwardPrice(double time, const UTModelYieldCurve::UTInterpolation<T>& curve) const { return mySpot / df(time, curve); }
+	template <class T> T logVariance(double startTime, double endTime, const std::vector<T>& vols) const;
+	template <class T> T vol(double time, const std::vector<T>& vols) const { using std::sqrt; return sqrt(logVariance(0.0, time, vols) / time); }
+
 private:
 
 	// solver in the calibration only use this.
-	virtual void setComponent(unsigned int i, double component) { myVols[i] = component; }
+	virtual void setComponent(unsigned int i, double component) { myVols[i] = component; calculateCumulativeVariances(i); }
+
+	// Calculate myCumulativeVariances from the pillar firstPillar on (the ones before do not depend on its vol)
+	void calculateCumulativeVariances(unsigned long firstPillar = 0);
+
+	// The variance of the log spot from 0 to time, from the pillar i: the first one at or after time (the size of the time line if none)
+	double cumulativeVariance(double time, unsigned long i) const;
 
 	// This Black Dynamics Model contains a sub-model that will do all the underlying calculations : df, forward, ...
 	UTWrapper<UTModelYieldCurve>        myYieldCurve;
@@ -97,10 +139,53 @@ private:
 	std::vector<double> myTimeLine;
 	std::vector<double> myVols;
 
+	// The integral of the instantanious variance from 0 to each pillar
+	std::vector<double> myCumulativeVariances;
+
 	UT_InterpolateeType myInterpolatee;
 	UT_InterpolationMethod myInterpolationMethod;
 
+	// The smile (immutable, shared with the copies of the model)
+	std::shared_ptr<const UTVolSurface> myVolSurface;
+
 };
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+//
+// template functions
+
+template <class T>
+T UTModelBlackSholesDynamics::logVariance(double startTime, double endTime, const std::vector<T>& vols) const
+{
+	//Assuming flat instantanious vol interpolation..
+
+	if (endTime < startTime)
+	{
+		return T(0.0);
+	}
+
+	// Get the size of the time line.
+	auto gridSize = myTimeLine.size();
+
+	// Initialize some locals
+	double previousTime = startTime;
+	double currentTime = 0.0;
+	T sum(0.0);
+	unsigned int i = 0;
+
+	while ((currentTime = myTimeLine[i]) < endTime && i < gridSize - 1)
+	{
+		if (currentTime > previousTime)
+		{
+			sum += vols[i] * vols[i] * (currentTime - previousTime);
+			previousTime = currentTime;
+		}
+		++i;
+	}
+
+	return sum + vols[i] * vols[i] * (endTime - previousTime);
+}
+
 #endif // UT_MODEL_BLACK_SHOLES_DYNAMICS_H
 
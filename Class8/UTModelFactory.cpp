@@ -4,6 +4,8 @@
 * Diva Analytics
 */
 
+#include <algorithm>
+#include <array>
 #include <memory>
 
 #include "UTEnum.hpp"
@@ -13,9 +15,68 @@
 #include "UTEuropeanOptionLogNormal.hpp"
 #include "UTValuationEngineFactory.hpp"
 #include "UTBisection.hpp"
+#include "UTThreadPool.hpp"
 
 using namespace std;
 
+namespace
+{
+	// Run task(begin, end) on contiguous ranges of [0, size), one per thread (0: all the threads of the pool), of minimumSize at least.
+	// The ranges are the tasks of the thread pool of the process (the ranges, hence the results, do not depend on its size).
+	// The exceptions of the tasks are rethrown.
+	template <class F>
+	void runRanges(unsigned long size, unsigned long numberOfThreads, unsigned long minimumSize, const F& task)
+	{
+		UTThreadPool& pool = UTThreadPool::pool();
+		if (numberOfThreads == 0)
+		{
+			numberOfThreads = pool.numberOfThreads();
+		}
+
+		// No point to have threads for a few quotes
+		if (numberOfThreads > size / minimumSize)
+		{
+			numberOfThreads = size / minimumSize;
+		}
+
+		if (numberOfThreads <= 1)
+		{
+			task(0, size);
+			return;
+		}
+
+		pool.run(numberOfThreads, [&](unsigned long t)
+		{
+			task(size * t / numberOfThreads, size * (t + 1) / numberOfThreads);
+		});
+	}
+
+	// A strike of an expiry in the surface calibration: the averages of its quotes (their range in the sorted quotes),
+	// as undiscounted call price and as total variance
+	struct UTSmileStrike
+	{
+		double strike;
+		double callPrice;
+		double totalVariance;
+		unsigned long firstQuote;
+		unsigned long lastQuote;
+		bool accepted;
+	};
+
+	// The total variance of a smile given by its knots: linear between them, flat outside (as UTVolSurface)
+	double smileVariance(const vector<double>& logMoneyness, const vector<double>& totalVariances, double x)
+	{
+		unsigned long i = upper_bound(logMoneyness.begin(), logMoneyness.end(), x) - logMoneyness.begin();
+		if (i == 0)
+			return totalVariances.front();
+		if (i == logMoneyness.size())
+			return totalVariances.back();
+
+		double weight = (x - logMoneyness[i - 1]) / (logMoneyness[i] - logMoneyness[i - 1]);
+		return (1.0 - weight) * totalVariances[i - 1] + weight * totalVariances[i];
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 unique_ptr<UTModelYieldCurve>
@@ -34,23 +95,12 @@ const UTModelYieldCurve::UT_InterpolateeType& interpolateeType)
 	// Create a temporal yield curve model with inputed interp method
 	unique_ptr<UTModelYieldCurve> pYieldCurveModel(new UTModelYieldCurve(swapMaturities, swapRates, interpolateeType, interpMethod));
 
-	//We are assuming that the swap maturities and rates are ordered correctly...
-	for (unsigned int i = 0; i < swapMaturities.size(); ++i)
-	{
-		// create product.
-		// Assuming the swap convention is like JPY swaps..
-		UTProductSwapVanilla vanillaSwap(0, swapMaturities[i], swapRates[i], 0.5, 0.5, 10000.0, UT_PayReceive:: UT_RECEIVE);
-
-		// 1) polymorphism solution
-		//UTSolveForModelComponent solver(*pYieldCurveModel, vanillaSwap, 0.0,i);
-		//double rate = solver.root(-0.1, 1.0);
-
-		// 2) Template solution
-		UTSolveForModelComponent2 solver(*pYieldCurveModel, vanillaSwap, 0.0, i);
-		double rate = bisection(solver, -0.1, 1.0);
-
+	// The solver generates the cashflows of the swaps once
+	UTSolveForYieldCurve solver(*pYieldCurveModel, swapMaturities, swapRates);
 
-	}
+	// A cubic spline moves the curve before a pillar when its rate is solved, so the bootstrap is repeated until the rates settle.
+	// The other interpolations are local: one pass is enough.
+	solver.bootstrap(0, interpMethod == UTModelYieldCurve::UT_CUBIC_SPLINE ? 200 : 1);
 
 	// Calibration is done! So return the calibrated model
 	return pYieldCurveModel;
@@ -65,7 +115,8 @@ UTModelFactory::newModelBlackSholesDynamics(
 	const vector<double> &    impVols,
 	const shared_ptr<const UTModelYieldCurve>& subYieldCurveModel,
 	const UTModelBlackSholesDynamics::UT_InterpolationMethod& interpMethod,
-	const UTModelBlackSholesDynamics::UT_InterpolateeType& interpolateeType)
+	const UTModelBlackSholesDynamics::UT_InterpolateeType& interpolateeType,
+	vector<double>* residuals)
 {
 	// Check the size of the 2 vectors
 	if (optionMaturities.size() != impVols.size())
@@ -73,35 +124,336 @@ UTModelFactory::newModelBlackSholesDynamics(
 		throw runtime_error("UTModelFactory: The size of option maturities and imp Vols should be the same.");
 	}
 
+	// The implied total variances: the ATM forward call prices only depend on them
+	const unsigned long numberOfPillars = optionMaturities.size();
+	vector<double> totalVariances(numberOfPillars);
+	for (unsigned long i = 0; i < numberOfPillars; ++i)
+	{
+		totalVariances[i] = impVols[i] * impVols[i] * optionMaturities[i];
+
+		if (optionMaturities[i] <= (i > 0 ? optionMaturities[i - 1] : 0.0))
+		{
+			throw runtime_error("UTModelFactory: The option maturities should be positive and increasing.");
+		}
+		if (i > 0 && totalVariances[i] < totalVariances[i - 1])
+		{
+			throw runtime_error("UTModelFactory: The implied total variances should increase with the maturity (calendar arbitrage).");
+		}
+	}
+
+	// Flat instantanious vol: the variance between two maturities is the forward variance, so each vol is exact
+	const bool closedForm = interpolateeType == UTModelBlackSholesDynamics::UT_INST_VOL && interpMethod == UTModelBlackSholesDynamics::UT_FLAT;
+	vector<double> vols(impVols);
+	if (closedForm)
+	{
+		double previousTime = 0.0;
+		double previousVariance = 0.0;
+		for (unsigned long i = 0; i < numberOfPillars; ++i)
+		{
+			vols[i] = sqrt((totalVariances[i] - previousVariance) / (optionMaturities[i] - previousTime));
+			previousTime = optionMaturities[i];
+			previousVariance = totalVariances[i];
+		}
+	}
+
 	// Create a temporal Black Dynamics model with inputed interp method
-	unique_ptr<UTModelBlackSholesDynamics> pBlackSholesDynamicsModel(new UTModelBlackSholesDynamics(spotPrice, optionMaturities, impVols, interpolateeType, interpMethod));
+	unique_ptr<UTModelBlackSholesDynamics> pBlackSholesDynamicsModel(new UTModelBlackSholesDynamics(spotPrice, optionMaturities, vols, interpolateeType, interpMethod));
 	pBlackSholesDynamicsModel->setModelYieldCurve(*subYieldCurveModel);
 
-	//We are assuming that the option maturities and vols are ordered correctly...
-	for (unsigned int i = 0; i < optionMaturities.size(); ++i)
+	// The other interpolations: a safeguarded Newton on the variance of each pillar in turn
+	if (!closedForm)
 	{
-		// create product.
-		UTProductEuropeanOptionCall vanillCallOption(optionMaturities[i], 1.0, UT_BuySell::UT_BUY, pBlackSholesDynamicsModel->forwardPrice(optionMaturities[i]));
+		for (unsigned int i = 0; i < numberOfPillars; ++i)
+		{
+			UTSolveForVolPillar solver(*pBlackSholesDynamicsModel, optionMaturities[i], totalVariances[i], i);
+			solver.setVol(safeguardedNewton(solver, 0.0, 3.0));
+		}
+	}
 
-		double maturity = optionMaturities[i];
-		double fwdPrice = pBlackSholesDynamicsModel->forwardPrice(maturity);
-		UTEuropeanOptionLogNormal black(fwdPrice, fwdPrice, maturity, impVols[i]);  //ATM forward
-		double df = pBlackSholesDynamicsModel->df(maturity);
+	// The residuals on the ATM forward call prices
+	if (residuals)
+	{
+		residuals->resize(numberOfPillars);
+		for (unsigned long i = 0; i < numberOfPillars; ++i)
+		{
+			double maturity = optionMaturities[i];
+			double fwdPrice = pBlackSholesDynamicsModel->forwardPrice(maturity);
+			double df = pBlackSholesDynamicsModel->df(maturity);
+			double modelStdDev = sqrt(pBlackSholesDynamicsModel->logVariance(0.0, maturity));
 
-		// 1) polymorphism solution
-		//UTSolveForModelComponent solver(*pBlackSholesDynamicsModel, vanillCallOption, black.premium(UT_CallPut::UT_CALL)*df, i);
-		//double rate = solver.root(0.00001/*low*/, 3.0/*upper*/);
+			double modelPv = UTEuropeanOptionLogNormal::blackPremium(fwdPrice, fwdPrice, modelStdDev, UT_CallPut::UT_CALL) * df;
+			double impliedPv = UTEuropeanOptionLogNormal::blackPremium(fwdPrice, fwdPrice, impVols[i] * sqrt(maturity), UT_CallPut::UT_CALL) * df;
+			(*residuals)[i] = modelPv - impliedPv;
+		}
+	}
 
-		// 2) Template solution
-		UTSolveForModelComponent2 solver(*pBlackSholesDynamicsModel, vanillCallOption, black.premium(UT_CallPut::UT_CALL)*df, i);
-		double rate = bisection(solver, 0.00001/*low*/, 3.0/*upper*/);
+	// Calibration is done! So return the calibrated model
+	return pBlackSholesDynamicsModel;
 
+}
 
+///////////////////////////////////////////////////////////////////////////////
+unique_ptr<UTModelBlackSholesDynamics>
+UTModelFactory::newModelBlackSholesDynamics(
+	double spotPrice,
+	const shared_ptr<const UTVolSurface>& volSurface,
+	const shared_ptr<const UTModelYieldCurve>& subYieldCurveModel,
+	const UTModelBlackSholesDynamics::UT_InterpolationMethod& interpMethod,
+	const UTModelBlackSholesDynamics::UT_InterpolateeType& interpolateeType)
+{
+	if (!volSurface)
+	{
+		throw runtime_error("UTModelFactory: Invalid vol surface.");
 	}
 
-	// Calibration is done! So return the calibrated model
+	// The ATM forward vols of the expiries with a forward variance
+	const vector<double>& expiries = volSurface->expiries();
+	vector<double> optionMaturities;
+	vector<double> impVols;
+	double previousVariance = 0.0;
+	for (unsigned long i = 0; i < expiries.size(); ++i)
+	{
+		double totalVariance = volSurface->totalVariance(0.0, expiries[i]);
+		if (i == 0 || totalVariance >= previousVariance)
+		{
+			optionMaturities.push_back(expiries[i]);
+			impVols.push_back(sqrt(totalVariance / expiries[i]));
+			previousVariance = totalVariance;
+		}
+	}
+
+	unique_ptr<UTModelBlackSholesDynamics> pBlackSholesDynamicsModel(
+		newModelBlackSholesDynamics(spotPrice, optionMaturities, impVols, subYieldCurveModel, interpMethod, interpolateeType));
+	pBlackSholesDynamicsModel->setVolSurface(volSurface);
+
 	return pBlackSholesDynamicsModel;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+shared_ptr<const UTVolSurface>
+UTModelFactory::newVolSurface(
+	const double* premiums,
+	const double* forwards,
+	const double* strikes,
+	const double* timesToExpiry,
+	const UT_CallPut* callPuts,
+	unsigned long n,
+	unsigned long numberOfThreads,
+	vector<bool>* accepted)
+{
+	// The relative tolerance of the arbitrage checks, for the rounding of the call-put parity
+	const double arbitrageTolerance = 1.0e-12;
+	const unsigned long minimumQuotesPerThread = 1024;
+
+	// The outliers: further from the median of the total variances of the 3 strikes on each side than outlierDeviations times
+	// their median absolute deviation from it, and than outlierTolerance in relative terms (the smiles with 5 strikes at least)
+	const unsigned long outlierNeighbours = 3;
+	const double outlierDeviations = 5.0;
+	const double outlierTolerance = 1.0e-3;
+
+	// The implied vols, by contiguous ranges of quotes on the threads, and whether there is one
+	vector<double> sigmas(n);
+	unique_ptr<bool[]> implied(new bool[n]);
+	runRanges(n, numberOfThreads, minimumQuotesPerThread, [&](unsigned long begin, unsigned long end)
+	{
+		UTEuropeanOptionLogNormal::blackImpliedSigmaBatch(premiums + begin, forwards + begin, strikes + begin, timesToExpiry + begin, callPuts + begin,
+			end - begin, sigmas.data() + begin, implied.get() + begin);
+	});
+
+	// The quotes with an implied vol, by expiry and strike
+	vector<unsigned long> quotes;
+	for (unsigned long i = 0; i < n; ++i)
+	{
+		if (implied[i])
+			quotes.push_back(i);
+	}
+	sort(quotes.begin(), quotes.end(), [=](unsigned long i, unsigned long j)
+	{
+		return timesToExpiry[i] < timesToExpiry[j] || (timesToExpiry[i] == timesToExpiry[j] && strikes[i] < strikes[j]);
+	});
+
+	// The expiries: their first quote, and the first quote after the last one
+	vector<unsigned long> firstQuotes;
+	for (unsigned long q = 0; q < quotes.size(); ++q)
+	{
+		if (q == 0 || timesToExpiry[quotes[q]] != timesToExpiry[quotes[q - 1]])
+			firstQuotes.push_back(q);
+	}
+	const unsigned long numberOfExpiries = firstQuotes.size();
+	firstQuotes.push_back(quotes.size());
+
+	// The smile of each expiry (in parallel): its strikes, with the call spread and butterfly arbitrages rejected
+	vector<vector<UTSmileStrike> > smileStrikes(numberOfExpiries);
+	runRanges(numberOfExpiries, numberOfThreads, 1, [&](unsigned long begin, unsigned long end)
+	{
+		for (unsigned long e = begin; e < end; ++e)
+		{
+			const unsigned long lastQuote = firstQuotes[e + 1];
+			const double forward = forwards[quotes[firstQuotes[e]]];
+			const double timeToExpiry = timesToExpiry[quotes[firstQuotes[e]]];
+			vector<UTSmileStrike>& smile = smileStrikes[e];
+
+			// The quotes of a strike are averaged: the call price from the call-put parity (a straddle is a call plus a put)
+			for (unsigned long q = firstQuotes[e]; q < lastQuote;)
+			{
+				UTSmileStrike point = { strikes[quotes[q]], 0.0, 0.0, q, q, true };
+				for (; q < lastQuote && strikes[quotes[q]] == point.strike; ++q)
+				{
+					unsigned long i = quotes[q];
+					if (fabs(forwards[i] - forward) > arbitrageTolerance * forward)
+					{
+						throw runtime_error("UTModelFactory: The quotes of an expiry should have the same forward.");
+					}
+
+					if (callPuts[i] == UT_CallPut::UT_CALL)
+						point.callPrice += premiums[i];
+					else if (callPuts[i] == UT_CallPut::UT_PUT)
+						point.callPrice += premiums[i] + forward - point.strike;
+					else
+						point.callPrice += 0.5 * (premiums[i] + forward - point.strike);
+					point.totalVariance += sigmas[i] * sigmas[i] * timeToExpiry;
+				}
+				point.lastQuote = q;
+				point.callPrice /= q - point.firstQuote;
+				point.totalVariance /= q - point.firstQuote;
+				smile.push_back(point);
+			}
+
+			// The outliers, against the median of their neighbours: it is not moved by an outlier among them
+			const unsigned long numberOfStrikes = smile.size();
+			if (numberOfStrikes > outlierNeighbours + 1)
+			{
+				array<double, 2 * outlierNeighbours> neighbours;
+				array<double, 2 * outlierNeighbours> deviations;
+				vector<bool> outliers(numberOfStrikes, false);
+				for (unsigned long k = 0; k < numberOfStrikes; ++k)
+				{
+					unsigned long first = k > outlierNeighbours ? k - outlierNeighbours : 0;
+					unsigned long last = min(k + outlierNeighbours, numberOfStrikes - 1);
+					unsigned long m = 0;
+					for (unsigned long j = first; j <= last; ++j)
+					{
+						if (j != k)
+							neighbours[m++] = smile[j].totalVariance;
+					}
+
+					// An insertion sort of the m values (no more than the size of the array)
+					auto median = [m](array<double, 2 * outlierNeighbours>& values)
+					{
+						for (unsigned long j = 1; j < m; ++j)
+						{
+							double value = values[j];
+							unsigned long l = j;
+							for (; l > 0 && values[l - 1] > value; --l)
+								values[l] = values[l - 1];
+							values[l] = value;
+						}
+						return m % 2 == 1 ? values[m / 2] : 0.5 * (values[m / 2 - 1] + values[m / 2]);
+					};
+					double neighbourMedian = median(neighbours);
+					for (unsigned long j = 0; j < m; ++j)
+						deviations[j] = fabs(neighbours[j] - neighbourMedian);
+					double medianDeviation = median(deviations);
+
+					double deviation = fabs(smile[k].totalVariance - neighbourMedian);
+					outliers[k] = deviation > outlierDeviations * medianDeviation && deviation > outlierTolerance * neighbourMedian;
+				}
+
+				for (unsigned long k = 0; k < numberOfStrikes; ++k)
+				{
+					if (outliers[k])
+						smile[k].accepted = false;
+				}
+			}
+
+			// The call prices left must be decreasing and convex in the strike, from the forward at strike 0: their lower hull
+			vector<unsigned long> hull;
+			for (unsigned long k = 0; k < numberOfStrikes; ++k)
+			{
+				const UTSmileStrike& point = smile[k];
+				if (!point.accepted)
+					continue;
 
+				if (!hull.empty() && point.callPrice > smile[hull.back()].callPrice)
+				{
+					smile[k].accepted = false;
+					continue;
+				}
+
+				// The strikes above the chord from the strike before them to this one
+				while (!hull.empty())
+				{
+					const UTSmileStrike& top = smile[hull.back()];
+					double previousStrike = hull.size() > 1 ? smile[hull[hull.size() - 2]].strike : 0.0;
+					double previousCallPrice = hull.size() > 1 ? smile[hull[hull.size() - 2]].callPrice : forward;
+					double chord = previousCallPrice + (point.callPrice - previousCallPrice) * (top.strike - previousStrike) / (point.strike - previousStrike);
+
+					if (top.callPrice <= chord + arbitrageTolerance * forward)
+						break;
+
+					smile[hull.back()].accepted = false;
+					hull.pop_back();
+				}
+				hull.push_back(k);
+			}
+		}
+	});
+
+	// The smiles, expiry after expiry: the knots below the smile of the previous expiry are calendar arbitrages
+	vector<double> expiries;
+	vector<double> expiryForwards;
+	vector<vector<double> > logMoneyness;
+	vector<vector<double> > totalVariances;
+	for (unsigned long e = 0; e < numberOfExpiries; ++e)
+	{
+		const double forward = forwards[quotes[firstQuotes[e]]];
+		vector<double> knots;
+		vector<double> variances;
+		for (UTSmileStrike& point : smileStrikes[e])
+		{
+			if (!point.accepted)
+				continue;
+
+			double x = log(point.strike / forward);
+			if ((!logMoneyness.empty() && point.totalVariance < (1.0 - arbitrageTolerance) * smileVariance(logMoneyness.back(), totalVariances.back(), x))
+				|| (!knots.empty() && x <= knots.back()))
+			{
+				point.accepted = false;
+				continue;
+			}
+
+			knots.push_back(x);
+			variances.push_back(point.totalVariance);
+		}
+
+		if (!knots.empty())
+		{
+			expiries.push_back(timesToExpiry[quotes[firstQuotes[e]]]);
+			expiryForwards.push_back(forward);
+			logMoneyness.push_back(knots);
+			totalVariances.push_back(variances);
+		}
+	}
+
+	if (expiries.empty())
+	{
+		throw runtime_error("UTModelFactory: No option quote is free of arbitrage.");
+	}
+
+	if (accepted)
+	{
+		accepted->assign(n, false);
+		for (unsigned long e = 0; e < numberOfExpiries; ++e)
+		{
+			for (const UTSmileStrike& point : smileStrikes[e])
+			{
+				for (unsigned long q = point.firstQuote; q < point.lastQuote; ++q)
+					(*accepted)[quotes[q]] = point.accepted;
+			}
+		}
+	}
+
+	return shared_ptr<const UTVolSurface>(new UTVolSurface(expiries, expiryForwards, logMoneyness, totalVariances));
 }
 
 
@@ -138,3 +490,271 @@ UTSolveForModelComponent2::error(double x)
 }
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
+double
+UTSolveForVolPillar::error(double x, double& slope)
+{
+	setVol(x);
+
+	slope = myModel.logVariancePillarDerivative(0.0, myMaturity, myComponentNumber);
+
+	return myModel.logVariance(0.0, myMaturity) - myTargetVariance;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void
+UTSolveForVolPillar::setVol(double x)
+{
+	// setComponent is only open to the solvers through the base class
+	UTModelBase& model = myModel;
+	model.setComponent(myComponentNumber, x);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+//UTSolveForYieldCurve
+//
+UTSolveForYieldCurve::UTSolveForYieldCurve(UTModelYieldCurve &model, const vector<double>& swapMaturities, const vector<double>& swapRates)
+	:
+	myModel(model),
+	mySwapRates(swapRates),
+	myFirstFlows(1, 0),
+	myDfsSet(swapMaturities.size(), false),
+	myFirstStaleSums(swapMaturities.size(), 0),
+	myPillar(0),
+	myRate(0.0),
+	myConstantPv(0.0)
+{
+	const unsigned long numberOfPillars = swapMaturities.size();
+	if (swapRates.size() != numberOfPillars || myModel.ratePillars().size() != numberOfPillars)
+	{
+		throw runtime_error("UTSolveForYieldCurve: There should be one swap per pillar of the curve.");
+	}
+
+	// The schedule of UTProductLegVanilla: backwards from the maturity, so that the stub in front is short
+	const double period = 0.5;
+	for (unsigned long i = 0; i < numberOfPillars; ++i)
+	{
+		double maturity = swapMaturities[i];
+		if (maturity <= (i > 0 ? swapMaturities[i - 1] : 0.0))
+		{
+			throw runtime_error("UTSolveForYieldCurve: The swap maturities should be positive and increasing.");
+		}
+
+		unsigned long numberOfFlows = (unsigned long)(maturity / period + 1.0 - 100.0 * DBL_EPSILON);
+		unsigned long first = myTimes.size();
+		myTimes.resize(first + numberOfFlows);
+		myAccrued.resize(first + numberOfFlows);
+
+		double endTime = maturity;
+		for (unsigned long j = numberOfFlows - 1; j > 0; --j)
+		{
+			double startTime = endTime - period;
+			myTimes[first + j] = endTime;
+			myAccrued[first + j] = endTime - startTime;
+			endTime = startTime;
+		}
+		myTimes[first] = endTime;
+		myAccrued[first] = endTime;
+
+		myFirstFlows.push_back(myTimes.size());
+	}
+
+	// The derivatives of lnDf with respect to the rate of the pillar of the swap
+	const unsigned long numberOfFlows = myTimes.size();
+	myRateDerivatives.resize(numberOfFlows);
+	myFirstMovingFlows.resize(numberOfPillars);
+
+	vector<double> unitRates;
+	UTModelYieldCurve::UTInterpolation<double> unitInterpolation;
+	for (unsigned long i = 0; i < numberOfPillars; ++i)
+	{
+		unsigned long first = myFirstFlows[i];
+		myModel.lnDfRateDerivatives(&myTimes[first], &myRateDerivatives[first], myFirstFlows[i + 1] - first, i, unitRates, unitInterpolation);
+
+		unsigned long k = first;
+		while (k < myFirstFlows[i + 1] && myRateDerivatives[k] == 0.0)
+			++k;
+		myFirstMovingFlows[i] = k;
+	}
+
+	myWeights.resize(numberOfFlows);
+	myLnDfs.resize(numberOfFlows);
+	myDfs.resize(numberOfFlows);
+	myPartialSums.resize(numberOfFlows + numberOfPillars, 0.0);
+
+	for (unsigned long i = 0; i < numberOfPillars; ++i)
+		setSwapRate(i, swapRates[i]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void
+UTSolveForYieldCurve::setSwapRate(unsigned long pillar, double swapRate)
+{
+	mySwapRates[pillar] = swapRate;
+
+	unsigned long last = myFirstFlows[pillar + 1] - 1;
+	for (unsigned long k = myFirstFlows[pillar]; k <= last; ++k)
+		myWeights[k] = swapRate * myAccrued[k];
+	myWeights[last] += 1.0;
+
+	// The discount factors are still valid, not the sums
+	myFirstStaleSums[pillar] = myFirstFlows[pillar];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void
+UTSolveForYieldCurve::setRates(const vector<double>& ratePillars)
+{
+	if (ratePillars.size() != mySwapRates.size())
+	{
+		throw runtime_error("UTSolveForYieldCurve: There should be one rate per pillar of the curve.");
+	}
+
+	// setComponent is only open to the solvers through the base class
+	UTModelBase& model = myModel;
+	for (unsigned long i = 0; i < ratePillars.size(); ++i)
+		model.setComponent(i, ratePillars[i]);
+
+	// The cached discount factors are the ones of another curve: the next solves start again from the first cashflow
+	myDfsSet.assign(myDfsSet.size(), false);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void
+UTSolveForYieldCurve::bootstrap(unsigned long firstPillar, unsigned long maxPasses)
+{
+	const unsigned long numberOfPillars = mySwapRates.size();
+	if (firstPillar >= numberOfPillars)
+		return;
+
+	// The curve has not moved before the segment of the first pillar
+	double fromTime = myModel.lastTimeIndependentOfPillar(firstPillar);
+
+	for (unsigned long pass = 0; pass < maxPasses; ++pass)
+	{
+		double maxChange = 0.0;
+
+		for (unsigned long i = firstPillar; i < numberOfPillars; ++i)
+		{
+			double previousRate = myModel.ratePillars()[i];
+			double rate = solve(i, fromTime);
+
+			maxChange = max(maxChange, fabs(rate - previousRate));
+		}
+
+		if (maxChange < 1.0e-12)
+			return;
+
+		// The next pass starts again from the first pillar: the whole curve may have moved
+		firstPillar = 0;
+		fromTime = 0.0;
+	}
+
+	// The passes ran out (a single pass is exact for the local interpolations): the curve must still reprice the swaps
+	if (maxPasses > 1)
+	{
+		for (unsigned long i = 0; i < numberOfPillars; ++i)
+		{
+			if (!(fabs(swapRateError(i)) < 1.0e-10))
+			{
+				throw runtime_error("UTSolveForYieldCurve: the bootstrap does not converge, the curve does not reprice the swaps.");
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double
+UTSolveForYieldCurve::swapRateError(unsigned long pillar) const
+{
+	double pv = -1.0;
+	double annuity = 0.0;
+
+	for (unsigned long k = myFirstFlows[pillar]; k < myFirstFlows[pillar + 1]; ++k)
+	{
+		double df = myModel.df(myTimes[k]);
+		pv += myWeights[k] * df;
+		annuity += myAccrued[k] * df;
+	}
+
+	return pv / annuity;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double
+UTSolveForYieldCurve::solve(unsigned long pillar, double fromTime)
+{
+	myPillar = pillar;
+	myRate = myModel.ratePillars()[pillar];
+
+	// The discount factors of the current curve: the ones of the cashflows which do not depend on the pillar only after fromTime
+	const unsigned long first = myFirstFlows[pillar];
+	const unsigned long firstMoving = myFirstMovingFlows[pillar];
+	const unsigned long last = myFirstFlows[pillar + 1];
+
+	unsigned long firstNew = first;
+	if (myDfsSet[pillar])
+		firstNew = upper_bound(myTimes.begin() + first, myTimes.begin() + firstMoving, fromTime) - myTimes.begin();
+	if (firstNew < firstMoving)
+		myModel.df(&myTimes[firstNew], &myDfs[firstNew], firstMoving - firstNew);
+	myDfsSet[pillar] = true;
+
+	// The partial sums before both the first new discount factor and the first new weight are still valid
+	double* partialSums = &myPartialSums[pillar];
+	for (unsigned long k = min(firstNew, myFirstStaleSums[pillar]); k < firstMoving; ++k)
+		partialSums[k + 1] = partialSums[k] + myWeights[k] * myDfs[k];
+	myFirstStaleSums[pillar] = firstMoving;
+	myConstantPv = partialSums[firstMoving] - 1.0;
+
+	if (firstMoving < last)
+		myModel.lnDf(&myTimes[firstMoving], &myLnDfs[firstMoving], last - firstMoving);
+
+	// Newton from the current rate, bisection if it does not converge
+	double rate = root(myRate);
+	if (!(rate >= -0.1 && rate <= 1.0 && fabs(valueSlopeRatio(rate)) < 1.0e-12))
+	{
+		rate = bisection(*this, -0.1, 1.0);
+
+		// The bisection ends on a bound if no rate in between reprices the swap
+		if (!(fabs(error(rate)) < 1.0e-10))
+		{
+			throw runtime_error("UTSolveForYieldCurve: no rate between -10% and 100% reprices the swap of the pillar.");
+		}
+	}
+
+	// setComponent is only open to the solvers through the base class
+	UTModelBase& model = myModel;
+	model.setComponent(pillar, rate);
+
+	return rate;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double
+UTSolveForYieldCurve::error(double x)
+{
+	double pv = myConstantPv;
+	for (unsigned long k = myFirstMovingFlows[myPillar]; k < myFirstFlows[myPillar + 1]; ++k)
+		pv += myWeights[k] * exp(-1.0 * (myLnDfs[k] + (x - myRate) * myRateDerivatives[k]));
+
+	return pv;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double
+UTSolveForYieldCurve::valueSlopeRatio(double x)
+{
+	double pv = myConstantPv;
+	double slope = 0.0;
+	for (unsigned long k = myFirstMovingFlows[myPillar]; k < myFirstFlows[myPillar + 1]; ++k)
+	{
+		double value = myWeights[k] * exp(-1.0 * (myLnDfs[k] + (x - myRate) * myRateDerivatives[k]));
+		pv += value;
+		slope -= value * myRateDerivatives[k];
+	}
+
+	return pv / slope;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
@@ -10,10 +10,14 @@
 
 #include <vector>
 
+#include "UTEnum.hpp"
 #include "UTModelYieldCurve.hpp"
 #include "UTModelBlackSholesDynamics.hpp"
+#include "UTVolSurface.hpp"
 #include "UTProductCashflow.hpp"
+#include "UTProductSwap.hpp"
 #include "UTBisection.hpp"
+#include "UTNewton.hpp"
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -37,15 +41,48 @@ public:
 		const UTModelYieldCurve::UT_InterpolationMethod& interpMethod = UTModelYieldCurve::UT_FLAT,
 		const UTModelYieldCurve::UT_InterpolateeType& interpolateeType = UTModelYieldCurve::UT_FWD_RATE );
 
-	// Creates a 'calibrated' Black Dynamic model
+	// Creates a 'calibrated' Black Dynamic model, to the ATM forward calls of the maturities (in increasing order).
+	// Flat instantanious vols are the forward variances between the maturities (closed form), the other interpolations are solved pillar by pillar.
+	// residuals: if given, the PV of each ATM call in the model minus its PV with the implied vol.
 	static std::unique_ptr<UTModelBlackSholesDynamics> newModelBlackSholesDynamics(
 		double spotPrice,
 		const std::vector<double> &    optionMaturities,
 		const std::vector<double> &    impVols,
 		const std::shared_ptr<const UTModelYieldCurve>& subYieldCurveModel,
 		const UTModelBlackSholesDynamics::UT_InterpolationMethod& interpMethod = UTModelBlackSholesDynamics::UT_FLAT,
+		const UTModelBlackSholesDynamics::UT_InterpolateeType& interpolateeType = UTModelBlackSholesDynamics::UT_INST_VOL,
+		std::vector<double>* residuals = nullptr);
+
+	// Creates a Black Dynamic model which prices with the smile of the surface (see UTModelBlackSholesDynamics::vol(time, strike)),
+	// its vols calibrated to the ATM forward vols of the expiries of the surface as above. The expiries where the ATM total variance
+	// does not increase (a calendar arbitrage between the knots of the smiles) are left to the interpolation of the others.
+	static std::unique_ptr<UTModelBlackSholesDynamics> newModelBlackSholesDynamics(
+		double spotPrice,
+		const std::shared_ptr<const UTVolSurface>& volSurface,
+		const std::shared_ptr<const UTModelYieldCurve>& subYieldCurveModel,
+		const UTModelBlackSholesDynamics::UT_InterpolationMethod& interpMethod = UTModelBlackSholesDynamics::UT_FLAT,
 		const UTModelBlackSholesDynamics::UT_InterpolateeType& interpolateeType = UTModelBlackSholesDynamics::UT_INST_VOL);
 
+	// Creates the implied vol surface of a snapshot of option quotes (index i < n): the forward (undiscounted) premiums of calls, puts
+	// or straddles, with their forwards, strikes and times to expiry. The quotes of an expiry should have the same forward.
+	// - The quotes are inverted by UTEuropeanOptionLogNormal::blackImpliedSigmaBatch, on numberOfThreads ranges run by the thread pool
+	//   of the process (0: one per thread of UTThreadPool::pool()).
+	// - Each expiry (in parallel): the call and the put of a strike are averaged. The strikes whose total variance is far from the median
+	//   of their neighbours are rejected as outliers (an under-priced quote would be on the hull below and push its neighbours out of it),
+	//   then the strikes whose call price (from the call-put parity) is above the convex decreasing hull of the others, from the forward
+	//   at strike 0, are rejected (call spread and butterfly arbitrages).
+	// - Expiry after expiry: the knots whose total variance is below the smile of the previous expiry are rejected (calendar arbitrage).
+	// The smiles interpolate the total variances of the strikes left. accepted: if given, whether each quote is in the surface.
+	static std::shared_ptr<const UTVolSurface> newVolSurface(
+		const double* premiums,
+		const double* forwards,
+		const double* strikes,
+		const double* timesToExpiry,
+		const UT_CallPut* callPuts,
+		unsigned long n,
+		unsigned long numberOfThreads = 0,
+		std::vector<bool>* accepted = nullptr);
+
 
 };
 
@@ -107,6 +144,113 @@ private:
 	unsigned int myComponentNumber;
 };
 
+//////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+//Helper Class for the vol calibration - safeguarded Newton solution
+//
+// The vol of the pillar such that the variance of the model up to the maturity is the target (the implied total variance):
+// the ATM call prices then match. The slope is the analytic derivative of the variance.
+class UTSolveForVolPillar
+{
+public:
+
+	virtual ~UTSolveForVolPillar() {}
+
+	UTSolveForVolPillar(UTModelBlackSholesDynamics &model, double maturity, double targetVariance, unsigned int componentNumber)
+		:
+		myModel(model),
+		myMaturity(maturity),
+		myTargetVariance(targetVariance),
+		myComponentNumber(componentNumber) {}
+
+	// penalty function, and its slope
+	double error(double x, double& slope);
+
+	// Set the vol of the pillar in the model (the root once solved: the last x tried is not always the root)
+	void setVol(double x);
+
+private:
+
+	UTModelBlackSholesDynamics &	myModel;
+	double myMaturity;
+	double myTargetVariance;
+	unsigned int myComponentNumber;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+//Helper Class for the yield curve bootstrap - Newton solution
+//
+// The swap of a pillar receives its rate every 6 months up to the maturity of the pillar (short stub in front) against the float leg,
+// which is worth 1 - df(maturity) for a unit notional. So its PV is a sum of weights times the discount factors of the fixed cashflows, minus 1:
+// the weight is the rate times the accrued (plus 1 for the last cashflow). The cashflows of all the swaps are generated once in flat arrays,
+// with the derivatives of their lnDf with respect to the rate of the pillar (lnDf is linear in the rates), without any product or engine.
+// A pillar is solved by Newton on a sum of exponentials over the cashflows which depend on it, bisection as the fallback.
+class UTSolveForYieldCurve : public UTNewton
+{
+public:
+
+	virtual ~UTSolveForYieldCurve() {}
+
+	// The solver of all the pillars of the model: the maturities of the swaps are its time line
+	UTSolveForYieldCurve(UTModelYieldCurve &model, const std::vector<double>& swapMaturities, const std::vector<double>& swapRates);
+
+	// Bootstrap: solve the pillars from firstPillar on, in order, and repeat the pass until the rates settle (up to maxPasses times).
+	// Throw if no rate of a pillar reprices its swap, or if the passes run out before the curve reprices the swaps.
+	void bootstrap(unsigned long firstPillar = 0, unsigned long maxPasses = 1);
+
+	// Solve for the rate of the pillar given the other ones, set it in the model and return it (throw if there is none between -10% and 100%).
+	// The discount factors cached by the previous solve of the pillar are reused up to fromTime: the curve must not have moved before it since then.
+	double solve(unsigned long pillar, double fromTime = 0.0);
+
+	// Change the rate of the swap of the pillar (the swap rate quote)
+	void setSwapRate(unsigned long pillar, double swapRate);
+
+	// Set the rates of all the pillars of the model (to roll back a bootstrap which failed): the cached discount factors are dropped
+	void setRates(const std::vector<double>& ratePillars);
+
+	// The rate of the swap of the pillar
+	double swapRate(unsigned long pillar) const { return mySwapRates[pillar]; }
+
+	// The error of the swap rate of the pillar on the current curve: PV error / PV of the annuity
+	double swapRateError(unsigned long pillar) const;
+
+	// penalty function of the pillar being solved, and its ratio to the slope (for the Newton steps): valid once solve() has started
+	double error(double x);
+	virtual double valueSlopeRatio(double x);
+
+private:
+
+	UTModelYieldCurve &	myModel;
+	std::vector<double> mySwapRates;
+
+	// The cashflows of the swap of the pillar i are from myFirstFlows[i] to myFirstFlows[i + 1], in time order.
+	// Those from myFirstMovingFlows[i] on depend on the pillar (all of them for the cubic spline).
+	std::vector<unsigned long> myFirstFlows;
+	std::vector<unsigned long> myFirstMovingFlows;
+	std::vector<double> myTimes;
+	std::vector<double> myAccrued;
+	std::vector<double> myWeights;
+	std::vector<double> myRateDerivatives;
+
+	// The lnDf of the moving cashflows at the rate myRate, for the pillar being solved
+	std::vector<double> myLnDfs;
+
+	// The discount factors of the cashflows which do not depend on the pillar, and the partial sums of their PV
+	// (the sums of the swap i at myFirstFlows[i] + i on), kept between the solves
+	std::vector<double> myDfs;
+	std::vector<double> myPartialSums;
+
+	// Whether the cached discount factors of the pillar are set, and the first partial sum to update (the weights changed after it)
+	std::vector<bool> myDfsSet;
+	std::vector<unsigned long> myFirstStaleSums;
+
+	// The pillar being solved, its rate when the lnDfs were calculated, and the PV of its cashflows which do not depend on it (minus 1)
+	unsigned long myPillar;
+	double myRate;
+	double myConstantPv;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -5,6 +5,7 @@
 */
 
 #include "UTModelYieldCurve.hpp"
+#include <algorithm>
 
 using namespace std;
 
@@ -27,6 +28,7 @@ UTModelYieldCurve::UTModelYieldCurve()
 	: UTModelBase(), 
 	myTimeLine(1, 1.0), myRates(1, 0.03), myInterpolatee(UT_FWD_RATE), myInterpolationMethod(UT_FLAT)
 {
+	calculateInterpolation(myRates, myInterpolation);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -34,6 +36,7 @@ UTModelYieldCurve::UTModelYieldCurve(double flatRate)
 	: UTModelBase(),
 	myTimeLine(1, 1.0), myRates(1, flatRate), myInterpolatee(UT_FWD_RATE), myInterpolationMethod(UT_FLAT)
 {
+	calculateInterpolation(myRates, myInterpolation);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -44,6 +47,7 @@ UTModelYieldCurve::UTModelYieldCurve(const vector<double>&	 timeLine,
 	: UTModelBase(),
 	myTimeLine(timeLine), myRates(rates), myInterpolatee(interpolateeType), myInterpolationMethod(interpolationMethod)
 {
+	calculateInterpolation(myRates, myInterpolation);
 }
 ///////////////////////////////////////////////////////////////////////////////
 UTModelBase* UTModelYieldCurve::clone() const
@@ -67,39 +71,137 @@ double UTModelYieldCurve::forwardRate(double startTime, double endTime) const
 ///////////////////////////////////////////////////////////////////////////////
 double UTModelYieldCurve::lnDf(double time) const
 {
-	//Assuming piecewise flat forward rate interpolation..
-
 	if (time < 0.0)
 	{
 		return 0.0;
 	}
 
-	// Get the size of the time line.
-	auto gridSize = myTimeLine.size();
+	// The segment of the time: the first node at or after it
+	const vector<double>& nodes = myInterpolation.nodes;
+	unsigned long i = lower_bound(nodes.begin(), nodes.end(), time) - nodes.begin();
+
+	return lnDfFromNode(time, i, myInterpolation);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTModelYieldCurve::df(const double* times, double* result, unsigned long n) const
+{
+	lnDf(times, result, n);
+
+	for (unsigned long k = 0; k < n; ++k)
+		result[k] = exp(-1.0 * result[k]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTModelYieldCurve::lnDf(const double* times, double* result, unsigned long n) const
+{
+	const vector<double>& nodes = myInterpolation.nodes;
+	auto numberOfNodes = nodes.size();
+	unsigned long i = 0;
 	double previousTime = 0.0;
-	double currentTime = 0.0;
-	double sum = 0.0;
-	unsigned i = 0;
 
-	for (i = 0; i < gridSize; ++i)
+	for (unsigned long k = 0; k < n; ++k)
 	{
-		currentTime = myTimeLine[i];
-		if (currentTime <= time)
+		double time = times[k];
+
+		if (time < 0.0)
 		{
-			sum += myRates[i] * (currentTime - previousTime);
-			previousTime = currentTime;
+			result[k] = 0.0;
+			continue;
+		}
+
+		// Merge: the node moves forward with the times, a time out of order starts again with a binary search
+		if (time < previousTime)
+		{
+			i = lower_bound(nodes.begin(), nodes.end(), time) - nodes.begin();
 		}
 		else
 		{
-			//This means interpolation
-			return sum + myRates[i] * (time - previousTime);
+			while (i < numberOfNodes && nodes[i] < time)
+				++i;
+		}
+		previousTime = time;
 
+		result[k] = lnDfFromNode(time, i, myInterpolation);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTModelYieldCurve::lnDfRateDerivatives(const double* times, double* result, unsigned long n, unsigned long pillar) const
+{
+	vector<double> unitRates;
+	UTInterpolation<double> interpolation;
+	lnDfRateDerivatives(times, result, n, pillar, unitRates, interpolation);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTModelYieldCurve::lnDfRateDerivatives(const double* times, double* result, unsigned long n, unsigned long pillar,
+	vector<double>& unitRates, UTInterpolation<double>& interpolation) const
+{
+	if (pillar >= myRates.size())
+	{
+		throw runtime_error("UTModelYieldCurve: the pillar is out of the time line.");
+	}
+
+	unitRates.assign(myRates.size(), 0.0);
+	unitRates[pillar] = 1.0;
+
+	calculateInterpolation(unitRates, interpolation);
+
+	const vector<double>& nodes = interpolation.nodes;
+	for (unsigned long k = 0; k < n; ++k)
+	{
+		if (times[k] < 0.0)
+		{
+			result[k] = 0.0;
+			continue;
 		}
+
+		unsigned long i = lower_bound(nodes.begin(), nodes.end(), times[k]) - nodes.begin();
+		result[k] = lnDfFromNode(times[k], i, interpolation);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTModelYieldCurve::lastTimeIndependentOfPillar(unsigned long pillar) const
+{
+	if (pillar >= myRates.size())
+	{
+		throw runtime_error("UTModelYieldCurve: the pillar is out of the time line.");
+	}
+
+	if (myInterpolationMethod == UT_CUBIC_SPLINE)
+	{
+		return 0.0;
 	}
 
-	//This means exterpolation (i.e.,  input time > last grid point of time)
-	return sum + myRates[i-1] * (time - previousTime);
-			
+	// The flat and linear interpolations only move the segments next to the node of the pillar: the curve moves after the node before it
+	unsigned long node = pillar + (myInterpolation.nodes.size() - myRates.size());
+
+	return node > 0 ? myInterpolation.nodes[node - 1] : 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTModelYieldCurve::updateInterpolation(unsigned long pillar)
+{
+	// The spline is not local: all its coefficients move
+	if (myInterpolationMethod == UT_CUBIC_SPLINE)
+	{
+		calculateInterpolation(myRates, myInterpolation);
+		return;
+	}
+
+	const vector<double>& nodes = myInterpolation.nodes;
+	unsigned long node = pillar + (nodes.size() - myRates.size());
+	myInterpolation.values[node] = myInterpolatee == UT_MINUS_LOG_DF ? myRates[pillar] * myTimeLine[pillar] : myRates[pillar];
+
+	// The segments on both sides of the node
+	unsigned long firstSegment = node > 0 ? node - 1 : 0;
+	for (unsigned long k = firstSegment; k <= node && k + 1 < nodes.size(); ++k)
+		calculateLocalSegment(k, myInterpolation);
+
+	if (myInterpolatee == UT_FWD_RATE)
+		calculateCumulativeIntegrals(firstSegment, myInterpolation);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -7,6 +7,9 @@
 #ifndef UT_MODEL_YIELD_CURVE_H
 #define UT_MODEL_YIELD_CURVE_H
 
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include "UTModelBase.hpp"
@@ -59,25 +62,304 @@ public:
 	// Return the discount factor given a date
 	virtual double df( double time) const;
 
+	// Batch discount factors: a linear merge of the times with the time line when they are in increasing order
+	virtual void df(const double* times, double* result, unsigned long n) const;
+
 	// Return the forward rate given two dates  
 	virtual double forwardRate(double startTime, double endTime) const;
 
-	// Return log of DF
+	// Return log of DF: a binary search for the segment of the time line and its precomputed polynomial, O(log(number of pillars))
 	double lnDf(double time) const;
 
+	// Batch log of DF: a linear merge of the times with the time line when they are in increasing order
+	void lnDf(const double* times, double* result, unsigned long n) const;
+
+	// Batch derivatives of lnDf with respect to the rate of the pillar: lnDf is linear in the rates for every interpolation,
+	// so they do not depend on the rates (result[k] is lnDf(times[k]) of the curve with the rate 1 at the pillar and 0 elsewhere)
+	void lnDfRateDerivatives(const double* times, double* result, unsigned long n, unsigned long pillar) const;
+
+	// lnDf(time) does not depend on the rate of the pillar for time <= lastTimeIndependentOfPillar(pillar) (0 for the cubic spline, which is not local)
+	double lastTimeIndependentOfPillar(unsigned long pillar) const;
+
+	// The pillars
+	virtual const std::vector<double>& ratePillars() const { return myRates; }
+	virtual const UTModelYieldCurve* yieldCurve() const { return this; }
+
+	// The interpolation of the curve, for any number type.
+	// The interpolatee is known at the nodes: the pillars (with 0 first for UT_MINUS_LOG_DF, where the rates are the zero rates of the pillars).
+	// Between two nodes it is the cubic a + b d + c d^2 + e d^3, with d the time from the left node (4 coefficients per segment).
+	// It is flat before the first node, and flat after the last one (the zero rate is flat for UT_MINUS_LOG_DF).
+	// For UT_FWD_RATE, the integrals of the forward rate from 0 to the nodes are precomputed too.
+	template <class T>
+	struct UTInterpolation
+	{
+		std::vector<double> nodes;
+		std::vector<T> values;
+		std::vector<T> coefficients;
+		std::vector<T> cumulativeIntegrals;
+	};
+
+	// The interpolation of the rates of the curve
+	const UTInterpolation<double>& interpolation() const { return myInterpolation; }
+
+	// The interpolation of the given rate pillars instead of the ones of the curve, for any number type (double or UTAadNumber, see UTAad.hpp):
+	// the spline coefficients come from a tridiagonal solve. On the AAD tape, it is recorded once and shared by all the discount factors.
+	template <class T> void calculateInterpolation(const std::vector<T>& rates, UTInterpolation<T>& interpolation) const;
+
+	// lnDfRateDerivatives with the workspaces of the unit rates and of their interpolation given by the caller: no allocation when they are reused
+	void lnDfRateDerivatives(const double* times, double* result, unsigned long n, unsigned long pillar,
+		std::vector<double>& unitRates, UTInterpolation<double>& interpolation) const;
+
+	// The same functions from a given interpolation: a binary search for the segment and its cubic (a few nodes on the AAD tape)
+	template <class T> T lnDf(double time, const UTInterpolation<T>& interpolation) const;
+	template <class T> T df(double time, const UTInterpolation<T>& interpolation) const;
+	template <class T> T forwardRate(double startTime, double endTime, const UTInterpolation<T>& interpolation) const;
+
 private:
 
 	// solver in the calibration only use this.
-	virtual void setComponent(unsigned int i, double component) { myRates[i] = component; }
+	virtual void setComponent(unsigned int i, double component) { myRates[i] = component; updateInterpolation(i); }
+
+	// The coefficients of the segment k for the flat and linear interpolations, which only depend on the nodes at its ends
+	template <class T> void calculateLocalSegment(unsigned long k, UTInterpolation<T>& interpolation) const;
+
+	// The integrals of the forward rate up to the nodes after the segment firstSegment
+	template <class T> void calculateCumulativeIntegrals(unsigned long firstSegment, UTInterpolation<T>& interpolation) const;
+
+	// myInterpolation after a change of the rate of the pillar: only the segments next to it for the flat and linear interpolations
+	void updateInterpolation(unsigned long pillar);
+
+	// lnDf(time) from the node i, the first one at or after time (the number of nodes if none)
+	template <class T> T lnDfFromNode(double time, unsigned long i, const UTInterpolation<T>& interpolation) const;
 
 	//Yield Curve
 	std::vector<double> myTimeLine;
 	std::vector<double> myRates;
 
+	// The interpolation of myRates, calculated when the curve is built or a rate is set
+	UTInterpolation<double> myInterpolation;
+
 	UT_InterpolateeType myInterpolatee;
 	UT_InterpolationMethod myInterpolationMethod;
 
 };
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+//
+// template functions
+
+template <class T>
+T UTModelYieldCurve::lnDf(double time, const UTInterpolation<T>& interpolation) const
+{
+	if (time < 0.0)
+	{
+		return T(0.0);
+	}
+
+	unsigned long i = std::lower_bound(interpolation.nodes.begin(), interpolation.nodes.end(), time) - interpolation.nodes.begin();
+
+	return lnDfFromNode(time, i, interpolation);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <class T>
+T UTModelYieldCurve::lnDfFromNode(double time, unsigned long i, const UTInterpolation<T>& interpolation) const
+{
+	const std::vector<double>& nodes = interpolation.nodes;
+	const std::vector<T>& values = interpolation.values;
+	const unsigned long last = nodes.size() - 1;
+
+	if (myInterpolatee == UT_FWD_RATE)
+	{
+		// The integral of the forward rate
+		if (i == 0)
+		{
+			return values[0] * time;
+		}
+		else if (i > last)
+		{
+			//This means exterpolation (i.e.,  input time > last grid point of time)
+			return interpolation.cumulativeIntegrals[last] + values[last] * (time - nodes[last]);
+		}
+
+		const T* c = &interpolation.coefficients[4 * (i - 1)];
+		double d = time - nodes[i - 1];
+		return interpolation.cumulativeIntegrals[i - 1] + d * (c[0] + d * (c[1] * 0.5 + d * (c[2] / 3.0 + d * c[3] * 0.25)));
+	}
+
+	// The zero rate, or minus the log of the DF
+	T value(0.0);
+	if (i == 0)
+	{
+		value = values[0];
+	}
+	else if (i > last)
+	{
+		value = myInterpolatee == UT_MINUS_LOG_DF ? values[last] * (time / nodes[last]) : values[last];
+	}
+	else
+	{
+		const T* c = &interpolation.coefficients[4 * (i - 1)];
+		double d = time - nodes[i - 1];
+		value = c[0] + d * (c[1] + d * (c[2] + d * c[3]));
+	}
+
+	return myInterpolatee == UT_ZERO_RATE ? value * time : value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <class T>
+void UTModelYieldCurve::calculateInterpolation(const std::vector<T>& rates, UTInterpolation<T>& interpolation) const
+{
+	if (myTimeLine.empty() || rates.size() != myTimeLine.size())
+	{
+		throw std::runtime_error("UTModelYieldCurve: the time line and the rates must have the same (non zero) size.");
+	}
+	if (myInterpolatee != UT_FWD_RATE && myInterpolatee != UT_ZERO_RATE && myInterpolatee != UT_MINUS_LOG_DF)
+	{
+		throw std::runtime_error("UTModelYieldCurve: unknown interpolatee.");
+	}
+	if (myInterpolatee == UT_MINUS_LOG_DF && myInterpolationMethod == UT_FLAT)
+	{
+		// The discount factor would be flat between the pillars: zero forward rates, and all the interest at the pillars
+		throw std::runtime_error("UTModelYieldCurve: -log df cannot be flat, interpolate it linearly (log-linear discount factors).");
+	}
+
+	// The nodes and the interpolatee at the nodes
+	std::vector<double>& nodes = interpolation.nodes;
+	std::vector<T>& values = interpolation.values;
+	nodes.clear();
+	values.clear();
+
+	if (myInterpolatee == UT_MINUS_LOG_DF && myTimeLine[0] > 0.0)
+	{
+		nodes.push_back(0.0);
+		values.push_back(T(0.0));
+	}
+	for (unsigned long i = 0; i < myTimeLine.size(); ++i)
+	{
+		nodes.push_back(myTimeLine[i]);
+		values.push_back(myInterpolatee == UT_MINUS_LOG_DF ? rates[i] * myTimeLine[i] : rates[i]);
+	}
+
+	const unsigned long numberOfNodes = nodes.size();
+	for (unsigned long k = 0; k + 1 < numberOfNodes; ++k)
+	{
+		if (nodes[k + 1] < nodes[k] || (nodes[k + 1] == nodes[k] && myInterpolationMethod != UT_FLAT))
+		{
+			throw std::runtime_error("UTModelYieldCurve: the time line must be increasing.");
+		}
+	}
+
+	// The coefficients of the segments
+	std::vector<T>& coefficients = interpolation.coefficients;
+	coefficients.assign(4 * (numberOfNodes - 1), T(0.0));
+
+	if (myInterpolationMethod == UT_FLAT || myInterpolationMethod == UT_LINEAR)
+	{
+		for (unsigned long k = 0; k + 1 < numberOfNodes; ++k)
+			calculateLocalSegment(k, interpolation);
+	}
+	else if (myInterpolationMethod == UT_CUBIC_SPLINE)
+	{
+		// Natural spline: the second derivatives at the nodes solve a tridiagonal system (Thomas algorithm), 0 at the first and last nodes.
+		// The matrix only depends on the nodes, so its elimination is in double
+		std::vector<T> secondDerivatives(numberOfNodes, T(0.0));
+		if (numberOfNodes > 2)
+		{
+			std::vector<double> upper(numberOfNodes, 0.0);
+			std::vector<T> rightHandSide(numberOfNodes, T(0.0));
+
+			for (unsigned long j = 1; j + 1 < numberOfNodes; ++j)
+			{
+				double leftStep = nodes[j] - nodes[j - 1];
+				double rightStep = nodes[j + 1] - nodes[j];
+				double diagonal = 2.0 * (leftStep + rightStep) - leftStep * upper[j - 1];
+
+				upper[j] = rightStep / diagonal;
+				rightHandSide[j] = (6.0 * ((values[j + 1] - values[j]) / rightStep - (values[j] - values[j - 1]) / leftStep) - leftStep * rightHandSide[j - 1]) / diagonal;
+			}
+
+			for (unsigned long j = numberOfNodes - 2; j > 0; --j)
+				secondDerivatives[j] = rightHandSide[j] - upper[j] * secondDerivatives[j + 1];
+		}
+
+		for (unsigned long k = 0; k + 1 < numberOfNodes; ++k)
+		{
+			double step = nodes[k + 1] - nodes[k];
+			coefficients[4 * k] = values[k];
+			coefficients[4 * k + 1] = (values[k + 1] - values[k]) / step - step * (2.0 * secondDerivatives[k] + secondDerivatives[k + 1]) / 6.0;
+			coefficients[4 * k + 2] = secondDerivatives[k] * 0.5;
+			coefficients[4 * k + 3] = (secondDerivatives[k + 1] - secondDerivatives[k]) / (6.0 * step);
+		}
+	}
+	else
+	{
+		throw std::runtime_error("UTModelYieldCurve: unknown interpolation method.");
+	}
+
+	// The integrals of the forward rate up to the nodes
+	if (myInterpolatee == UT_FWD_RATE)
+	{
+		interpolation.cumulativeIntegrals.resize(numberOfNodes);
+		calculateCumulativeIntegrals(0, interpolation);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <class T>
+void UTModelYieldCurve::calculateLocalSegment(unsigned long k, UTInterpolation<T>& interpolation) const
+{
+	const std::vector<double>& nodes = interpolation.nodes;
+	const std::vector<T>& values = interpolation.values;
+	T* c = &interpolation.coefficients[4 * k];
+
+	if (myInterpolationMethod == UT_FLAT)
+	{
+		// The value of the right node on the whole segment
+		c[0] = values[k + 1];
+	}
+	else
+	{
+		c[0] = values[k];
+		c[1] = (values[k + 1] - values[k]) / (nodes[k + 1] - nodes[k]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <class T>
+void UTModelYieldCurve::calculateCumulativeIntegrals(unsigned long firstSegment, UTInterpolation<T>& interpolation) const
+{
+	const std::vector<double>& nodes = interpolation.nodes;
+	std::vector<T>& cumulativeIntegrals = interpolation.cumulativeIntegrals;
+
+	if (firstSegment == 0)
+		cumulativeIntegrals[0] = interpolation.values[0] * nodes[0];
+
+	for (unsigned long k = firstSegment; k + 1 < nodes.size(); ++k)
+	{
+		const T* c = &interpolation.coefficients[4 * k];
+		double h = nodes[k + 1] - nodes[k];
+		cumulativeIntegrals[k + 1] = cumulativeIntegrals[k] + h * (c[0] + h * (c[1] * 0.5 + h * (c[2] / 3.0 + h * c[3] * 0.25)));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <class T>
+T UTModelYieldCurve::df(double time, const UTInterpolation<T>& interpolation) const
+{
+	using std::exp;
+	return exp(-1.0 * lnDf(time, interpolation));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <class T>
+T UTModelYieldCurve::forwardRate(double startTime, double endTime, const UTInterpolation<T>& interpolation) const
+{
+	T rtn = df(startTime, interpolation) / df(endTime, interpolation) - 1.0;
+	return rtn / (endTime - startTime);
+}
+
 #endif // UT_MODEL_YIELD_CURVE_H
 
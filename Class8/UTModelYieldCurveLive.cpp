@@ -0,0 +1,80 @@
+/* UTModelYieldCurveLive.cpp
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#include <stdexcept>
+
+#include "UTModelYieldCurveLive.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+UTModelYieldCurveLive::UTModelYieldCurveLive(
+	const vector<double> &    swapMaturities,
+	const vector<double> &    swapRates,
+	UTModelYieldCurve::UT_InterpolationMethod interpMethod,
+	UTModelYieldCurve::UT_InterpolateeType interpolateeType)
+	:
+	mySwapMaturities(swapMaturities),
+	myInterpolationMethod(interpMethod),
+	myWorkingCurve(new UTModelYieldCurve(swapMaturities, swapRates, interpolateeType, interpMethod))
+{
+	// Check the size of the 2 vectors
+	if (swapMaturities.size() != swapRates.size())
+	{
+		throw runtime_error("UTModelYieldCurveLive: The size of swap maturities and rates should be the same.");
+	}
+
+	// The same swaps as the factory
+	mySolver.reset(new UTSolveForYieldCurve(*myWorkingCurve, swapMaturities, swapRates));
+	mySolver->bootstrap(0, myInterpolationMethod == UTModelYieldCurve::UT_CUBIC_SPLINE ? 200 : 1);
+	publish(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTModelYieldCurveLive::updateQuote(unsigned long i, double swapRate)
+{
+	if (i >= mySwapMaturities.size())
+	{
+		throw runtime_error("UTModelYieldCurveLive: There is no swap for this quote.");
+	}
+
+	lock_guard<mutex> lock(myUpdateMutex);
+
+	// The pillars before i do not depend on the swap i (but with the cubic spline)
+	double previousSwapRate = mySolver->swapRate(i);
+	try
+	{
+		mySolver->setSwapRate(i, swapRate);
+		mySolver->bootstrap(i, myInterpolationMethod == UTModelYieldCurve::UT_CUBIC_SPLINE ? 200 : 1);
+	}
+	catch (...)
+	{
+		// Back to the current version: its quote and its curve
+		mySolver->setSwapRate(i, previousSwapRate);
+		mySolver->setRates(myLatest->curve.ratePillars());
+		throw;
+	}
+
+	publish(myLatest->number + 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+shared_ptr<const UTModelYieldCurve> UTModelYieldCurveLive::curve() const
+{
+	shared_ptr<const UTVersion> version(latest());
+	return shared_ptr<const UTModelYieldCurve>(version, &version->curve);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTModelYieldCurveLive::publish(unsigned long number)
+{
+	// The number is published with the curve: a reader never sees one without the other
+	atomic_store(&myLatest, shared_ptr<const UTVersion>(make_shared<UTVersion>(*myWorkingCurve, number)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
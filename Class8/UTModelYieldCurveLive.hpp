@@ -0,0 +1,94 @@
+/* UTModelYieldCurveLive.h
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#ifndef UT_MODEL_YIELD_CURVE_LIVE_H
+#define UT_MODEL_YIELD_CURVE_LIVE_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "UTModelYieldCurve.hpp"
+#include "UTModelFactory.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// UTModelYieldCurveLive
+//
+// A yield curve calibrated to swap quotes which tick one at a time.
+// An update re-bootstraps from the pillar of the quote on (all the pillars for the cubic spline), with the solver built once:
+// their discount factors before the pillar, and the partial sums of the PV over them, are reused.
+// Each update publishes a new immutable version of the curve, numbered with it: the readers take it with curve() or latest()
+// at any time, from any thread, and keep it as long as they need, whatever the updates after.
+//
+class UTModelYieldCurveLive
+{
+public:
+
+	// A published version: the curve and its number, built and published together (a single allocation)
+	struct UTVersion
+	{
+		UTVersion(const UTModelYieldCurve& curve, unsigned long number) : curve(curve), number(number) {}
+
+		const UTModelYieldCurve curve;
+		const unsigned long number;
+	};
+
+	// Destructor.
+	virtual ~UTModelYieldCurveLive() {}
+
+	// Constructor: the curve calibrated to the swaps (the same as UTModelFactory::newModelYieldCurve), version 0
+	UTModelYieldCurveLive(
+		const std::vector<double> &    swapMaturities,
+		const std::vector<double> &    swapRates,
+		UTModelYieldCurve::UT_InterpolationMethod interpMethod = UTModelYieldCurve::UT_FLAT,
+		UTModelYieldCurve::UT_InterpolateeType interpolateeType = UTModelYieldCurve::UT_FWD_RATE);
+
+	// Update the rate of the swap i, re-calibrate and publish the new version.
+	// If the calibration throws, the quote and the working curve are rolled back to the current version and nothing is published.
+	void updateQuote(unsigned long i, double swapRate);
+
+	// The current version, with its number
+	std::shared_ptr<const UTVersion> latest() const { return std::atomic_load(&myLatest); }
+
+	// The curve of the current version (it keeps the whole version alive)
+	std::shared_ptr<const UTModelYieldCurve> curve() const;
+
+	// The number of updates published
+	unsigned long version() const { return latest()->number; }
+
+	// Accessors.
+	const std::vector<double>& swapMaturities() const { return mySwapMaturities; }
+
+protected:
+
+	// Publish a copy of the working curve as the version number
+	void publish(unsigned long number);
+
+private:
+
+	// Not copyable: the solver refers to the working curve
+	UTModelYieldCurveLive(const UTModelYieldCurveLive&);
+	UTModelYieldCurveLive& operator=(const UTModelYieldCurveLive&);
+
+	std::vector<double> mySwapMaturities;
+	UTModelYieldCurve::UT_InterpolationMethod myInterpolationMethod;
+
+	// The curve the solver calibrates (never seen by the readers) and the solver
+	std::unique_ptr<UTModelYieldCurve> myWorkingCurve;
+	std::unique_ptr<UTSolveForYieldCurve> mySolver;
+
+	// The published version (atomic_load and atomic_store only)
+	std::shared_ptr<const UTVersion> myLatest;
+
+	// The updates are calibrated one at a time
+	std::mutex myUpdateMutex;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // UT_MODEL_YIELD_CURVE_LIVE_H
@@ -9,6 +9,7 @@
 
 #include <float.h>
 #include <cmath>
+#include <stdexcept>
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -52,6 +53,100 @@ public:
 	}
 };
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Third order Householder step for f(x) = 0 from f and its first 3 derivatives at x[n]: returns x[n+1] - x[n].
+// Converges in the third order (Newton: f2 = f3 = 0, second order).
+//
+inline double householderStep(double f, double f1, double f2, double f3)
+{
+	double nu = -f / f1;
+	double h2 = f2 / f1;
+	double h3 = f3 / f1;
+
+	return nu * (1.0 + 0.5 * h2 * nu) / (1.0 + nu * (h2 + h3 * nu / 6.0));
+}
+
+// The same step for 1 / log(f(x)) = 1 / logTarget, with f in (0, 1): much closer to linear than f when f(x) behaves like exp(-1/x^2)
+inline double householderStepInverseLog(double f, double f1, double f2, double f3, double logTarget)
+{
+	double l = std::log(f);
+	double l1 = f1 / f;
+	double l2 = f2 / f - l1 * l1;
+	double l3 = f3 / f - 3.0 * l1 * f2 / f + 2.0 * l1 * l1 * l1;
+
+	return householderStep(1.0 / l - 1.0 / logTarget,
+		-l1 / (l * l),
+		(2.0 * l1 * l1 / l - l2) / (l * l),
+		(-l3 + (6.0 * l1 * l2 - 6.0 * l1 * l1 * l1 / l) / l) / (l * l));
+}
+
+// The same step for -log(limit - f(x)) = -log(limit - target), with f(x) < limit: much closer to linear than f when limit - f(x) decays like a tail
+inline double householderStepLogDistance(double f, double f1, double f2, double f3, double limit, double target)
+{
+	double d = limit - f;
+	double g1 = f1 / d;
+	double g2 = f2 / d + g1 * g1;
+	double g3 = f3 / d + 3.0 * g1 * f2 / d + 2.0 * g1 * g1 * g1;
+
+	return householderStep(std::log((limit - target) / d), g1, g2, g3);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Template solution: safeguarded Newton
+//
+// theObject.error(x, slope) returns f(x) and sets slope to f'(x). f(x1) and f(x2) must have opposite signs.
+// The Newton steps are kept inside the bracket of the root, which shrinks at each step: a step which would leave it is a bisection instead.
+//
+template<typename T>
+double safeguardedNewton(T & theObject, double x1 /*low*/, double x2 /*high*/, double accuracy = 15 * DBL_EPSILON, unsigned long maxIterations = 100)
+{
+	double slope;
+	double f1 = theObject.error(x1, slope);
+	double f2 = theObject.error(x2, slope);
+
+	if (f1 == 0.0)
+		return x1;
+	if (f2 == 0.0)
+		return x2;
+	if (f1 * f2 > 0.0)
+	{
+		throw std::runtime_error("safeguardedNewton: The root is not bracketed.");
+	}
+
+	// x1 is the end of the bracket where f is negative
+	if (f1 > 0.0)
+	{
+		double x = x1;
+		x1 = x2;
+		x2 = x;
+	}
+
+	double x = 0.5 * (x1 + x2);
+	for (unsigned long i = 0; i < maxIterations; ++i)
+	{
+		double f = theObject.error(x, slope);
+		if (f == 0.0)
+			return x;
+
+		if (f < 0.0)
+			x1 = x;
+		else
+			x2 = x;
+
+		double newX = x - f / slope;
+		if (!(slope != 0.0 && (newX - x1) * (newX - x2) < 0.0))
+			newX = 0.5 * (x1 + x2);
+
+		if (fabs(newX - x) <= accuracy)
+			return newX;
+		x = newX;
+	}
+
+	throw std::runtime_error("safeguardedNewton: Root search did not converge.");
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
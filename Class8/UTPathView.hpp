@@ -0,0 +1,50 @@
+/* UTPathView.h
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#ifndef UT_PATH_VIEW_H
+#define UT_PATH_VIEW_H
+
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Non owning view of the spot prices of one path: the i-th price is data[i * stride], or data[indices[i] * stride] with an index map.
+// A path of a structure of arrays block (one column) is viewed in situ, without being copied,
+// and the index map gives the sub path of a product observing only some of the times of the path.
+// The viewed data (and the index map) must outlive the view.
+class UTPathView
+{
+public:
+
+	// Constructors.
+	UTPathView(const double * data, unsigned long size, unsigned long stride = 1)
+		: myData(data), mySize(size), myStride(stride), myIndices(nullptr) {}
+
+	// View of a whole vector (implicit, so a vector can be given where a view is expected)
+	UTPathView(const std::vector<double> & values)
+		: myData(values.empty() ? nullptr : &values[0]), mySize(values.size()), myStride(1), myIndices(nullptr) {}
+
+	// View of the elements indices[i] of a path (which must not have an index map itself)
+	UTPathView(const UTPathView & path, const std::vector<unsigned long> & indices)
+		: myData(path.myData), mySize(indices.size()), myStride(path.myStride), myIndices(indices.empty() ? nullptr : &indices[0]) {}
+
+	// Accessors
+	double operator[](unsigned long i) const { return myData[(myIndices ? myIndices[i] : i) * myStride]; }
+	unsigned long size() const { return mySize; }
+	unsigned long stride() const { return myStride; }
+
+private:
+
+	const double * myData;
+	unsigned long mySize;
+	unsigned long myStride;
+	const unsigned long * myIndices;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // UT_PATH_VIEW_H
@@ -12,13 +12,13 @@ const vector<double>& UTProductBase::timeLine() const
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-const vector<double> UTProductBase::cashflowPayTimes() const
+const vector<double>& UTProductBase::cashflowPayTimes() const
 {
 	throw runtime_error("UTProductBase::cashflowPayTimes() base class function cannot be called.");
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-unsigned long UTProductBase::payoffs(const vector<double> spotPrices, vector<UTCashflows_t> &cashflows) const
+unsigned long UTProductBase::payoffs(const UTPathView & spotPrices, vector<UTCashflows_t> &cashflows) const
 {
 	throw runtime_error("UTProductBase::payoffs() base class function cannot be called.");
 }
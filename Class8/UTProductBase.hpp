@@ -9,6 +9,7 @@
 
 #include <string>
 #include <vector>
+#include "UTPathView.hpp"
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -33,8 +34,11 @@ public:
 
 	//Virtual functions.
 	virtual const std::vector<double>& timeLine() const;
-	virtual const std::vector<double> cashflowPayTimes() const;
-	virtual unsigned long payoffs(const std::vector<double> spotPrices, std::vector<UTCashflows_t> &cashflows) const;
+	virtual const std::vector<double>& cashflowPayTimes() const;
+
+	// The cashflows of one path of spot prices (observed at the timeLine()) written into the given buffer,
+	// which has at least cashflowPayTimes().size() elements. Returns the number of cashflows. Called once per path: must not allocate.
+	virtual unsigned long payoffs(const UTPathView & spotPrices, std::vector<UTCashflows_t> &cashflows) const;
 
 };
 
@@ -16,14 +16,7 @@ const string UTProductEuropeanOptionPut::ourClassTag = "European Put Option";
 const string UTProductEuropeanOptionStraddle::ourClassTag = "European Straddle Option";
 
 ///////////////////////////////////////////////////////////////////////////////
-const vector<double> UTProductEuropeanOptionBase::cashflowPayTimes() const
-{
-	vector<double> rtn(1, myExpiryTime);
-	return rtn;
-}
-
-///////////////////////////////////////////////////////////////////////////////
-unsigned long UTProductEuropeanOptionBase::payoffs(const vector<double> spotPrices, vector<UTCashflows_t> &cashflows) const
+unsigned long UTProductEuropeanOptionBase::payoffs(const UTPathView & spotPrices, vector<UTCashflows_t> &cashflows) const
 {
 
 	cashflows[0].first = 0; //time index
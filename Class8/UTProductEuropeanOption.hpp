@@ -27,7 +27,7 @@ public:
 		double  expiryTime,
 		double notional,
 		UT_BuySell  buySell)
-		: UTProductBase(), myExpiryTime(expiryTime), myNotional(notional), myBuySell(buySell), myTimeLine(1, expiryTime){}
+		: UTProductBase(), myExpiryTime(expiryTime), myNotional(notional), myBuySell(buySell), myTimeLine(1, expiryTime), myCashflowPayTimes(1, expiryTime){}
 
 	// Inherited from  UTProductBase.
 
@@ -37,8 +37,8 @@ public:
 	virtual double lastTime() const { return myExpiryTime; }
 
 	virtual const std::vector<double>& timeLine() const { return myTimeLine; }
-	virtual unsigned long payoffs(const std::vector<double> spotPrices, std::vector<UTCashflows_t> &cashflows) const;
-	virtual const std::vector<double> cashflowPayTimes() const;
+	virtual unsigned long payoffs(const UTPathView & spotPrices, std::vector<UTCashflows_t> &cashflows) const;
+	virtual const std::vector<double>& cashflowPayTimes() const { return myCashflowPayTimes; }
 
 	// Accessors
 	double expiryTime() const { return myExpiryTime; }
@@ -52,6 +52,7 @@ private:
 	UT_BuySell			myBuySell;
 
 	std::vector<double>	myTimeLine;
+	std::vector<double>	myCashflowPayTimes;
 
 };
 
@@ -153,8 +154,8 @@ public:
 	// to resolve ambiguity from 2 basess
 	virtual double firstTime() const { return myCallOption->firstTime(); }
 	virtual double lastTime() const  { return myCallOption->lastTime(); }
-	virtual unsigned long payoffs(const std::vector<double> spotPrices, std::vector<UTCashflows_t> &cashflows) const { return UTProductEuropeanOptionBase::payoffs(spotPrices, cashflows); }
-	virtual const std::vector<double> cashflowPayTimes() const { return UTProductEuropeanOptionBase::cashflowPayTimes(); }
+	virtual unsigned long payoffs(const UTPathView & spotPrices, std::vector<UTCashflows_t> &cashflows) const { return UTProductEuropeanOptionBase::payoffs(spotPrices, cashflows); }
+	virtual const std::vector<double>& cashflowPayTimes() const { return UTProductEuropeanOptionBase::cashflowPayTimes(); }
 	virtual const std::vector<double> &timeLine() const { return UTProductEuropeanOptionBase::timeLine(); }
 
 	virtual double payoff(double spot) const { return myCallOption->payoff(spot) + myPutOption->payoff(spot); }
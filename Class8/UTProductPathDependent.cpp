@@ -26,7 +26,7 @@ UTProductPathDependentAsian::UTProductPathDependentAsian(
 	double strike,
 	UT_AverageType averageMethod )
 	: UTProductPathDependentBase(notional, buySell),
-	myAverageStartTime(averageStartTime), myExpiryTime(expiryTime), myNumberOfAverage(numberOfAverage), myCallPut(callPut), myStrike(strike), myAverageType(averageMethod)
+	myAverageStartTime(averageStartTime), myExpiryTime(expiryTime), myNumberOfAverage(numberOfAverage), myCallPut(callPut), myStrike(strike), myAverageType(averageMethod), myCashflowPayTimes(1, expiryTime)
 {
 	// Check the relation of strat date and end date
 	if (averageStartTime >= expiryTime)
@@ -41,7 +41,7 @@ UTProductPathDependentAsian::UTProductPathDependentAsian(
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-unsigned long UTProductPathDependentAsian::payoffs(const vector<double> spotPrices, vector<UTCashflows_t> &cashflows) const
+unsigned long UTProductPathDependentAsian::payoffs(const UTPathView & spotPrices, vector<UTCashflows_t> &cashflows) const
 {
 	double sum = 0.0;
 	double prod = 1.0;
@@ -93,12 +93,5 @@ unsigned long UTProductPathDependentAsian::payoffs(const vector<double> spotPric
 	return 1;  //return the number of cashflows.
 }
 
-///////////////////////////////////////////////////////////////////////////////
-const std::vector<double> UTProductPathDependentAsian::cashflowPayTimes() const 
-{
-	vector<double> rtn(1, myExpiryTime);
-	return rtn;
-}
-
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -76,8 +76,8 @@ public:
 	virtual std::string classTag() const { return ourClassTag; }
 	virtual double firstTime() const { return myAverageStartTime; }
 	virtual double lastTime() const { return myExpiryTime; }
-	virtual unsigned long payoffs(const std::vector<double> spotPrices, std::vector<UTCashflows_t> &cashflows) const;
-	virtual const std::vector<double> cashflowPayTimes() const;
+	virtual unsigned long payoffs(const UTPathView & spotPrices, std::vector<UTCashflows_t> &cashflows) const;
+	virtual const std::vector<double>& cashflowPayTimes() const { return myCashflowPayTimes; }
 
 
 	// accessors   
@@ -96,6 +96,7 @@ private:
 	UT_CallPut myCallPut;
 	double  myStrike;
 	UT_AverageType myAverageType;
+	std::vector<double> myCashflowPayTimes;
 
 };
 
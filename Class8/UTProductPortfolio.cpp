@@ -0,0 +1,198 @@
+/* UTProductPortfolio.cpp
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "UTProductPortfolio.hpp"
+#include "UTProductEuropeanOption.hpp"
+#include "UTProductPathDependent.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// The classs tag
+const string UTProductPortfolio::ourClassTag = "Portfolio";
+const string UTProductStrikeGrid::ourClassTag = "Strike Grid";
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructor: the union of the time lines, the index maps and the cashflow offsets
+UTProductPortfolio::UTProductPortfolio(const vector<shared_ptr<const UTProductBase> >& products)
+	: UTProductLinearBase(products)
+{
+	if (products.empty())
+	{
+		throw runtime_error("UTProductPortfolio: the portfolio is empty.");
+	}
+
+	// The union of the time lines (sorted, each time once)
+	for (unsigned long i = 0; i < products.size(); ++i)
+	{
+		if (dynamic_cast<const UTProductPortfolio*>(products[i].get()))
+		{
+			throw runtime_error("UTProductPortfolio: a portfolio cannot contain a portfolio.");
+		}
+
+		const vector<double>& timeLine = products[i]->timeLine();
+		myTimeLine.insert(myTimeLine.end(), timeLine.begin(), timeLine.end());
+	}
+	sort(myTimeLine.begin(), myTimeLine.end());
+	myTimeLine.erase(unique(myTimeLine.begin(), myTimeLine.end()), myTimeLine.end());
+
+	// The index maps and the cashflow pay times (product after product)
+	myTimeIndices.resize(products.size());
+	myCashflowOffsets.resize(products.size() + 1, 0);
+
+	for (unsigned long i = 0; i < products.size(); ++i)
+	{
+		const vector<double>& timeLine = products[i]->timeLine();
+		myTimeIndices[i].resize(timeLine.size());
+		for (unsigned long j = 0; j < timeLine.size(); ++j)
+		{
+			myTimeIndices[i][j] = lower_bound(myTimeLine.begin(), myTimeLine.end(), timeLine[j]) - myTimeLine.begin();
+		}
+
+		const vector<double>& payTimes = products[i]->cashflowPayTimes();
+		myCashflowPayTimes.insert(myCashflowPayTimes.end(), payTimes.begin(), payTimes.end());
+		myCashflowOffsets[i + 1] = myCashflowPayTimes.size();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Each product writes its cashflows from the position 0 of the buffer. The products are called from the last one,
+// and the cashflows of the product i are moved to their own range [offset(i), offset(i + 1)), above the positions [0, offset(i + 1) - offset(i))
+// the next product (i - 1) writes to. So no other buffer is needed. The unused positions of a range get zero cashflows.
+unsigned long UTProductPortfolio::payoffs(const UTPathView & spotPrices, vector<UTCashflows_t> &cashflows) const
+{
+	for (unsigned long i = size(); i-- > 0;)
+	{
+		unsigned long offset = myCashflowOffsets[i];
+		unsigned long numberOfFlows = underlying(i)->payoffs(UTPathView(spotPrices, myTimeIndices[i]), cashflows);
+
+		// Backwards, as the destination is above the source
+		for (unsigned long j = numberOfFlows; j-- > 0;)
+		{
+			cashflows[offset + j].first = cashflows[j].first + offset;
+			cashflows[offset + j].second = cashflows[j].second;
+		}
+
+		for (unsigned long j = offset + numberOfFlows; j < myCashflowOffsets[i + 1]; ++j)
+		{
+			cashflows[j].first = offset;
+			cashflows[j].second = 0.0;
+		}
+	}
+
+	return myCashflowPayTimes.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// UTProductStrikeGrid
+
+UTProductStrikeGrid::UTProductStrikeGrid(const UTProductBase & shape, const vector<double>& strikes)
+	: UTProductPortfolio(newProducts(shape, strikes)),
+	myStrikes(strikes),
+	myAverageType(UT_AverageType::UT_INVALID_AVERAGE_TYPE),
+	myNumberOfAverage(1.0)
+{
+	if (shape.classTag() == UTProductPathDependentAsian::ourClassTag)
+	{
+		const UTProductPathDependentAsian& asian = dynamic_cast<const UTProductPathDependentAsian&>(shape);
+		myCallPut = asian.callPut() == UT_CallPut::UT_CALL ? 1.0 : -1.0;
+		myScale = asian.notional() * static_cast<int>(asian.buySell());
+		myAverageType = asian.averageType();
+		myNumberOfAverage = static_cast<double>(asian.numberOfAverage());
+	}
+	else
+	{
+		const UTProductEuropeanOptionBase& european = dynamic_cast<const UTProductEuropeanOptionBase&>(shape);
+		myCallPut = shape.classTag() == UTProductEuropeanOptionCall::ourClassTag ? 1.0 : -1.0;
+		myScale = european.notional() * static_cast<double>(european.buySell());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+vector<shared_ptr<const UTProductBase> > UTProductStrikeGrid::newProducts(const UTProductBase & shape, const vector<double>& strikes)
+{
+	if (strikes.empty())
+	{
+		throw runtime_error("UTProductStrikeGrid: the strike grid is empty.");
+	}
+
+	vector<shared_ptr<const UTProductBase> > products(strikes.size());
+
+	for (unsigned long i = 0; i < strikes.size(); ++i)
+	{
+		if (shape.classTag() == UTProductEuropeanOptionCall::ourClassTag)
+		{
+			const UTProductEuropeanOptionCall& call = dynamic_cast<const UTProductEuropeanOptionCall&>(shape);
+			products[i].reset(new UTProductEuropeanOptionCall(call.expiryTime(), call.notional(), call.buySell(), strikes[i]));
+		}
+		else if (shape.classTag() == UTProductEuropeanOptionPut::ourClassTag)
+		{
+			const UTProductEuropeanOptionPut& put = dynamic_cast<const UTProductEuropeanOptionPut&>(shape);
+			products[i].reset(new UTProductEuropeanOptionPut(put.expiryTime(), put.notional(), put.buySell(), strikes[i]));
+		}
+		else if (shape.classTag() == UTProductPathDependentAsian::ourClassTag)
+		{
+			const UTProductPathDependentAsian& asian = dynamic_cast<const UTProductPathDependentAsian&>(shape);
+			products[i].reset(new UTProductPathDependentAsian(asian.averageStartTime(), asian.expiryTime(), asian.numberOfAverage(), asian.notional(),
+				asian.callPut(), asian.buySell(), strikes[i], asian.averageType()));
+		}
+		else
+		{
+			throw runtime_error("UTProductStrikeGrid: the shape should be a European call, a European put or an Asian option.");
+		}
+	}
+
+	return products;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// All the options have the same time line, so the path is the path of each option
+unsigned long UTProductStrikeGrid::payoffs(const UTPathView & spotPrices, vector<UTCashflows_t> &cashflows) const
+{
+	// The level, once per path (same calculation as the option payoff)
+	double level;
+	if (myAverageType == UT_AverageType::UT_ARITHMETIC)
+	{
+		double sum = 0.0;
+		for (unsigned long i = 0; i < spotPrices.size(); ++i)
+			sum += spotPrices[i];
+
+		level = sum / myNumberOfAverage;
+	}
+	else if (myAverageType == UT_AverageType::UT_GEOMETRIC)
+	{
+		double prod = 1.0;
+		for (unsigned long i = 0; i < spotPrices.size(); ++i)
+			prod *= spotPrices[i];
+
+		level = pow(prod, 1.0 / myNumberOfAverage);
+	}
+	else
+	{
+		level = spotPrices[0];
+	}
+
+	// The payoffs of all the strikes
+	unsigned long numberOfStrikes = myStrikes.size();
+	const double * strikes = &myStrikes[0];
+	for (unsigned long i = 0; i < numberOfStrikes; ++i)
+	{
+		double intrinsic = myCallPut * (level - strikes[i]);
+		cashflows[i].first = i;
+		cashflows[i].second = myScale * (intrinsic > 0.0 ? intrinsic : 0.0);
+	}
+
+	return numberOfStrikes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
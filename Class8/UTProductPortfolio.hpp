@@ -0,0 +1,98 @@
+/* UTProductPortfolio.h
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#ifndef  UT_PRODUCT_PORTFOLIO_H
+#define  UT_PRODUCT_PORTFOLIO_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "UTEnum.hpp"
+#include "UTProductSwap.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// UTProductPortfolio
+//
+// A portfolio of products on the same underlying, valued on one set of paths.
+// The time line is the union of the time lines of the products and each product reads its own times through an index map.
+// The cashflows of the product i are at the positions [cashflowOffset(i), cashflowOffset(i + 1)) of the cashflows,
+// so the engines can report the PV of each product as well as the total.
+class UTProductPortfolio : public UTProductLinearBase
+{
+public:
+
+	// The class name string.
+	static const std::string ourClassTag;
+
+	// Destructor.
+	virtual ~UTProductPortfolio() {}
+
+	// Constructors.
+	UTProductPortfolio(const std::vector<std::shared_ptr<const UTProductBase> >& products);
+
+	// Inherited from UTProductBase
+	virtual std::string classTag() const { return ourClassTag; }
+	virtual const std::vector<double>& timeLine() const { return myTimeLine; }
+	virtual const std::vector<double>& cashflowPayTimes() const { return myCashflowPayTimes; }
+	virtual unsigned long payoffs(const UTPathView & spotPrices, std::vector<UTCashflows_t> &cashflows) const;
+
+	// Accessors
+	// The i-th time of the product lProduct is timeLine()[timeIndices(lProduct)[i]]
+	const std::vector<unsigned long>& timeIndices(unsigned long lProduct) const { return myTimeIndices[lProduct]; }
+	unsigned long cashflowOffset(unsigned long lProduct) const { return myCashflowOffsets[lProduct]; }
+
+private:
+
+	std::vector<double> myTimeLine;
+	std::vector<double> myCashflowPayTimes;
+	std::vector<std::vector<unsigned long> > myTimeIndices;
+	std::vector<unsigned long> myCashflowOffsets;  // size() + 1 offsets
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// UTProductStrikeGrid
+//
+// The options of one shape (European call, European put or Asian option) at a grid of strikes.
+// It is the portfolio of these options, but the payoffs calculate the level the option is struck on
+// (the spot at expiry or the average) once per path, and then the payoffs of all the strikes in one loop.
+class UTProductStrikeGrid : public UTProductPortfolio
+{
+public:
+
+	// The class name string.
+	static const std::string ourClassTag;
+
+	// Destructor.
+	virtual ~UTProductStrikeGrid() {}
+
+	// Constructors.
+	UTProductStrikeGrid(const UTProductBase & shape, const std::vector<double>& strikes);
+
+	// Inherited from UTProductBase
+	virtual std::string classTag() const { return ourClassTag; }
+	virtual unsigned long payoffs(const UTPathView & spotPrices, std::vector<UTCashflows_t> &cashflows) const;
+
+	// Accessors
+	const std::vector<double>& strikes() const { return myStrikes; }
+
+private:
+
+	// The options of the shape at each strike
+	static std::vector<std::shared_ptr<const UTProductBase> > newProducts(const UTProductBase & shape, const std::vector<double>& strikes);
+
+	std::vector<double> myStrikes;
+	double myCallPut;             // +1 for call, -1 for put
+	double myScale;               // notional * buy/sell
+	UT_AverageType myAverageType; // UT_INVALID_AVERAGE_TYPE for a European option (the level is the spot at expiry)
+	double myNumberOfAverage;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // UT_PRODUCT_PORTFOLIO_H
@@ -8,6 +8,11 @@
 
 using namespace std;
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// The class tag
+const string UTRandomAntitheticVariates::ourClassTag = "Antithetic";
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 UTRandomAntitheticVariates::UTRandomAntitheticVariates(const UTWrapper<UTRandomBase>& generator)
@@ -66,11 +71,15 @@ void UTRandomAntitheticVariates::skip(unsigned long numberOfPaths)
 
 	myGenerator->skip(numberOfPaths / 2);
 
+	// The first path of a pair: its antithetic is the next one (no allocation)
 	if (numberOfPaths % 2)
 	{
-		vector<double> tmp(dimensionality());
+		myGenerator->nextUniformVector(myNextVariates);
 
-		nextUniformVector(tmp);
+		for (unsigned long i = 0; i < dimensionality(); ++i)
+			myNextVariates[i] = 1.0 - myNextVariates[i];
+
+		myOddEven = false;
 	}
 
 }
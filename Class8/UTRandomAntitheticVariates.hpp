@@ -17,10 +17,17 @@ class UTRandomAntitheticVariates : public UTRandomBase
 
 public:
 
+	static std::string const ourClassTag;
+
 	UTRandomAntitheticVariates(const UTWrapper<UTRandomBase>& generator);
 
 	virtual UTRandomBase* clone() const;
 
+	// The tag of the generator of the variates after ours, and its seed
+	virtual std::string classTag() const { return ourClassTag + " " + myGenerator->classTag(); }
+	virtual unsigned long seed() const { return myGenerator->seed(); }
+
+
 	virtual void nextUniformVector(std::vector<double>& variates);
 
 	virtual void skip(unsigned long numberOfPaths);
@@ -13,6 +13,7 @@ using namespace std;
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 UTRandomBase::UTRandomBase()
+	: myDimensionality(0)
 {
 }
 
@@ -26,10 +27,32 @@ void UTRandomBase::nextGaussianVector(vector<double>& variates)
 {
 	nextUniformVector(variates);
 
-	for (unsigned long i = 0; i < myDimensionality; i++)
+	if (myDimensionality > 0)
+		UTMathFunctions::inverseCumulativeNormal(&variates[0], &variates[0], myDimensionality);
+}
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomBase::nextUniformBlock(unsigned long numberOfPaths, vector<double>& block, unsigned long stride)
+{
+	myVariates.resize(myDimensionality);
+
+	for (unsigned long j = 0; j < numberOfPaths; ++j)
+	{
+		nextUniformVector(myVariates);
+
+		for (unsigned long i = 0; i < myDimensionality; ++i)
+			block[i * stride + j] = myVariates[i];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomBase::nextGaussianBlock(unsigned long numberOfPaths, vector<double>& block, unsigned long stride)
+{
+	nextUniformBlock(numberOfPaths, block, stride);
+
+	if (numberOfPaths > 0)
 	{
-		double x = variates[i];
-		variates[i] = UTMathFunctions::inverseCumulativeNormal(x);
+		for (unsigned long i = 0; i < myDimensionality; ++i)
+			UTMathFunctions::inverseCumulativeNormal(&block[i * stride], &block[i * stride], numberOfPaths);
 	}
 }
 ///////////////////////////////////////////////////////////////////////////////
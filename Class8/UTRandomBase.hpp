@@ -7,12 +7,16 @@
 #ifndef UT_RANDOM_BASE_H
 #define UT_RANDOM_BASE_H
 
+#include <string>
 #include <vector>
 
 class UTRandomBase
 {
 public:
 
+	// Destructor: the generators are deleted through the base class (UTWrapper<UTRandomBase>)
+	virtual ~UTRandomBase() {}
+
 	UTRandomBase();
 
 	UTRandomBase(unsigned long Dimensionality);
@@ -20,6 +24,11 @@ public:
 	unsigned long dimensionality() const{ return myDimensionality; }
 
 	virtual UTRandomBase* clone() const = 0;
+
+	// The type of the generator and its seed: together, they identify the stream of numbers (see the Monte Carlo checkpoints)
+	virtual std::string classTag() const = 0;
+	virtual unsigned long seed() const = 0;
+
 	virtual void nextUniformVector(std::vector<double>& variates) = 0;
 	virtual void skip(unsigned long numberOfPaths) = 0;
 	virtual void setSeed(unsigned long Seed) = 0;
@@ -28,9 +37,17 @@ public:
 	virtual void nextGaussianVector(std::vector<double>& variates);
 	virtual void resetDimensionality(unsigned long dimensionality) { myDimensionality = dimensionality; }
 
+	// The variates of the next numberOfPaths paths at once, stored as structure of arrays: block[dimension * stride + pathIndex].
+	// Same numbers as numberOfPaths calls to nextUniformVector (nextGaussianVector). Generators which can, override nextUniformBlock with a vectorized loop.
+	virtual void nextUniformBlock(unsigned long numberOfPaths, std::vector<double>& block, unsigned long stride);
+	virtual void nextGaussianBlock(unsigned long numberOfPaths, std::vector<double>& block, unsigned long stride);
+
 private:
 	unsigned long myDimensionality;
 
+	// Workspace of the default block functions (one path)
+	std::vector<double> myVariates;
+
 };
 
 
@@ -16,6 +16,8 @@ const long UTParkMiller::m = 2147483647;
 const long UTParkMiller::q = 127773;
 const long UTParkMiller::r = 2836;
 
+const string UTRandomParkMiller::ourClassTag = "Park Miller";
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 UTParkMiller::UTParkMiller(long seed) : mySeed(seed)
@@ -59,6 +61,29 @@ long UTParkMiller::getOneRandomInteger()
 	return mySeed;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void UTParkMiller::skip(unsigned long long numberOfIntegers)
+{
+	// The sequence has period m - 1
+	numberOfIntegers %= static_cast<unsigned long long>(m - 1);
+
+	// a^numberOfIntegers mod m by square and multiply. m < 2^31 so the products fit in 64 bits.
+	unsigned long long multiplier = 1ULL;
+	unsigned long long power = static_cast<unsigned long long>(a);
+	const unsigned long long modulus = static_cast<unsigned long long>(m);
+
+	while (numberOfIntegers > 0)
+	{
+		if (numberOfIntegers & 1ULL)
+			multiplier = (multiplier * power) % modulus;
+
+		power = (power * power) % modulus;
+		numberOfIntegers >>= 1;
+	}
+
+	mySeed = static_cast<long>((multiplier * static_cast<unsigned long long>(mySeed)) % modulus);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 UTRandomParkMiller::UTRandomParkMiller()
@@ -94,9 +119,8 @@ void UTRandomParkMiller::nextUniformVector(std::vector<double>& variates)
 ///////////////////////////////////////////////////////////////////////////////
 void UTRandomParkMiller::skip(unsigned long numberOfPaths)
 {
-	vector<double> tmp(dimensionality());
-	for (unsigned long j = 0; j < numberOfPaths; j++)
-		nextUniformVector(tmp);
+	// Each path uses dimensionality() integers
+	myGenerator.skip(static_cast<unsigned long long>(numberOfPaths) * dimensionality());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -27,6 +27,9 @@ public:
 	long getOneRandomInteger();
 	void setSeed(long seed);
 
+	// Jump ahead by numberOfIntegers integers in O(log(numberOfIntegers)): seed = a^numberOfIntegers * seed mod m
+	void skip(unsigned long long numberOfIntegers);
+
 	static unsigned long max();
 	static unsigned long min();
 
@@ -40,10 +43,14 @@ class UTRandomParkMiller : public UTRandomBase
 {
 public:
 
+	static std::string const ourClassTag;
+
 	UTRandomParkMiller();
 	UTRandomParkMiller(unsigned long dimensionality, unsigned long seed = 1);
 
 	virtual UTRandomBase* clone() const;
+	virtual std::string classTag() const { return ourClassTag; }
+	virtual unsigned long seed() const { return myInitialSeed; }
 	virtual void nextUniformVector(std::vector<double>& variates);
 	virtual void skip(unsigned long numberOfPaths);
 	virtual void setSeed(unsigned long Seed);
@@ -0,0 +1,167 @@
+/* UTRandomPhilox.cpp
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#include "UTRandomPhilox.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// The class tag
+const string UTRandomPhilox::ourClassTag = "Philox";
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// The Philox4x32 constants
+
+namespace
+{
+	const unsigned int ourMultiplier0 = 0xD2511F53U;
+	const unsigned int ourMultiplier1 = 0xCD9E8D57U;
+	const unsigned int ourWeyl0 = 0x9E3779B9U;  // golden ratio
+	const unsigned int ourWeyl1 = 0xBB67AE85U;  // sqrt(3) - 1
+	const unsigned long ourNumberOfRounds = 10;
+
+	const double ourReciprocal = 1.0 / 4294967296.0;  // 2^-32
+
+	// Straight line code on 32 bits integers, so a loop across the paths calling it can be vectorized
+	inline void philoxRounds(unsigned int& c0, unsigned int& c1, unsigned int& c2, unsigned int& c3, unsigned int k0, unsigned int k1)
+	{
+		for (unsigned long round = 0; round < ourNumberOfRounds; ++round)
+		{
+			unsigned long long product0 = static_cast<unsigned long long>(ourMultiplier0) * c0;
+			unsigned long long product1 = static_cast<unsigned long long>(ourMultiplier1) * c2;
+
+			unsigned int hi0 = static_cast<unsigned int>(product0 >> 32);
+			unsigned int lo0 = static_cast<unsigned int>(product0);
+			unsigned int hi1 = static_cast<unsigned int>(product1 >> 32);
+			unsigned int lo1 = static_cast<unsigned int>(product1);
+
+			c0 = hi1 ^ c1 ^ k0;
+			c1 = lo1;
+			c2 = hi0 ^ c3 ^ k1;
+			c3 = lo0;
+
+			k0 += ourWeyl0;
+			k1 += ourWeyl1;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+UTRandomPhilox::UTRandomPhilox(unsigned long dimensionality, unsigned long seed)
+	: UTRandomBase(dimensionality),
+	myPath(0)
+{
+	setSeed(seed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+UTRandomBase* UTRandomPhilox::clone() const
+{
+	return new UTRandomPhilox(*this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomPhilox::philox(const unsigned int counter[4], const unsigned int key[2], unsigned int result[4])
+{
+	result[0] = counter[0];
+	result[1] = counter[1];
+	result[2] = counter[2];
+	result[3] = counter[3];
+
+	philoxRounds(result[0], result[1], result[2], result[3], key[0], key[1]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomPhilox::nextUniformVector(vector<double>& variates)
+{
+	unsigned long numberOfDimensions = dimensionality();
+	unsigned int counter[4] = { 0U, 0U, static_cast<unsigned int>(myPath), static_cast<unsigned int>(myPath >> 32) };
+	unsigned int result[4];
+
+	for (unsigned long i = 0; i < numberOfDimensions; i += 4)
+	{
+		counter[0] = static_cast<unsigned int>(i >> 2);
+		philox(counter, myKey, result);
+
+		for (unsigned long k = 0; k < 4 && i + k < numberOfDimensions; ++k)
+			variates[i + k] = (result[k] + 0.5) * ourReciprocal;
+	}
+
+	++myPath;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomPhilox::nextUniformBlock(unsigned long numberOfPaths, vector<double>& block, unsigned long stride)
+{
+	unsigned long numberOfDimensions = dimensionality();
+	const unsigned int k0 = myKey[0];
+	const unsigned int k1 = myKey[1];
+
+	for (unsigned long i = 0; i < numberOfDimensions; i += 4)
+	{
+		const unsigned int chunk = static_cast<unsigned int>(i >> 2);
+		const unsigned long numberOfRows = numberOfDimensions - i < 4 ? numberOfDimensions - i : 4;
+
+		double * row0 = &block[i * stride];
+		double * row1 = numberOfRows > 1 ? row0 + stride : row0;
+		double * row2 = numberOfRows > 2 ? row0 + 2 * stride : row0;
+		double * row3 = numberOfRows > 3 ? row0 + 3 * stride : row0;
+
+		// The loop across the paths: the 4 outputs of each counter go to 4 rows.
+		// The missing rows of the last chunk are written to row0 first, and then overwritten by the right value.
+		for (unsigned long j = 0; j < numberOfPaths; ++j)
+		{
+			unsigned long long path = myPath + j;
+			unsigned int c0 = chunk;
+			unsigned int c1 = 0U;
+			unsigned int c2 = static_cast<unsigned int>(path);
+			unsigned int c3 = static_cast<unsigned int>(path >> 32);
+
+			philoxRounds(c0, c1, c2, c3, k0, k1);
+
+			row3[j] = (c3 + 0.5) * ourReciprocal;
+			row2[j] = (c2 + 0.5) * ourReciprocal;
+			row1[j] = (c1 + 0.5) * ourReciprocal;
+			row0[j] = (c0 + 0.5) * ourReciprocal;
+		}
+	}
+
+	myPath += numberOfPaths;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomPhilox::skip(unsigned long numberOfPaths)
+{
+	myPath += numberOfPaths;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomPhilox::setSeed(unsigned long seed)
+{
+	unsigned long long key = seed;
+	myKey[0] = static_cast<unsigned int>(key);
+	myKey[1] = static_cast<unsigned int>(key >> 32);
+	myPath = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomPhilox::reset()
+{
+	myPath = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomPhilox::resetDimensionality(unsigned long dimensionality)
+{
+	UTRandomBase::resetDimensionality(dimensionality);
+	myPath = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,54 @@
+/* UTRandomPhilox.h
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#ifndef UT_RANDOM_PHILOX_H
+#define UT_RANDOM_PHILOX_H
+
+#include <vector>
+
+#include "UTRandomBase.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Counter based generator Philox4x32-10 (Salmon, Moraes, Dror, Shaw 2011).
+//
+// The state is only (key, path index): the uniforms of the dimensions 4c to 4c + 3 of the path p are the bijection
+// of the counter (c, 0, p low bits, p high bits) under the key given by the seed. So any path is obtained directly,
+// skip() is a simple addition, and the numbers do not depend on how the paths are shared between threads.
+// Each uniform is returned at the middle of its 2^-32 cell, so it is always in (0, 1).
+class UTRandomPhilox : public UTRandomBase
+{
+public:
+
+	static std::string const ourClassTag;
+
+	UTRandomPhilox(unsigned long dimensionality = 1, unsigned long seed = 1);
+
+	virtual UTRandomBase* clone() const;
+	virtual std::string classTag() const { return ourClassTag; }
+	virtual unsigned long seed() const { return static_cast<unsigned long>(myKey[0] | static_cast<unsigned long long>(myKey[1]) << 32); }
+	virtual void nextUniformVector(std::vector<double>& variates);
+	virtual void skip(unsigned long numberOfPaths);
+	virtual void setSeed(unsigned long seed);
+	virtual void reset();
+	virtual void resetDimensionality(unsigned long dimensionality);
+
+	// Vectorized across the paths
+	virtual void nextUniformBlock(unsigned long numberOfPaths, std::vector<double>& block, unsigned long stride);
+
+	// Accessors
+	unsigned long long path() const { return myPath; }
+
+	// The Philox4x32-10 bijection of the counter under the key
+	static void philox(const unsigned int counter[4], const unsigned int key[2], unsigned int result[4]);
+
+private:
+
+	unsigned int myKey[2];
+	unsigned long long myPath;  // the index of the next path
+};
+
+#endif //UT_RANDOM_PHILOX_H
@@ -0,0 +1,239 @@
+/* UTRandomSobol.cpp
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#include <stdexcept>
+
+#include "UTRandomSobol.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// The class tag
+const string UTRandomSobol::ourClassTag = "Sobol";
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Helper functions on 32 bits integers
+
+namespace
+{
+	const double ourReciprocal = 1.0 / 4294967296.0;  // 2^-32
+
+	// Integer hash (for the scrambling keys)
+	unsigned int hashInteger(unsigned int x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352dU;
+		x ^= x >> 15;
+		x *= 0x846ca68bU;
+		x ^= x >> 16;
+		return x;
+	}
+
+	unsigned int reverseBits(unsigned int x)
+	{
+		x = ((x >> 1) & 0x55555555U) | ((x & 0x55555555U) << 1);
+		x = ((x >> 2) & 0x33333333U) | ((x & 0x33333333U) << 2);
+		x = ((x >> 4) & 0x0F0F0F0FU) | ((x & 0x0F0F0F0FU) << 4);
+		x = ((x >> 8) & 0x00FF00FFU) | ((x & 0x00FF00FFU) << 8);
+		return (x >> 16) | (x << 16);
+	}
+
+	// Permutation in which each bit only depends on the lower bits (Laine-Karras, with the constants of Burley 2020).
+	// Applied to the reversed bits, it is a nested uniform scrambling.
+	unsigned int laineKarrasPermutation(unsigned int x, unsigned int seed)
+	{
+		x ^= x * 0x3d20adeaU;
+		x += seed;
+		x *= (seed >> 16) | 1U;
+		x ^= x * 0x05526c56U;
+		x ^= x * 0x53a22864U;
+		return x;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+UTRandomSobol::UTRandomSobol(unsigned long dimensionality, UT_Scrambling scrambling, unsigned long seed)
+	: UTRandomBase(dimensionality),
+	myIndex(1),
+	myScrambling(scrambling),
+	mySeed(seed)
+{
+	resetDimensionality(dimensionality);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+UTRandomBase* UTRandomSobol::clone() const
+{
+	return new UTRandomSobol(*this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+string UTRandomSobol::classTag() const
+{
+	if (myScrambling == UT_DIGITAL_SHIFT)
+		return ourClassTag + " Digital Shift";
+	if (myScrambling == UT_OWEN)
+		return ourClassTag + " Owen";
+
+	return ourClassTag;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomSobol::initializeDirectionNumbers()
+{
+	unsigned long numberOfDimensions = dimensionality();
+	myDirectionNumbers.assign(ourNumberOfBits * numberOfDimensions, 0U);
+
+	// The first dimension: van der Corput sequence
+	for (unsigned long k = 0; k < ourNumberOfBits; ++k)
+		myDirectionNumbers[k * numberOfDimensions] = 1U << (ourNumberOfBits - 1 - k);
+
+	// The other dimensions: recurrence from the primitive polynomial
+	for (unsigned long j = 1; j < numberOfDimensions; ++j)
+	{
+		const unsigned int * row = &ourInitialDirectionNumbers[(j - 1) * (ourMaxDegree + 2)];
+		unsigned long s = row[0];
+		unsigned int a = row[1];
+		const unsigned int * m = row + 2;
+
+		for (unsigned long k = 0; k < s && k < ourNumberOfBits; ++k)
+			myDirectionNumbers[k * numberOfDimensions + j] = m[k] << (ourNumberOfBits - 1 - k);
+
+		for (unsigned long k = s; k < ourNumberOfBits; ++k)
+		{
+			unsigned int v = myDirectionNumbers[(k - s) * numberOfDimensions + j];
+			v ^= v >> s;
+
+			for (unsigned long i = 1; i < s; ++i)
+			{
+				if ((a >> (s - 1 - i)) & 1U)
+					v ^= myDirectionNumbers[(k - i) * numberOfDimensions + j];
+			}
+
+			myDirectionNumbers[k * numberOfDimensions + j] = v;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomSobol::initializeScrambling()
+{
+	myScramblingKeys.resize(dimensionality());
+
+	unsigned int seedHash = hashInteger(static_cast<unsigned int>(mySeed) * 0x9e3779b9U + 0x632be5abU);
+	for (unsigned long j = 0; j < dimensionality(); ++j)
+		myScramblingKeys[j] = hashInteger(seedHash ^ hashInteger(static_cast<unsigned int>(j) + 1U));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+unsigned int UTRandomSobol::scramble(unsigned int x, unsigned long dimension) const
+{
+	switch (myScrambling)
+	{
+	case UT_DIGITAL_SHIFT: return x ^ myScramblingKeys[dimension];
+	case UT_OWEN: return reverseBits(laineKarrasPermutation(reverseBits(x), myScramblingKeys[dimension]));
+	default: return x;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomSobol::nextUniformVector(vector<double>& variates)
+{
+	if (myIndex >> ourNumberOfBits)
+	{
+		throw runtime_error("UTRandomSobol: all the 2^32 points of the sequence have been used.");
+	}
+
+	// Gray code: the point of index n is the point of index n - 1 XOR the direction numbers of the lowest zero bit of n - 1
+	unsigned long bit = 0;
+	for (unsigned long long n = myIndex; (n & 1ULL) == 0; n >>= 1)
+		++bit;
+
+	const unsigned long numberOfDimensions = dimensionality();
+	const unsigned int * directionNumbers = &myDirectionNumbers[bit * numberOfDimensions];
+
+	for (unsigned long j = 0; j < numberOfDimensions; ++j)
+		myState[j] ^= directionNumbers[j];
+
+	if (myScrambling == UT_NONE)
+	{
+		for (unsigned long j = 0; j < numberOfDimensions; ++j)
+			variates[j] = (myState[j] + 0.5) * ourReciprocal;
+	}
+	else
+	{
+		for (unsigned long j = 0; j < numberOfDimensions; ++j)
+			variates[j] = (scramble(myState[j], j) + 0.5) * ourReciprocal;
+	}
+
+	++myIndex;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Jump directly to the point of index myIndex + numberOfPaths: O(number of bits * dimensionality) whatever the number of paths
+void UTRandomSobol::skip(unsigned long numberOfPaths)
+{
+	myIndex += numberOfPaths;
+
+	if (myIndex >> ourNumberOfBits)
+	{
+		throw runtime_error("UTRandomSobol: cannot skip beyond the 2^32 points of the sequence.");
+	}
+
+	// The point of index n - 1 is the XOR of the direction numbers of the bits of the Gray code of n - 1
+	unsigned long long lastIndex = myIndex - 1;
+	unsigned long long grayCode = lastIndex ^ (lastIndex >> 1);
+
+	const unsigned long numberOfDimensions = dimensionality();
+	myState.assign(numberOfDimensions, 0U);
+
+	for (unsigned long bit = 0; grayCode != 0; ++bit, grayCode >>= 1)
+	{
+		if (grayCode & 1ULL)
+		{
+			const unsigned int * directionNumbers = &myDirectionNumbers[bit * numberOfDimensions];
+			for (unsigned long j = 0; j < numberOfDimensions; ++j)
+				myState[j] ^= directionNumbers[j];
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomSobol::setSeed(unsigned long seed)
+{
+	mySeed = seed;
+	initializeScrambling();
+	reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomSobol::reset()
+{
+	// Start from the point of index 1 (the point of index 0 is the origin)
+	myIndex = 1;
+	myState.assign(dimensionality(), 0U);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTRandomSobol::resetDimensionality(unsigned long dimensionality)
+{
+	if (dimensionality == 0 || dimensionality > ourMaxDimensionality)
+	{
+		throw runtime_error("UTRandomSobol: the dimensionality should be between 1 and 1024.");
+	}
+
+	UTRandomBase::resetDimensionality(dimensionality);
+
+	initializeDirectionNumbers();
+	initializeScrambling();
+	reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,89 @@
+/* UTRandomSobol.h
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#ifndef UT_RANDOM_SOBOL_H
+#define UT_RANDOM_SOBOL_H
+
+#include <vector>
+
+#include "UTRandomBase.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Sobol low discrepancy sequence with the Joe-Kuo direction numbers (up to ourMaxDimensionality dimensions).
+//
+// The points are generated in the Gray code order, so the next point is one XOR per dimension away from the previous one,
+// and skip() jumps directly to any index of the sequence.
+// The point of index 0 (the origin) is never returned, and each coordinate is returned at the middle of its 2^-32 cell,
+// so the uniforms are always in (0, 1).
+//
+// Optional scrambling (the seed defines the scrambling):
+//   UT_DIGITAL_SHIFT : XOR of each coordinate with a random 32 bits integer
+//   UT_OWEN          : nested uniform (Owen) scrambling with a hash based permutation (Laine-Karras / Burley)
+class UTRandomSobol : public UTRandomBase
+{
+public:
+
+	enum UT_Scrambling
+	{
+		UT_NONE = 0,
+		UT_DIGITAL_SHIFT = 1,
+		UT_OWEN = 2
+	};
+
+	static std::string const ourClassTag;
+
+	static const unsigned long ourMaxDimensionality = 1024;
+	static const unsigned long ourMaxDegree = 13;
+	static const unsigned long ourNumberOfBits = 32;
+
+	UTRandomSobol(unsigned long dimensionality = 1, UT_Scrambling scrambling = UT_NONE, unsigned long seed = 1);
+
+	virtual UTRandomBase* clone() const;
+
+	// The scrambling is part of the type: "Sobol", "Sobol Digital Shift" or "Sobol Owen"
+	virtual std::string classTag() const;
+	virtual unsigned long seed() const { return mySeed; }
+
+	virtual void nextUniformVector(std::vector<double>& variates);
+	virtual void skip(unsigned long numberOfPaths);
+	virtual void setSeed(unsigned long seed);
+	virtual void reset();
+	virtual void resetDimensionality(unsigned long dimensionality);
+
+	// Accessors
+	UT_Scrambling scrambling() const { return myScrambling; }
+	unsigned long long index() const { return myIndex; }
+
+private:
+
+	// Calculate the direction numbers of all the dimensions
+	void initializeDirectionNumbers();
+
+	// Calculate the scrambling keys of all the dimensions from the seed
+	void initializeScrambling();
+
+	// Apply the scrambling to one coordinate
+	unsigned int scramble(unsigned int x, unsigned long dimension) const;
+
+	// The Joe-Kuo data (s, a, m_1, ..., m_s) of the dimensions 2 to ourMaxDimensionality
+	static const unsigned int ourInitialDirectionNumbers[];
+
+	// Direction numbers: myDirectionNumbers[bit * dimensionality() + dimension]
+	std::vector<unsigned int> myDirectionNumbers;
+
+	// Scrambling keys (one per dimension)
+	std::vector<unsigned int> myScramblingKeys;
+
+	// The (unscrambled) integer coordinates of the last point, and the index of the next point
+	std::vector<unsigned int> myState;
+	unsigned long long myIndex;
+
+	UT_Scrambling myScrambling;
+	unsigned long mySeed;
+};
+
+#endif //UT_RANDOM_SOBOL_H
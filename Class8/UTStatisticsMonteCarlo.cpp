@@ -0,0 +1,249 @@
+/* UTStatisticsMonteCarlo.cpp
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#include <cmath>
+#include <float.h>
+#include <stdexcept>
+#include <istream>
+#include <ostream>
+
+#include "UTStatisticsMonteCarlo.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Static data.
+
+const double UTStatisticsMonteCarlo::ourQuantile95 = 1.959963984540054;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Binary input/output of the accumulators (fixed size: 64 bits counts and doubles)
+
+namespace
+{
+	void writeCount(ostream& os, unsigned long count)
+	{
+		unsigned long long value = count;
+		os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void writeDouble(ostream& os, double value)
+	{
+		os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	unsigned long readCount(istream& is)
+	{
+		unsigned long long value = 0;
+		if (!is.read(reinterpret_cast<char*>(&value), sizeof(value)))
+		{
+			throw runtime_error("UTStatisticsMonteCarlo: cannot read the statistics.");
+		}
+		return static_cast<unsigned long>(value);
+	}
+
+	double readDouble(istream& is)
+	{
+		double value = 0.0;
+		if (!is.read(reinterpret_cast<char*>(&value), sizeof(value)))
+		{
+			throw runtime_error("UTStatisticsMonteCarlo: cannot read the statistics.");
+		}
+		return value;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Chan et al. parallel update of the mean and of the sum of squared deviations
+void UTStatisticsMonteCarlo::merge(const UTStatisticsMonteCarlo& other)
+{
+	if (other.myNumberOfSamples == 0)
+	{
+		return;
+	}
+
+	if (myNumberOfSamples == 0)
+	{
+		*this = other;
+		return;
+	}
+
+	double n1 = static_cast<double>(myNumberOfSamples);
+	double n2 = static_cast<double>(other.myNumberOfSamples);
+	double n = n1 + n2;
+	double delta = other.myMean - myMean;
+
+	myMean += delta * n2 / n;
+	mySumOfSquaredDeviations += other.mySumOfSquaredDeviations + delta * delta * n1 * n2 / n;
+	myNumberOfSamples += other.myNumberOfSamples;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTStatisticsMonteCarlo::variance() const
+{
+	if (myNumberOfSamples < 2)
+	{
+		return 0.0;
+	}
+
+	return mySumOfSquaredDeviations / (myNumberOfSamples - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTStatisticsMonteCarlo::standardError() const
+{
+	if (myNumberOfSamples < 2)
+	{
+		return 0.0;
+	}
+
+	return sqrt(variance() / myNumberOfSamples);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTStatisticsMonteCarlo::relativeStandardError() const
+{
+	double absMean = fabs(myMean);
+
+	// The relative error of a zero mean is not defined: treat it as infinite unless there is no error at all
+	if (absMean < DBL_MIN)
+	{
+		return standardError() > 0.0 ? DBL_MAX : 0.0;
+	}
+
+	return standardError() / absMean;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTStatisticsMonteCarlo::standardError(UT_ErrorType errorType) const
+{
+	switch (errorType)
+	{
+	case UT_ErrorType::UT_ABSOLUTE: return standardError();
+	case UT_ErrorType::UT_RELATIVE: return relativeStandardError();
+	default: throw runtime_error("UTStatisticsMonteCarlo: unknown error type.");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTStatisticsMonteCarlo::confidenceInterval(double& lowerBound, double& upperBound, double quantile) const
+{
+	double halfWidth = quantile * standardError();
+	lowerBound = myMean - halfWidth;
+	upperBound = myMean + halfWidth;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void UTStatisticsMonteCarloControlVariate::reset()
+{
+	myNumberOfSamples = 0;
+	myMeanY = 0.0;
+	myMeanX = 0.0;
+	mySumOfSquaredDeviationsY = 0.0;
+	mySumOfSquaredDeviationsX = 0.0;
+	mySumOfCrossDeviations = 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTStatisticsMonteCarloControlVariate::merge(const UTStatisticsMonteCarloControlVariate& other)
+{
+	if (other.myNumberOfSamples == 0)
+	{
+		return;
+	}
+
+	if (myNumberOfSamples == 0)
+	{
+		*this = other;
+		return;
+	}
+
+	double n1 = static_cast<double>(myNumberOfSamples);
+	double n2 = static_cast<double>(other.myNumberOfSamples);
+	double n = n1 + n2;
+	double deltaY = other.myMeanY - myMeanY;
+	double deltaX = other.myMeanX - myMeanX;
+
+	myMeanY += deltaY * n2 / n;
+	myMeanX += deltaX * n2 / n;
+	mySumOfSquaredDeviationsY += other.mySumOfSquaredDeviationsY + deltaY * deltaY * n1 * n2 / n;
+	mySumOfSquaredDeviationsX += other.mySumOfSquaredDeviationsX + deltaX * deltaX * n1 * n2 / n;
+	mySumOfCrossDeviations += other.mySumOfCrossDeviations + deltaX * deltaY * n1 * n2 / n;
+	myNumberOfSamples += other.myNumberOfSamples;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTStatisticsMonteCarloControlVariate::beta() const
+{
+	if (mySumOfSquaredDeviationsX <= 0.0)
+	{
+		return 0.0;
+	}
+
+	return mySumOfCrossDeviations / mySumOfSquaredDeviationsX;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+UTStatisticsMonteCarlo UTStatisticsMonteCarloControlVariate::controlledStatistics(double controlExpectation) const
+{
+	double b = beta();
+	double mean = myMeanY - b * (myMeanX - controlExpectation);
+
+	// The residual sum of squares: Syy - Sxy^2 / Sxx (never negative)
+	double sumOfSquaredDeviations = mySumOfSquaredDeviationsY - b * mySumOfCrossDeviations;
+	if (sumOfSquaredDeviations < 0.0)
+	{
+		sumOfSquaredDeviations = 0.0;
+	}
+
+	return UTStatisticsMonteCarlo(myNumberOfSamples, mean, sumOfSquaredDeviations);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void UTStatisticsMonteCarlo::save(ostream& os) const
+{
+	writeCount(os, myNumberOfSamples);
+	writeDouble(os, myMean);
+	writeDouble(os, mySumOfSquaredDeviations);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTStatisticsMonteCarlo::load(istream& is)
+{
+	myNumberOfSamples = readCount(is);
+	myMean = readDouble(is);
+	mySumOfSquaredDeviations = readDouble(is);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTStatisticsMonteCarloControlVariate::save(ostream& os) const
+{
+	writeCount(os, myNumberOfSamples);
+	writeDouble(os, myMeanY);
+	writeDouble(os, myMeanX);
+	writeDouble(os, mySumOfSquaredDeviationsY);
+	writeDouble(os, mySumOfSquaredDeviationsX);
+	writeDouble(os, mySumOfCrossDeviations);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTStatisticsMonteCarloControlVariate::load(istream& is)
+{
+	myNumberOfSamples = readCount(is);
+	myMeanY = readDouble(is);
+	myMeanX = readDouble(is);
+	mySumOfSquaredDeviationsY = readDouble(is);
+	mySumOfSquaredDeviationsX = readDouble(is);
+	mySumOfCrossDeviations = readDouble(is);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,146 @@
+/* UTStatisticsMonteCarlo.h
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#ifndef UT_STATISTICS_MONTE_CARLO_H
+#define UT_STATISTICS_MONTE_CARLO_H
+
+#include <iosfwd>
+#include "UTEnum.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Streaming statistics of the Monte Carlo samples (Welford's algorithm).
+// Two accumulators can be merged, so that blocks of paths can be accumulated separately (e.g. in different threads).
+class UTStatisticsMonteCarlo
+{
+public:
+
+	// The 97.5% quantile of the standard normal distribution (for the 95% confidence interval)
+	static const double ourQuantile95;
+
+	// Destructor.
+	~UTStatisticsMonteCarlo() {}
+
+	// Constructor.
+	UTStatisticsMonteCarlo() : myNumberOfSamples(0), myMean(0.0), mySumOfSquaredDeviations(0.0) {}
+
+	// Constructor from already accumulated moments
+	UTStatisticsMonteCarlo(unsigned long numberOfSamples, double mean, double sumOfSquaredDeviations)
+		: myNumberOfSamples(numberOfSamples), myMean(mean), mySumOfSquaredDeviations(sumOfSquaredDeviations) {}
+
+	// Add one sample
+	void addOneResult(double result)
+	{
+		++myNumberOfSamples;
+		double delta = result - myMean;
+		myMean += delta / myNumberOfSamples;
+		mySumOfSquaredDeviations += delta * (result - myMean);
+	}
+
+	// Merge the samples of the other accumulator into this one
+	void merge(const UTStatisticsMonteCarlo& other);
+
+	// Clear all the samples
+	void reset() { myNumberOfSamples = 0; myMean = 0.0; mySumOfSquaredDeviations = 0.0; }
+
+	// Accessors
+	unsigned long numberOfSamples() const { return myNumberOfSamples; }
+	double mean() const { return myMean; }
+
+	// The unbiased sample variance
+	double variance() const;
+
+	// The standard error of the mean
+	double standardError() const;
+
+	// The standard error relative to the absolute value of the mean
+	double relativeStandardError() const;
+
+	// The standard error of the given type
+	double standardError(UT_ErrorType errorType) const;
+
+	// The confidence interval of the mean (95% by default)
+	void confidenceInterval(double& lowerBound, double& upperBound, double quantile = ourQuantile95) const;
+
+	// Binary image of the accumulator (for the checkpoints of the engines)
+	void save(std::ostream& os) const;
+	void load(std::istream& is);
+
+private:
+
+	unsigned long myNumberOfSamples;
+	double myMean;
+	double mySumOfSquaredDeviations;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Streaming statistics of pairs of samples (y, x): y is the PV of the product and x is the PV of the control variate on the same path.
+// The controlled estimator is  mean(y) - beta * (mean(x) - E[x])  with the optimal beta = Cov(x, y) / Var(x).
+class UTStatisticsMonteCarloControlVariate
+{
+public:
+
+	// Destructor.
+	~UTStatisticsMonteCarloControlVariate() {}
+
+	// Constructor.
+	UTStatisticsMonteCarloControlVariate() { reset(); }
+
+	// Add one pair of samples
+	void addOneResult(double result, double controlResult)
+	{
+		++myNumberOfSamples;
+		double deltaY = result - myMeanY;
+		double deltaX = controlResult - myMeanX;
+		myMeanY += deltaY / myNumberOfSamples;
+		myMeanX += deltaX / myNumberOfSamples;
+		mySumOfSquaredDeviationsY += deltaY * (result - myMeanY);
+		mySumOfSquaredDeviationsX += deltaX * (controlResult - myMeanX);
+		mySumOfCrossDeviations += deltaX * (result - myMeanY);
+	}
+
+	// Merge the samples of the other accumulator into this one
+	void merge(const UTStatisticsMonteCarloControlVariate& other);
+
+	// Clear all the samples
+	void reset();
+
+	// Accessors
+	unsigned long numberOfSamples() const { return myNumberOfSamples; }
+
+	// The optimal beta estimated from the samples (0 if the control has no variance)
+	double beta() const;
+
+	// The statistics of the product samples alone
+	UTStatisticsMonteCarlo uncontrolledStatistics() const { return UTStatisticsMonteCarlo(myNumberOfSamples, myMeanY, mySumOfSquaredDeviationsY); }
+
+	// The statistics of the control samples alone
+	UTStatisticsMonteCarlo controlStatistics() const { return UTStatisticsMonteCarlo(myNumberOfSamples, myMeanX, mySumOfSquaredDeviationsX); }
+
+	// The statistics of the controlled estimator, given the exact expectation of the control
+	UTStatisticsMonteCarlo controlledStatistics(double controlExpectation) const;
+
+	// Binary image of the accumulator (for the checkpoints of the engines)
+	void save(std::ostream& os) const;
+	void load(std::istream& is);
+
+private:
+
+	unsigned long myNumberOfSamples;
+	double myMeanY;
+	double myMeanX;
+	double mySumOfSquaredDeviationsY;
+	double mySumOfSquaredDeviationsX;
+	double mySumOfCrossDeviations;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // UT_STATISTICS_MONTE_CARLO_H
@@ -4,21 +4,33 @@
 * Diva Analytics
 */
 
+#include<algorithm>
 #include<iostream>
 #include<fstream>
+#include<sstream>
 #include<string>
+#include<atomic>
+#include<chrono>
+#include<thread>
 
 #include "UTEuropeanOptionLogNormal.hpp"
 #include "UTEuropeanOptionNormal.hpp"
 #include "UTProductSwap.hpp"
 #include "UTProductEuropeanOption.hpp"
 #include "UTProductPathDependent.hpp"
+#include "UTProductPortfolio.hpp"
 #include "UTModelYieldCurve.hpp"
 #include "UTModelBlackSholesDynamics.hpp"
 #include "UTValuationEngineFactory.hpp"
+#include "UTValuationEngineMonteCarlo.hpp"
 #include "UTRandomParkMiller.hpp"
 #include "UTRandomAntitheticVariates.hpp"
+#include "UTRandomSobol.hpp"
+#include "UTRandomPhilox.hpp"
+#include "UTMathFunctions.hpp"
 #include "UTModelFactory.hpp"
+#include "UTModelYieldCurveLive.hpp"
+#include "UTTest.hpp"
 
 using namespace std;
 
@@ -131,6 +143,1901 @@ void exoticOptionTest()
 
 }
 
+void parallelMonteCarloTest()
+{
+	vector<double> impVol{ 0.1, 0.2, 0.25 };
+	vector<double> optionMaturities{ 0.5, 1.0, 2.0 };
+	double spotPrice = 100.0;
+
+	//Model generation
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve()); // flat 3% yield curve
+	shared_ptr<const UTModelBlackSholesDynamics>volModel(UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVol, pYieldCurve));
+
+	// Products 
+	UTProductPathDependentAsian arithmeticOption(0.0, 1.0, 12, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_ARITHMETIC);
+
+	const unsigned long  numbeOfPaths = 100000;
+	UTRandomParkMiller generator;
+
+	// The serial run
+	auto pricer1(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, arithmeticOption, generator, numbeOfPaths, false, 1));
+	double serialPv = 0.0;
+	pricer1->calculatePV(serialPv);
+
+	cout << "the PV of the arithmetic Asian call option with 1 thread is " << serialPv << ".\n";
+
+	// The parallel runs should give exactly the same number
+	for (unsigned long numberOfThreads : { 2UL, 4UL, 0UL })
+	{
+		auto pricer2(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, arithmeticOption, generator, numbeOfPaths, false, numberOfThreads));
+		double pv = 0.0;
+		pricer2->calculatePV(pv);
+
+		cout << "the PV with " << numberOfThreads << " thread(s) is " << pv << ".\n";
+
+		if (pv != serialPv)
+			throw runtime_error("parallelMonteCarloTest: the parallel run is not the serial run.");
+	}
+
+}
+
+void monteCarloStatisticsTest()
+{
+	vector<double> impVol{ 0.1, 0.2, 0.25 };
+	vector<double> optionMaturities{ 0.5, 1.0, 2.0 };
+	double spotPrice = 100.0;
+
+	//Model generation
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve()); // flat 3% yield curve
+	shared_ptr<const UTModelBlackSholesDynamics>volModel(UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVol, pYieldCurve));
+
+	// Products 
+	UTProductPathDependentAsian arithmeticOption(0.0, 1.0, 12, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_ARITHMETIC);
+
+	UTRandomParkMiller generator;
+
+	// Fixed number of paths
+	auto pricer1(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, arithmeticOption, generator, 10000));
+	const UTStatisticsMonteCarlo& statistics1 = dynamic_cast<const UTValuationEngineMonteCarlo&>(*pricer1).statistics();
+	double lowerBound, upperBound;
+	statistics1.confidenceInterval(lowerBound, upperBound);
+
+	cout << "the PV of the arithmetic Asian call option is " << statistics1.mean() << " with standard error " << statistics1.standardError() << ".\n";
+	cout << "the 95% confidence interval is [" << lowerBound << ", " << upperBound << "].\n";
+
+	// Stop at 0.01 absolute standard error, with the budget of 1,000,000 paths
+	auto pricer2(UTValuationEngineFactory::newValuationEngineMonteCarloToTolerance(*volModel, arithmeticOption, generator, 0.01, UT_ErrorType::UT_ABSOLUTE, 1000000));
+	const UTStatisticsMonteCarlo& statistics2 = dynamic_cast<const UTValuationEngineMonteCarlo&>(*pricer2).statistics();
+
+	cout << "the PV with the target standard error 0.01 is " << statistics2.mean() << " with standard error " << statistics2.standardError() << " after " << statistics2.numberOfSamples() << " paths.\n";
+
+	// Stop at 0.1% relative standard error
+	auto pricer3(UTValuationEngineFactory::newValuationEngineMonteCarloToTolerance(*volModel, arithmeticOption, generator, 0.001, UT_ErrorType::UT_RELATIVE, 1000000));
+	const UTStatisticsMonteCarlo& statistics3 = dynamic_cast<const UTValuationEngineMonteCarlo&>(*pricer3).statistics();
+
+	cout << "the PV with the target relative standard error 0.1% is " << statistics3.mean() << " with relative standard error " << statistics3.relativeStandardError() << " after " << statistics3.numberOfSamples() << " paths.\n";
+
+}
+
+void controlVariateTest()
+{
+	vector<double> impVol{ 0.1, 0.2, 0.25 };
+	vector<double> optionMaturities{ 0.5, 1.0, 2.0 };
+	double spotPrice = 100.0;
+
+	//Model generation
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve()); // flat 3% yield curve
+	shared_ptr<const UTModelBlackSholesDynamics>volModel(UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVol, pYieldCurve));
+
+	// Products 
+	UTProductPathDependentAsian arithmeticOption(0.0, 1.0, 12, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_ARITHMETIC);
+
+	const unsigned long  numbeOfPaths = 10000;
+	UTRandomParkMiller generator;
+
+	// Plain Monte Carlo
+	auto pricer1(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, arithmeticOption, generator, numbeOfPaths));
+	const UTStatisticsMonteCarlo& statistics1 = dynamic_cast<const UTValuationEngineMonteCarlo&>(*pricer1).statistics();
+
+	cout << "the PV of the arithmetic Asian call option by plain MC is " << statistics1.mean() << " with standard error " << statistics1.standardError() << ".\n";
+
+	// The geometric Asian option as control variate
+	auto pricer2(UTValuationEngineFactory::newValuationEngineMonteCarloControlVariate(*volModel, arithmeticOption, generator, numbeOfPaths));
+	const UTValuationEngineMonteCarlo& engine2 = dynamic_cast<const UTValuationEngineMonteCarlo&>(*pricer2);
+	const UTStatisticsMonteCarlo& statistics2 = engine2.statistics();
+
+	cout << "the PV of the arithmetic Asian call option with control variate is " << statistics2.mean() << " with standard error " << statistics2.standardError() << ".\n";
+	cout << "the beta is " << engine2.controlVariateStatistics().beta() << " and the variance reduction is " << statistics1.variance() / statistics2.variance() << ".\n";
+
+}
+
+void sobolTest()
+{
+	vector<double> impVol{ 0.1, 0.2, 0.25 };
+	vector<double> optionMaturities{ 0.5, 1.0, 2.0 };
+	double spotPrice = 100.0;
+
+	//Model generation
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve()); // flat 3% yield curve
+	shared_ptr<const UTModelBlackSholesDynamics>volModel(UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVol, pYieldCurve));
+
+	// Products 
+	UTProductPathDependentAsian geometricOption(0.0, 1.0, 12, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_GEOMETRIC);
+
+	auto pricer1(UTValuationEngineFactory::newValuationEngineAnalytic(*volModel, geometricOption));
+	double closedForm = 0.0;
+	pricer1->calculatePV(closedForm);
+
+	cout << "the PV of the Asian geometic option by closed form is " << closedForm << ".\n";
+
+	UTRandomParkMiller parkMiller;
+	UTRandomSobol sobol;
+	UTRandomSobol sobolOwen(1, UTRandomSobol::UT_OWEN, 12345);
+
+	for (unsigned long numbeOfPaths = 1024; numbeOfPaths <= 262144; numbeOfPaths *= 4)
+	{
+		auto pricer2(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, geometricOption, parkMiller, numbeOfPaths));
+		double pv2 = 0.0;
+		pricer2->calculatePV(pv2);
+
+		auto pricer3(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, geometricOption, sobol, numbeOfPaths));
+		double pv3 = 0.0;
+		pricer3->calculatePV(pv3);
+
+		auto pricer4(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, geometricOption, sobolOwen, numbeOfPaths));
+		double pv4 = 0.0;
+		pricer4->calculatePV(pv4);
+
+		cout << numbeOfPaths << " paths: error of Park-Miller " << pv2 - closedForm << ", Sobol " << pv3 - closedForm << ", Owen scrambled Sobol " << pv4 - closedForm << ".\n";
+	}
+
+	// The block and the single path constructions give the same path
+	UTValuationEngineMonteCarloBlackSholesDynamics engine(*volModel, geometricOption, sobol, UTValuationEngineMonteCarlo::ourPathsPerBlock, 1, 0.0, UT_ErrorType::UT_ABSOLUTE, nullptr, UT_PathConstruction::UT_INCREMENTAL);
+	unsigned long numberOfTimes = geometricOption.timeLine().size();
+	vector<double> variates(numberOfTimes);
+	vector<double> spotValues(numberOfTimes);
+	vector<double> spotBlock(numberOfTimes * UTValuationEngineMonteCarlo::ourPathsPerBlock);
+
+	UTRandomSobol generator1(numberOfTimes);
+	UTRandomSobol generator2(numberOfTimes);
+	engine.getPathBlock(generator1, 3, variates, spotBlock);
+	generator2.skip(2);
+	engine.getSinglePath(generator2, variates, spotValues);
+
+	double maxDifference = 0.0;
+	for (unsigned long i = 0; i < numberOfTimes; ++i)
+		maxDifference = max(maxDifference, fabs(spotValues[i] - spotBlock[i * UTValuationEngineMonteCarlo::ourPathsPerBlock + 2]));
+
+	cout << "the maximum difference between the block and the single path is " << maxDifference << ".\n";
+
+	if (maxDifference != 0.0)
+		throw runtime_error("sobolTest: the block and the single path are different.");
+}
+
+void brownianBridgeTest()
+{
+	vector<double> optionMaturities{ 0.5, 1.0, 2.0 };
+	vector<double> impVol{ 0.2, 0.25, 0.3 };
+	double spotPrice = 100.0;
+
+	//Model generation
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve()); // flat 3% yield curve
+	shared_ptr<const UTModelBlackSholesDynamics>volModel(UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVol, pYieldCurve));
+
+	// Products: weekly fixings, so the Sobol sequence is used in 53 dimensions
+	UTProductPathDependentAsian geometricOption(0.0, 1.0, 53, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_GEOMETRIC);
+
+	auto pricer1(UTValuationEngineFactory::newValuationEngineAnalytic(*volModel, geometricOption));
+	double closedForm = 0.0;
+	pricer1->calculatePV(closedForm);
+
+	cout << "the PV of the Asian geometic option by closed form is " << closedForm << ".\n";
+
+	UTRandomParkMiller parkMiller;
+	UTRandomSobol sobol;
+
+	for (unsigned long numbeOfPaths = 1024; numbeOfPaths <= 262144; numbeOfPaths *= 4)
+	{
+		// The bridge does not change the distribution of the paths: same error level with pseudo random numbers
+		auto pricer2(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, geometricOption, parkMiller, numbeOfPaths, false, 1, UT_PathConstruction::UT_BROWNIAN_BRIDGE));
+		double pv2 = 0.0;
+		pricer2->calculatePV(pv2);
+
+		auto pricer3(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, geometricOption, sobol, numbeOfPaths, false, 1, UT_PathConstruction::UT_INCREMENTAL));
+		double pv3 = 0.0;
+		pricer3->calculatePV(pv3);
+
+		auto pricer4(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, geometricOption, sobol, numbeOfPaths, false, 1, UT_PathConstruction::UT_BROWNIAN_BRIDGE));
+		double pv4 = 0.0;
+		pricer4->calculatePV(pv4);
+
+		cout << numbeOfPaths << " paths: error of Park-Miller with bridge " << pv2 - closedForm << ", Sobol " << pv3 - closedForm << ", Sobol with bridge " << pv4 - closedForm << ".\n";
+	}
+
+	// The block and the single path constructions give the same path
+	UTValuationEngineMonteCarloBlackSholesDynamics engine(*volModel, geometricOption, sobol, UTValuationEngineMonteCarlo::ourPathsPerBlock, 1, 0.0, UT_ErrorType::UT_ABSOLUTE, nullptr, UT_PathConstruction::UT_BROWNIAN_BRIDGE);
+	unsigned long numberOfTimes = geometricOption.timeLine().size();
+	vector<double> variates(numberOfTimes);
+	vector<double> spotValues(numberOfTimes);
+	vector<double> spotBlock(numberOfTimes * UTValuationEngineMonteCarlo::ourPathsPerBlock);
+
+	UTRandomSobol generator1(numberOfTimes);
+	UTRandomSobol generator2(numberOfTimes);
+	engine.getPathBlock(generator1, 3, variates, spotBlock);
+	generator2.skip(2);
+	engine.getSinglePath(generator2, variates, spotValues);
+
+	double maxDifference = 0.0;
+	for (unsigned long i = 0; i < numberOfTimes; ++i)
+		maxDifference = max(maxDifference, fabs(spotValues[i] - spotBlock[i * UTValuationEngineMonteCarlo::ourPathsPerBlock + 2]));
+
+	cout << "the maximum difference between the block and the single path is " << maxDifference << ".\n";
+
+	if (maxDifference != 0.0)
+		throw runtime_error("brownianBridgeTest: the block and the single path are different.");
+}
+
+void philoxTest()
+{
+	// Known answers of Philox4x32-10 (Random123)
+	unsigned int counter1[4] = { 0U, 0U, 0U, 0U };
+	unsigned int key1[2] = { 0U, 0U };
+	unsigned int counter2[4] = { 0xffffffffU, 0xffffffffU, 0xffffffffU, 0xffffffffU };
+	unsigned int key2[2] = { 0xffffffffU, 0xffffffffU };
+
+	const unsigned int expected1[4] = { 0x6627e8d5U, 0xe169c58dU, 0xbc57ac4cU, 0x9b00dbd8U };
+	const unsigned int expected2[4] = { 0x408f276dU, 0x41c83b0eU, 0xa20bc7c6U, 0x6d5451fdU };
+	unsigned int result[4];
+
+	UTRandomPhilox::philox(counter1, key1, result);
+	cout << hex << "philox(0, 0) = " << result[0] << " " << result[1] << " " << result[2] << " " << result[3] << " (6627e8d5 e169c58d bc57ac4c 9b00dbd8 expected).\n" << dec;
+	if (!equal(result, result + 4, expected1))
+		throw runtime_error("philoxTest: philox(0, 0) is not the known answer.");
+
+	UTRandomPhilox::philox(counter2, key2, result);
+	cout << hex << "philox(-1, -1) = " << result[0] << " " << result[1] << " " << result[2] << " " << result[3] << " (408f276d 41c83b0e a20bc7c6 6d5451fd expected).\n" << dec;
+	if (!equal(result, result + 4, expected2))
+		throw runtime_error("philoxTest: philox(-1, -1) is not the known answer.");
+
+	// The block, the path by path and the skip generations give the same numbers
+	const unsigned long numberOfDim = 7;
+	const unsigned long numbeOfPaths = 100;
+	const unsigned long stride = 128;
+	UTRandomPhilox generator1(numberOfDim, 42);
+	UTRandomPhilox generator2(numberOfDim, 42);
+	vector<double> block(numberOfDim * stride);
+	vector<double> variates(numberOfDim);
+
+	generator1.nextGaussianBlock(numbeOfPaths, block, stride);
+	generator2.skip(numbeOfPaths - 1);
+	generator2.nextGaussianVector(variates);
+
+	double maxDifference = 0.0;
+	for (unsigned long i = 0; i < numberOfDim; ++i)
+		maxDifference = max(maxDifference, fabs(variates[i] - block[i * stride + numbeOfPaths - 1]));
+
+	cout << "the maximum difference between the block and the skipped path is " << maxDifference << ".\n";
+
+	if (maxDifference != 0.0)
+		throw runtime_error("philoxTest: the block and the skipped path are different.");
+
+	// Monte Carlo: the result does not depend on the number of threads
+	vector<double> optionMaturities{ 0.5, 1.0, 2.0 };
+	vector<double> impVol{ 0.2, 0.25, 0.3 };
+	double spotPrice = 100.0;
+
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve()); // flat 3% yield curve
+	shared_ptr<const UTModelBlackSholesDynamics>volModel(UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVol, pYieldCurve));
+
+	UTProductPathDependentAsian geometricOption(0.0, 1.0, 12, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_GEOMETRIC);
+
+	auto pricer1(UTValuationEngineFactory::newValuationEngineAnalytic(*volModel, geometricOption));
+	double closedForm = 0.0;
+	pricer1->calculatePV(closedForm);
+
+	UTRandomPhilox philox;
+	auto pricer2(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, geometricOption, philox, 100000, false, 1));
+	double pv2 = 0.0;
+	pricer2->calculatePV(pv2);
+	const UTStatisticsMonteCarlo& statistics2 = dynamic_cast<const UTValuationEngineMonteCarlo&>(*pricer2).statistics();
+
+	auto pricer3(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, geometricOption, philox, 100000, false, 0));
+	double pv3 = 0.0;
+	pricer3->calculatePV(pv3);
+
+	cout << "the PV of the Asian geometic option is " << closedForm << " by closed form, " << pv2 << " +/- " << statistics2.standardError() << " by Philox with 1 thread, " << pv3 << " with all the threads.\n";
+
+	if (pv3 != pv2)
+		throw runtime_error("philoxTest: the PV depends on the number of threads.");
+}
+
+void mathFunctionsTest()
+{
+	// The batch functions against the scalar ones and the exact values
+	const unsigned long n = 100001;
+	vector<double> x(n), u(n), batch(n);
+
+	for (unsigned long i = 0; i < n; ++i)
+	{
+		x[i] = -10.0 + 20.0 * i / (n - 1);
+		u[i] = 1.0e-10 + (1.0 - 2.0e-10) * i / (n - 1);
+	}
+
+	double maxDifference = 0.0;
+	double maxError = 0.0;
+	UTMathFunctions::cumulativeNormal(&x[0], &batch[0], n);
+	for (unsigned long i = 0; i < n; ++i)
+	{
+		maxDifference = max(maxDifference, fabs(batch[i] - UTMathFunctions::cumulativeNormal(x[i])));
+		maxError = max(maxError, fabs(batch[i] - 0.5 * erfc(-x[i] / sqrt(2.0))));
+	}
+	cout << "cumulativeNormal: batch - scalar " << maxDifference << ", maximum error " << maxError << ".\n";
+
+	if (maxDifference > 1.0e-14)
+		throw runtime_error("mathFunctionsTest: the batch cumulativeNormal is not the scalar one.");
+
+	maxDifference = 0.0;
+	maxError = 0.0;
+	UTMathFunctions::normalDensity(&x[0], &batch[0], n);
+	for (unsigned long i = 0; i < n; ++i)
+		maxDifference = max(maxDifference, fabs(batch[i] - UTMathFunctions::normalDensity(x[i])));
+	cout << "normalDensity: batch - scalar " << maxDifference << ".\n";
+
+	if (maxDifference > 1.0e-14)
+		throw runtime_error("mathFunctionsTest: the batch normalDensity is not the scalar one.");
+
+	maxDifference = 0.0;
+	UTMathFunctions::inverseCumulativeNormal(&u[0], &batch[0], n);
+	for (unsigned long i = 0; i < n; ++i)
+	{
+		maxDifference = max(maxDifference, fabs(batch[i] - UTMathFunctions::inverseCumulativeNormal(u[i])));
+		maxError = max(maxError, fabs(0.5 * erfc(-batch[i] / sqrt(2.0)) - u[i]) / UTMathFunctions::normalDensity(batch[i]));
+	}
+	cout << "inverseCumulativeNormal: batch - scalar " << maxDifference << ", maximum error " << maxError << ".\n";
+
+	if (maxDifference > 1.0e-14)
+		throw runtime_error("mathFunctionsTest: the batch inverseCumulativeNormal is not the scalar one.");
+}
+
+void zeroAllocationTest()
+{
+	vector<double> optionMaturities{ 0.5, 1.0, 2.0 };
+	vector<double> impVol{ 0.2, 0.25, 0.3 };
+	double spotPrice = 100.0;
+
+	//Model generation
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve()); // flat 3% yield curve
+	shared_ptr<const UTModelBlackSholesDynamics>volModel(UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVol, pYieldCurve));
+
+	// Products
+	UTProductPathDependentAsian arithmeticOption(0.0, 1.0, 12, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_ARITHMETIC);
+	shared_ptr<const UTProductBase> geometricOption(UTValuationEngineFactory::newControlVariate(arithmeticOption, true));
+
+	UTRandomParkMiller parkMiller;
+	UTRandomSobol sobol;
+
+	// The constructors run the simulation once (warm up): the next runs must not allocate any memory, serial or on 4 threads,
+	// nor runMore() with an antithetic generator, whose skip() draws a pair when it stops in the middle of one (warmed up by a first runMore())
+	UTValuationEngineMonteCarloBlackSholesDynamics engine1(*volModel, arithmeticOption, parkMiller, 100000);
+	UTValuationEngineMonteCarloBlackSholesDynamics engine2(*volModel, arithmeticOption, sobol, 100000, 1, 0.0, UT_ErrorType::UT_ABSOLUTE, geometricOption, UT_PathConstruction::UT_BROWNIAN_BRIDGE);
+	UTValuationEngineMonteCarloBlackSholesDynamics engine3(*volModel, arithmeticOption, parkMiller, 100000, 4);
+	UTValuationEngineMonteCarloBlackSholesDynamics engine4(*volModel, arithmeticOption, UTRandomAntitheticVariates(parkMiller), 10000);
+	engine4.runMore(10000);
+
+	double pv1 = 0.0;
+	engine1.calculatePV(pv1);
+
+	unsigned long numberOfAllocations = numberOfHeapAllocations();
+	engine1.run();
+	unsigned long numberOfAllocations1 = numberOfHeapAllocations() - numberOfAllocations;
+
+	numberOfAllocations = numberOfHeapAllocations();
+	engine2.run();
+	unsigned long numberOfAllocations2 = numberOfHeapAllocations() - numberOfAllocations;
+
+	numberOfAllocations = numberOfHeapAllocations();
+	engine3.run();
+	unsigned long numberOfAllocations3 = numberOfHeapAllocations() - numberOfAllocations;
+
+	numberOfAllocations = numberOfHeapAllocations();
+	engine4.runMore(10000);
+	unsigned long numberOfAllocations4 = numberOfHeapAllocations() - numberOfAllocations;
+
+	double pv2 = 0.0;
+	engine1.calculatePV(pv2);
+	double pv3 = 0.0;
+	engine3.calculatePV(pv3);
+
+	cout << "heap allocations after warm up: " << numberOfAllocations1 << " (Park-Miller), " << numberOfAllocations2 << " (Sobol, Brownian bridge, control variate), "
+		<< numberOfAllocations3 << " (4 threads), " << numberOfAllocations4 << " (antithetic runMore).\n";
+	cout << "the PV of the first and the second runs are " << pv1 << " and " << pv2 << ", " << pv3 << " on 4 threads.\n";
+
+	if (numberOfAllocations1 != 0 || numberOfAllocations2 != 0 || numberOfAllocations3 != 0 || numberOfAllocations4 != 0)
+	{
+		throw runtime_error("zeroAllocationTest: the Monte Carlo engine allocates memory.");
+	}
+
+	if (pv3 != pv2)
+	{
+		throw runtime_error("zeroAllocationTest: the PV depends on the number of threads.");
+	}
+}
+
+void portfolioTest()
+{
+	vector<double> optionMaturities{ 0.5, 1.0, 2.0 };
+	vector<double> impVol{ 0.2, 0.25, 0.3 };
+	double spotPrice = 100.0;
+	const unsigned long numbeOfPaths = 100000;
+
+	//Model generation
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve()); // flat 3% yield curve
+	shared_ptr<const UTModelBlackSholesDynamics>volModel(UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVol, pYieldCurve));
+
+	// A portfolio of European and Asian options: the time line is the union of the monthly fixings and the expiries
+	vector<shared_ptr<const UTProductBase> > products;
+	products.push_back(shared_ptr<const UTProductBase>(new UTProductEuropeanOptionCall(0.5, 1.0, UT_BuySell::UT_BUY, 95.0)));
+	products.push_back(shared_ptr<const UTProductBase>(new UTProductEuropeanOptionCall(1.0, 1.0, UT_BuySell::UT_BUY, 105.0)));
+	products.push_back(shared_ptr<const UTProductBase>(new UTProductEuropeanOptionPut(1.0, 2.0, UT_BuySell::UT_BUY, 100.0)));
+	products.push_back(shared_ptr<const UTProductBase>(new UTProductPathDependentAsian(0.0, 1.0, 13, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_GEOMETRIC)));
+	products.push_back(shared_ptr<const UTProductBase>(new UTProductPathDependentAsian(0.0, 1.0, 13, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_ARITHMETIC)));
+	UTProductPortfolio portfolio(products);
+
+	cout << "the portfolio of " << portfolio.size() << " products has " << portfolio.timeLine().size() << " simulation times.\n";
+
+	UTRandomParkMiller generator;
+	auto pricer1(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, portfolio, generator, numbeOfPaths));
+	const UTValuationEngineMonteCarlo& engine1 = dynamic_cast<const UTValuationEngineMonteCarlo&>(*pricer1);
+
+	for (unsigned long i = 0; i < portfolio.size(); ++i)
+	{
+		const UTStatisticsMonteCarlo& statistics = engine1.productStatistics()[i];
+		cout << "product " << i << " (" << portfolio.underlying(i)->classTag() << "): " << statistics.mean() << " +/- " << statistics.standardError();
+
+		// The last product (arithmetic Asian) has no closed form
+		if (i + 1 < portfolio.size())
+		{
+			auto pricer2(UTValuationEngineFactory::newValuationEngineAnalytic(*volModel, *portfolio.underlying(i)));
+			double analytic = 0.0;
+			pricer2->calculatePV(analytic);
+			cout << " (analytic " << analytic << ")";
+		}
+		cout << ".\n";
+	}
+
+	double pv1 = 0.0;
+	pricer1->calculatePV(pv1);
+	cout << "the PV of the portfolio is " << pv1 << " +/- " << engine1.statistics().standardError() << ".\n";
+}
+
+void strikeGridTest()
+{
+	vector<double> optionMaturities{ 0.5, 1.0, 2.0 };
+	vector<double> impVol{ 0.2, 0.25, 0.3 };
+	double spotPrice = 100.0;
+	const unsigned long numbeOfPaths = 20000;
+
+	//Model generation
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve()); // flat 3% yield curve
+	shared_ptr<const UTModelBlackSholesDynamics>volModel(UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVol, pYieldCurve));
+
+	// 101 strikes from 50 to 150
+	vector<double> strikes(101);
+	for (unsigned long i = 0; i < strikes.size(); ++i)
+		strikes[i] = 50.0 + i;
+
+	// Arithmetic Asian: the grid against the portfolio of the same options (same paths, the average calculated for each option)
+	UTProductPathDependentAsian arithmeticOption(0.0, 1.0, 53, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_ARITHMETIC);
+	UTProductStrikeGrid asianGrid(arithmeticOption, strikes);
+	UTProductPortfolio asianPortfolio(asianGrid.underlyings());
+
+	UTRandomParkMiller generator;
+
+	auto start = chrono::steady_clock::now();
+	auto pricer1(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, asianGrid, generator, numbeOfPaths));
+	auto end = chrono::steady_clock::now();
+	double time1 = chrono::duration<double>(end - start).count();
+
+	start = chrono::steady_clock::now();
+	auto pricer2(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, asianPortfolio, generator, numbeOfPaths));
+	end = chrono::steady_clock::now();
+	double time2 = chrono::duration<double>(end - start).count();
+
+	const vector<UTStatisticsMonteCarlo>& statistics1 = dynamic_cast<const UTValuationEngineMonteCarlo&>(*pricer1).productStatistics();
+	const vector<UTStatisticsMonteCarlo>& statistics2 = dynamic_cast<const UTValuationEngineMonteCarlo&>(*pricer2).productStatistics();
+
+	double maxDifference = 0.0;
+	for (unsigned long i = 0; i < strikes.size(); ++i)
+		maxDifference = max(maxDifference, fabs(statistics1[i].mean() - statistics2[i].mean()));
+
+	cout << "Asian strike grid: PV at strike " << strikes[50] << " is " << statistics1[50].mean() << " +/- " << statistics1[50].standardError()
+		<< ", maximum difference with the portfolio " << maxDifference << ".\n";
+	cout << "time of the strike grid " << time1 << "s, of the portfolio " << time2 << "s.\n";
+
+	// European calls: the grid against the closed form
+	UTProductEuropeanOptionCall vanillaCall(1.0, 1.0, UT_BuySell::UT_BUY, spotPrice);
+	UTProductStrikeGrid callGrid(vanillaCall, strikes);
+	auto pricer3(UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, callGrid, generator, 100000));
+	const vector<UTStatisticsMonteCarlo>& statistics3 = dynamic_cast<const UTValuationEngineMonteCarlo&>(*pricer3).productStatistics();
+
+	double maxError = 0.0;
+	for (unsigned long i = 0; i < strikes.size(); ++i)
+	{
+		auto pricer4(UTValuationEngineFactory::newValuationEngineAnalytic(*volModel, *callGrid.underlying(i)));
+		double analytic = 0.0;
+		pricer4->calculatePV(analytic);
+		maxError = max(maxError, fabs(statistics3[i].mean() - analytic) / statistics3[i].standardError());
+	}
+
+	cout << "European call strike grid: maximum error against the closed form " << maxError << " standard errors.\n";
+}
+
+void resumableRunTest()
+{
+	vector<double> optionMaturities{ 0.5, 1.0, 2.0 };
+	vector<double> impVol{ 0.2, 0.25, 0.3 };
+	double spotPrice = 100.0;
+
+	//Model generation
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve()); // flat 3% yield curve
+	shared_ptr<const UTModelBlackSholesDynamics>volModel(UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVol, pYieldCurve));
+
+	UTProductPathDependentAsian arithmeticOption(0.0, 1.0, 12, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_ARITHMETIC);
+	UTRandomParkMiller generator;
+
+	// One run of 2^17 paths
+	UTValuationEngineMonteCarloBlackSholesDynamics engine1(*volModel, arithmeticOption, generator, 131072, 4);
+
+	// 2^16 paths, and 2^16 more
+	UTValuationEngineMonteCarloBlackSholesDynamics engine2(*volModel, arithmeticOption, generator, 65536, 4);
+	cout << "the PV with " << engine2.numberOfSimulatedPaths() << " paths is " << engine2.statistics().mean() << " +/- " << engine2.statistics().standardError() << ".\n";
+
+	stringstream checkpoint(ios::in | ios::out | ios::binary);
+	engine2.saveCheckpoint(checkpoint);
+
+	engine2.runMore(65536);
+	cout << "the PV with " << engine2.numberOfSimulatedPaths() << " paths is " << engine2.statistics().mean() << " +/- " << engine2.statistics().standardError()
+		<< " (single run: " << engine1.statistics().mean() << " +/- " << engine1.statistics().standardError() << ").\n";
+
+	// Resume from the checkpoint in a new engine (with no path)
+	UTValuationEngineMonteCarloBlackSholesDynamics engine3(*volModel, arithmeticOption, generator, 0, 4);
+	engine3.loadCheckpoint(checkpoint);
+	engine3.runMore(65536);
+	cout << "the PV resumed from the checkpoint (" << checkpoint.str().size() << " bytes) is " << engine3.statistics().mean() << " +/- " << engine3.statistics().standardError() << ".\n";
+
+	if (engine1.statistics().mean() != engine2.statistics().mean() || engine1.statistics().mean() != engine3.statistics().mean())
+	{
+		throw runtime_error("resumableRunTest: the resumed run is not the single run.");
+	}
+
+	// A checkpoint does not resume with another stream of numbers: another seed, or another type of generator
+	UTRandomParkMiller otherSeed(1, 2);
+	UTRandomPhilox philox;
+	unsigned long numberOfRejected = 0;
+	for (const UTRandomBase* otherGenerator : { static_cast<const UTRandomBase*>(&otherSeed), static_cast<const UTRandomBase*>(&philox) })
+	{
+		UTValuationEngineMonteCarloBlackSholesDynamics engine4(*volModel, arithmeticOption, *otherGenerator, 0, 4);
+		checkpoint.clear();
+		checkpoint.seekg(0);
+		try
+		{
+			engine4.loadCheckpoint(checkpoint);
+		}
+		catch (const runtime_error&)
+		{
+			++numberOfRejected;
+		}
+	}
+	if (numberOfRejected != 2)
+	{
+		throw runtime_error("resumableRunTest: a checkpoint is loaded into an engine with another generator.");
+	}
+
+	// Nor with another path construction: the same numbers give other paths
+	UTValuationEngineMonteCarloBlackSholesDynamics engine5(*volModel, arithmeticOption, generator, 0, 4, 0.0, UT_ErrorType::UT_ABSOLUTE, nullptr, UT_PathConstruction::UT_BROWNIAN_BRIDGE);
+	checkpoint.clear();
+	checkpoint.seekg(0);
+	bool rejected = false;
+	try
+	{
+		engine5.loadCheckpoint(checkpoint);
+	}
+	catch (const runtime_error&)
+	{
+		rejected = true;
+	}
+	if (!rejected)
+	{
+		throw runtime_error("resumableRunTest: a checkpoint is loaded into an engine with another path construction.");
+	}
+}
+
+void greeksTest()
+{
+	const double spotPrice = 100.0;
+	const double vol = 0.2;
+	const double rate = 0.03;
+	UTModelBlackSholesDynamics model(spotPrice, vol, rate);
+	UTRandomSobol generator;
+
+	// European call: the Greeks in the Monte Carlo pass against the analytic ones (by bumping the closed form)
+	UTProductEuropeanOptionCall vanillaCall(1.0, 1.0, UT_BuySell::UT_BUY, spotPrice);
+	UTValuationEngineMonteCarloBlackSholesDynamics engine(model, vanillaCall, generator, 65536, 4, 0.0, UT_ErrorType::UT_ABSOLUTE, nullptr, UT_PathConstruction::UT_INCREMENTAL, true);
+
+	double pvUp = 0.0, pvDown = 0.0;
+	UTValuationEngineFactory::newValuationEngineAnalytic(UTModelBlackSholesDynamics(spotPrice + 0.01, vol, rate), vanillaCall, true)->calculatePV(pvUp);
+	UTValuationEngineFactory::newValuationEngineAnalytic(UTModelBlackSholesDynamics(spotPrice - 0.01, vol, rate), vanillaCall, true)->calculatePV(pvDown);
+	double analyticDelta = (pvUp - pvDown) / 0.02;
+
+	pvUp = pvDown = 0.0;
+	UTValuationEngineFactory::newValuationEngineAnalytic(UTModelBlackSholesDynamics(spotPrice, vol + 0.0001, rate), vanillaCall, true)->calculatePV(pvUp);
+	UTValuationEngineFactory::newValuationEngineAnalytic(UTModelBlackSholesDynamics(spotPrice, vol - 0.0001, rate), vanillaCall, true)->calculatePV(pvDown);
+	double analyticVega = (pvUp - pvDown) / 0.0002;
+
+	double pv = 0.0;
+	pvUp = pvDown = 0.0;
+	UTValuationEngineFactory::newValuationEngineAnalytic(model, vanillaCall, true)->calculatePV(pv);
+	UTValuationEngineFactory::newValuationEngineAnalytic(UTModelBlackSholesDynamics(spotPrice + 0.1, vol, rate), vanillaCall, true)->calculatePV(pvUp);
+	UTValuationEngineFactory::newValuationEngineAnalytic(UTModelBlackSholesDynamics(spotPrice - 0.1, vol, rate), vanillaCall, true)->calculatePV(pvDown);
+	double analyticGamma = (pvUp - 2.0 * pv + pvDown) / 0.01;
+
+	cout << "European call: analytic delta " << analyticDelta << ", vega " << analyticVega << ", gamma " << analyticGamma << ".\n";
+
+	UT_GreekMethod methods[] = { UT_GreekMethod::UT_PATHWISE, UT_GreekMethod::UT_LIKELIHOOD_RATIO };
+	for (UT_GreekMethod method : methods)
+	{
+		const UTStatisticsMonteCarlo& delta = engine.deltaStatistics(method);
+		const UTStatisticsMonteCarlo& vega = engine.vegaStatistics(method);
+		const UTStatisticsMonteCarlo& gamma = engine.gammaStatistics(method);
+		cout << (method == UT_GreekMethod::UT_PATHWISE ? "  pathwise:          " : "  likelihood ratio:  ")
+			<< "delta " << delta.mean() << " +/- " << delta.standardError() << ", vega " << vega.mean() << " +/- " << vega.standardError()
+			<< ", gamma " << gamma.mean() << " +/- " << gamma.standardError() << ".\n";
+
+		if (fabs(delta.mean() - analyticDelta) > 4.0 * delta.standardError() + 1.0e-3 || fabs(vega.mean() - analyticVega) > 4.0 * vega.standardError() + 1.0e-1
+			|| fabs(gamma.mean() - analyticGamma) > 4.0 * gamma.standardError() + 1.0e-4)
+		{
+			throw runtime_error("greeksTest: the Monte Carlo Greeks are not the analytic ones.");
+		}
+	}
+
+	// Arithmetic Asian on the same paths: against bump and revalue with the same paths
+	UTProductPathDependentAsian asianOption(0.0, 1.0, 12, 1.0, UT_CallPut::UT_CALL, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_ARITHMETIC);
+	unique_ptr<UTValuationEngineBase> asianEngine(UTValuationEngineFactory::newValuationEngineMonteCarloGreeks(model, asianOption, generator, 65536, 4, true));
+
+	double delta = 0.0, vega = 0.0;
+	double deltaLikelihoodRatio = 0.0, vegaLikelihoodRatio = 0.0;
+	dynamic_cast<UTValuationEngineMonteCarlo&>(*asianEngine).calculateGreeks(delta, vega);
+	dynamic_cast<UTValuationEngineMonteCarlo&>(*asianEngine).calculateGreeks(deltaLikelihoodRatio, vegaLikelihoodRatio, UT_GreekMethod::UT_LIKELIHOOD_RATIO);
+
+	pvUp = pvDown = 0.0;
+	UTValuationEngineMonteCarloBlackSholesDynamics(UTModelBlackSholesDynamics(spotPrice + 1.0, vol, rate), asianOption, generator, 65536, 4).calculatePV(pvUp);
+	UTValuationEngineMonteCarloBlackSholesDynamics(UTModelBlackSholesDynamics(spotPrice - 1.0, vol, rate), asianOption, generator, 65536, 4).calculatePV(pvDown);
+	double bumpedDelta = (pvUp - pvDown) / 2.0;
+
+	pvUp = pvDown = 0.0;
+	UTValuationEngineMonteCarloBlackSholesDynamics(UTModelBlackSholesDynamics(spotPrice, vol + 0.01, rate), asianOption, generator, 65536, 4).calculatePV(pvUp);
+	UTValuationEngineMonteCarloBlackSholesDynamics(UTModelBlackSholesDynamics(spotPrice, vol - 0.01, rate), asianOption, generator, 65536, 4).calculatePV(pvDown);
+	double bumpedVega = (pvUp - pvDown) / 0.02;
+
+	cout << "Arithmetic Asian: pathwise delta " << delta << ", vega " << vega << "; likelihood ratio delta " << deltaLikelihoodRatio << ", vega " << vegaLikelihoodRatio
+		<< "; bump and revalue delta " << bumpedDelta << ", vega " << bumpedVega << ".\n";
+
+	if (fabs(delta - bumpedDelta) > 1.0e-2 || fabs(vega - bumpedVega) > 2.0e-1)
+	{
+		throw runtime_error("greeksTest: the pathwise Greeks are not the bumped ones.");
+	}
+
+	// The first fixing is the spot itself: the likelihood ratio delta takes its pathwise derivative, and agrees with the pathwise one
+	const UTValuationEngineMonteCarlo& asianMonteCarlo = dynamic_cast<const UTValuationEngineMonteCarlo&>(*asianEngine);
+	double pathwiseError = asianMonteCarlo.deltaStatistics(UT_GreekMethod::UT_PATHWISE).standardError();
+	double likelihoodRatioError = asianMonteCarlo.deltaStatistics(UT_GreekMethod::UT_LIKELIHOOD_RATIO).standardError();
+	if (fabs(deltaLikelihoodRatio - delta) > 4.0 * sqrt(pathwiseError * pathwiseError + likelihoodRatioError * likelihoodRatioError))
+	{
+		throw runtime_error("greeksTest: the likelihood ratio delta is not the pathwise one.");
+	}
+
+	// ... but there is no estimator of its gamma on the path
+	bool thrown = false;
+	try
+	{
+		asianMonteCarlo.gammaStatistics();
+	}
+	catch (const runtime_error&)
+	{
+		thrown = true;
+	}
+	if (!thrown)
+	{
+		throw runtime_error("greeksTest: a gamma with a fixing at the spot date.");
+	}
+}
+
+void aadTest()
+{
+	// Yield curve with 10 pillars
+	vector<double> curveTimes{ 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0 };
+	vector<double> curveRates{ 0.010, 0.013, 0.016, 0.019, 0.022, 0.025, 0.027, 0.029, 0.031, 0.033 };
+	UTModelYieldCurve yieldCurve(curveTimes, curveRates);
+
+	UTProductSwapVanilla vanillaSwap(0, 10.0, 0.025, 0.5, 0.5, 10000.0, UT_PayReceive::UT_RECEIVE);
+
+	// All the sensitivities from one reverse sweep
+	const int numberOfRuns = 200;
+	vector<double> rateSensitivities, volSensitivities;
+	auto start = chrono::steady_clock::now();
+	for (int run = 0; run < numberOfRuns; ++run)
+	{
+		rateSensitivities.assign(curveRates.size(), 0.0);
+		auto pricer(UTValuationEngineFactory::newValuationEngineAnalytic(yieldCurve, vanillaSwap, true));
+		pricer->calculatePillarSensitivities(rateSensitivities, volSensitivities);
+	}
+	double aadTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	// Bump and revalue (central differences)
+	const double bump = 1.0e-6;
+	vector<double> bumpedSensitivities(curveRates.size());
+	start = chrono::steady_clock::now();
+	for (int run = 0; run < numberOfRuns; ++run)
+	{
+		for (unsigned long i = 0; i < curveRates.size(); ++i)
+		{
+			vector<double> rates(curveRates);
+			double pvUp = 0.0, pvDown = 0.0;
+			rates[i] = curveRates[i] + bump;
+			UTValuationEngineFactory::newValuationEngineAnalytic(UTModelYieldCurve(curveTimes, rates), vanillaSwap, true)->calculatePV(pvUp);
+			rates[i] = curveRates[i] - bump;
+			UTValuationEngineFactory::newValuationEngineAnalytic(UTModelYieldCurve(curveTimes, rates), vanillaSwap, true)->calculatePV(pvDown);
+			bumpedSensitivities[i] = (pvUp - pvDown) / (2.0 * bump);
+		}
+	}
+	double bumpTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	cout << "Swap pillar sensitivities (AAD / bump):\n";
+	for (unsigned long i = 0; i < curveRates.size(); ++i)
+	{
+		cout << "  " << curveTimes[i] << "y: " << rateSensitivities[i] << " / " << bumpedSensitivities[i] << "\n";
+		if (fabs(rateSensitivities[i] - bumpedSensitivities[i]) > 1.0e-3 * (1.0 + fabs(bumpedSensitivities[i])))
+		{
+			throw runtime_error("aadTest: the AAD sensitivities of the swap are not the bumped ones.");
+		}
+	}
+	cout << "time of the AAD " << aadTime / numberOfRuns * 1.0e6 << " us, of the bumps " << bumpTime / numberOfRuns * 1.0e6 << " us.\n";
+
+	// Black Sholes model: the rate and the vol pillars
+	vector<double> volTimes{ 0.5, 1.0, 2.0 };
+	vector<double> vols{ 0.2, 0.25, 0.3 };
+	const double spotPrice = 100.0;
+	UTModelBlackSholesDynamics volModel(spotPrice, volTimes, vols);
+	volModel.setModelYieldCurve(yieldCurve);
+
+	UTProductEuropeanOptionCall vanillaCall(2.0, 1.0, UT_BuySell::UT_BUY, 95.0);
+	UTProductPathDependentAsian geometricOption(0.0, 2.0, 24, 1.0, UT_CallPut::UT_PUT, UT_BuySell::UT_BUY, spotPrice, UT_AverageType::UT_GEOMETRIC);
+	const UTProductBase* products[] = { &vanillaCall, &geometricOption };
+
+	for (const UTProductBase* product : products)
+	{
+		auto pricer(UTValuationEngineFactory::newValuationEngineAnalytic(volModel, *product, true));
+		rateSensitivities.clear();
+		volSensitivities.clear();
+		pricer->calculatePillarSensitivities(rateSensitivities, volSensitivities);
+
+		cout << product->classTag() << " vol pillar sensitivities (AAD / bump):";
+		for (unsigned long i = 0; i < vols.size(); ++i)
+		{
+			vector<double> bumpedVols(vols);
+			double pvUp = 0.0, pvDown = 0.0;
+
+			bumpedVols[i] = vols[i] + bump;
+			UTModelBlackSholesDynamics modelUp(spotPrice, volTimes, bumpedVols);
+			modelUp.setModelYieldCurve(yieldCurve);
+			UTValuationEngineFactory::newValuationEngineAnalytic(modelUp, *product, true)->calculatePV(pvUp);
+
+			bumpedVols[i] = vols[i] - bump;
+			UTModelBlackSholesDynamics modelDown(spotPrice, volTimes, bumpedVols);
+			modelDown.setModelYieldCurve(yieldCurve);
+			UTValuationEngineFactory::newValuationEngineAnalytic(modelDown, *product, true)->calculatePV(pvDown);
+
+			double bumped = (pvUp - pvDown) / (2.0 * bump);
+			cout << " " << volSensitivities[i] << " / " << bumped;
+			if (fabs(volSensitivities[i] - bumped) > 1.0e-4 * (1.0 + fabs(bumped)))
+			{
+				throw runtime_error("aadTest: the AAD vol sensitivities are not the bumped ones.");
+			}
+		}
+		cout << "\n";
+
+		cout << product->classTag() << " rate pillar sensitivities (AAD / bump):";
+		for (unsigned long i = 0; i < curveRates.size(); ++i)
+		{
+			vector<double> rates(curveRates);
+			double pvUp = 0.0, pvDown = 0.0;
+
+			rates[i] = curveRates[i] + bump;
+			UTModelBlackSholesDynamics modelUp(spotPrice, volTimes, vols);
+			modelUp.setModelYieldCurve(UTModelYieldCurve(curveTimes, rates));
+			UTValuationEngineFactory::newValuationEngineAnalytic(modelUp, *product, true)->calculatePV(pvUp);
+
+			rates[i] = curveRates[i] - bump;
+			UTModelBlackSholesDynamics modelDown(spotPrice, volTimes, vols);
+			modelDown.setModelYieldCurve(UTModelYieldCurve(curveTimes, rates));
+			UTValuationEngineFactory::newValuationEngineAnalytic(modelDown, *product, true)->calculatePV(pvDown);
+
+			double bumped = (pvUp - pvDown) / (2.0 * bump);
+			cout << " " << rateSensitivities[i] << " / " << bumped;
+			if (fabs(rateSensitivities[i] - bumped) > 1.0e-4 * (1.0 + fabs(bumped)))
+			{
+				throw runtime_error("aadTest: the AAD rate sensitivities are not the bumped ones.");
+			}
+		}
+		cout << "\n";
+	}
+}
+
+namespace
+{
+	// The walk along the time line of the original lnDf, with flat forward rates: the reference of yieldCurveLookupTest
+	double walkLnDf(const vector<double>& timeLine, const vector<double>& rates, double time)
+	{
+		if (time < 0.0)
+		{
+			return 0.0;
+		}
+
+		double previousTime = 0.0;
+		double sum = 0.0;
+		for (unsigned long i = 0; i < timeLine.size(); ++i)
+		{
+			if (timeLine[i] > time)
+			{
+				return sum + rates[i] * (time - previousTime);
+			}
+			sum += rates[i] * (timeLine[i] - previousTime);
+			previousTime = timeLine[i];
+		}
+
+		return sum + rates.back() * (time - previousTime);
+	}
+}
+
+void yieldCurveLookupTest()
+{
+	// 40 pillars
+	vector<double> curveTimes, curveRates;
+	for (unsigned long i = 0; i < 40; ++i)
+	{
+		curveTimes.push_back(0.25 * (i + 1) * (1.0 + 0.05 * i));
+		curveRates.push_back(0.01 + 0.03 * sin(0.2 * i) * sin(0.2 * i));
+	}
+	UTModelYieldCurve yieldCurve(curveTimes, curveRates);
+
+	// The cashflows of a swap portfolio: 200000 payment times, in increasing order
+	const unsigned long numberOfFlows = 200000;
+	vector<double> times(numberOfFlows);
+	for (unsigned long k = 0; k < numberOfFlows; ++k)
+		times[k] = -1.0 + 60.0 * k / numberOfFlows;
+
+	// The lookup against the walk, at the pillars too (the same sums, so the same numbers)
+	vector<double> checkTimes(times);
+	checkTimes.insert(checkTimes.end(), curveTimes.begin(), curveTimes.end());
+	checkTimes.push_back(0.0);
+	for (double time : checkTimes)
+	{
+		if (yieldCurve.lnDf(time) != walkLnDf(curveTimes, curveRates, time))
+		{
+			throw runtime_error("yieldCurveLookupTest: the lookup is not the walk along the time line.");
+		}
+	}
+
+	auto start = chrono::steady_clock::now();
+	double sumWalk = 0.0;
+	for (unsigned long k = 0; k < numberOfFlows; ++k)
+		sumWalk += exp(-1.0 * walkLnDf(curveTimes, curveRates, times[k]));
+	double walkTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	start = chrono::steady_clock::now();
+	double sumLookup = 0.0;
+	for (unsigned long k = 0; k < numberOfFlows; ++k)
+		sumLookup += yieldCurve.df(times[k]);
+	double lookupTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	vector<double> dfs(numberOfFlows);
+	start = chrono::steady_clock::now();
+	yieldCurve.df(&times[0], &dfs[0], numberOfFlows);
+	double batchTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	for (unsigned long k = 0; k < numberOfFlows; ++k)
+	{
+		if (dfs[k] != yieldCurve.df(times[k]))
+		{
+			throw runtime_error("yieldCurveLookupTest: the batch discount factors are not the scalar ones.");
+		}
+	}
+
+	// Times out of order
+	vector<double> shuffledTimes{ 3.0, 0.5, 12.0, -0.5, 7.0, 7.0, 1.0, 80.0, 0.0 };
+	vector<double> shuffledDfs(shuffledTimes.size());
+	yieldCurve.df(&shuffledTimes[0], &shuffledDfs[0], shuffledTimes.size());
+	for (unsigned long k = 0; k < shuffledTimes.size(); ++k)
+	{
+		if (shuffledDfs[k] != exp(-1.0 * walkLnDf(curveTimes, curveRates, shuffledTimes[k])))
+		{
+			throw runtime_error("yieldCurveLookupTest: the batch discount factors out of order are not the walk ones.");
+		}
+	}
+
+	cout << numberOfFlows << " discount factors on 40 pillars: walk " << walkTime * 1.0e3 << " ms, binary search " << lookupTime * 1.0e3
+		<< " ms (" << walkTime / lookupTime << " times faster), batch merge " << batchTime * 1.0e3 << " ms (" << walkTime / batchTime
+		<< " times faster) (sums " << sumWalk << ", " << sumLookup << ").\n";
+
+	if (sumLookup != sumWalk)
+	{
+		throw runtime_error("yieldCurveLookupTest: the discount factors are not the walk ones.");
+	}
+}
+
+void yieldCurveInterpolationTest()
+{
+	vector<double> curveTimes{ 0.5, 1.0, 2.0, 3.0, 5.0, 7.0, 10.0 };
+	vector<double> curveRates{ 0.010, 0.012, 0.017, 0.020, 0.024, 0.026, 0.027 };
+
+	const UTModelYieldCurve::UT_InterpolateeType interpolatees[] = { UTModelYieldCurve::UT_FWD_RATE, UTModelYieldCurve::UT_ZERO_RATE, UTModelYieldCurve::UT_MINUS_LOG_DF };
+	const UTModelYieldCurve::UT_InterpolationMethod methods[] = { UTModelYieldCurve::UT_FLAT, UTModelYieldCurve::UT_LINEAR, UTModelYieldCurve::UT_CUBIC_SPLINE };
+	const char* interpolateeNames[] = { "fwd rate", "zero rate", "-log df" };
+	const char* methodNames[] = { "flat", "linear", "cubic spline" };
+	const double h = 1.0e-6;
+
+	for (int j = 0; j < 3; ++j)
+	{
+		for (int m = 0; m < 3; ++m)
+		{
+			// A flat -log df has zero forward rates: it is rejected
+			if (interpolatees[j] == UTModelYieldCurve::UT_MINUS_LOG_DF && methods[m] == UTModelYieldCurve::UT_FLAT)
+			{
+				bool thrown = false;
+				try
+				{
+					UTModelYieldCurve flatCurve(curveTimes, curveRates, interpolatees[j], methods[m]);
+				}
+				catch (const runtime_error&)
+				{
+					thrown = true;
+				}
+				if (!thrown)
+				{
+					throw runtime_error("yieldCurveInterpolationTest: a flat -log df curve is built.");
+				}
+				continue;
+			}
+
+			UTModelYieldCurve yieldCurve(curveTimes, curveRates, interpolatees[j], methods[m]);
+
+			for (unsigned long i = 0; i < curveTimes.size(); ++i)
+			{
+				double t = curveTimes[i];
+
+				// The rates are the interpolatee at the pillars: the zero rates, or the forward rates (left and right limits for flat)
+				double atPillar = interpolatees[j] == UTModelYieldCurve::UT_FWD_RATE ? (yieldCurve.lnDf(t) - yieldCurve.lnDf(t - h)) / h : yieldCurve.lnDf(t) / t;
+				if (fabs(atPillar - curveRates[i]) > 1.0e-6)
+				{
+					throw runtime_error("yieldCurveInterpolationTest: the curve does not return its rates at the pillars.");
+				}
+
+				// The discount factor is continuous (but for piecewise constant zero rates)
+				if ((methods[m] != UTModelYieldCurve::UT_FLAT || interpolatees[j] == UTModelYieldCurve::UT_FWD_RATE) && fabs(yieldCurve.lnDf(t + 1.0e-10) - yieldCurve.lnDf(t)) > 1.0e-9)
+				{
+					throw runtime_error("yieldCurveInterpolationTest: the curve is not continuous.");
+				}
+
+				// The spline of the zero rates (or -log df) has a continuous first derivative: so has the forward rate (inside the time line, the extrapolation is flat)
+				if (methods[m] == UTModelYieldCurve::UT_CUBIC_SPLINE && interpolatees[j] != UTModelYieldCurve::UT_FWD_RATE && i > 0 && i + 1 < curveTimes.size())
+				{
+					double left = (yieldCurve.lnDf(t) - yieldCurve.lnDf(t - h)) / h;
+					double right = (yieldCurve.lnDf(t + h) - yieldCurve.lnDf(t)) / h;
+					if (fabs(left - right) > 1.0e-4)
+					{
+						throw runtime_error("yieldCurveInterpolationTest: the forward rate of the spline is not continuous.");
+					}
+				}
+			}
+
+			// Linear zero rates, by hand
+			if (interpolatees[j] == UTModelYieldCurve::UT_ZERO_RATE && methods[m] == UTModelYieldCurve::UT_LINEAR)
+			{
+				double t = 4.0;
+				double zeroRate = 0.020 + (0.024 - 0.020) * (4.0 - 3.0) / (5.0 - 3.0);
+				if (fabs(yieldCurve.lnDf(t) - zeroRate * t) > 1.0e-15)
+				{
+					throw runtime_error("yieldCurveInterpolationTest: the linear zero rate is wrong.");
+				}
+			}
+
+			cout << interpolateeNames[j] << ", " << methodNames[m] << ": df(4y) " << yieldCurve.df(4.0) << ", fwd(4y, 4.5y) " << yieldCurve.forwardRate(4.0, 4.5) << "\n";
+		}
+	}
+
+	// The spline of rates on a line is the line
+	vector<double> lineRates;
+	for (double t : curveTimes)
+		lineRates.push_back(0.01 + 0.002 * t);
+	UTModelYieldCurve lineCurve(curveTimes, lineRates, UTModelYieldCurve::UT_ZERO_RATE, UTModelYieldCurve::UT_CUBIC_SPLINE);
+	for (double t = 0.5; t <= 10.0; t += 0.25)
+	{
+		if (fabs(lineCurve.lnDf(t) - (0.01 + 0.002 * t) * t) > 1.0e-14)
+		{
+			throw runtime_error("yieldCurveInterpolationTest: the spline of a line is not the line.");
+		}
+	}
+
+	// AAD through the spline against bumps
+	UTModelYieldCurve splineCurve(curveTimes, curveRates, UTModelYieldCurve::UT_ZERO_RATE, UTModelYieldCurve::UT_CUBIC_SPLINE);
+	UTProductSwapVanilla vanillaSwap(0, 8.0, 0.025, 0.5, 0.5, 10000.0, UT_PayReceive::UT_RECEIVE);
+	vector<double> rateSensitivities(curveRates.size(), 0.0), volSensitivities;
+	UTValuationEngineFactory::newValuationEngineAnalytic(splineCurve, vanillaSwap, true)->calculatePillarSensitivities(rateSensitivities, volSensitivities);
+	const double bump = 1.0e-6;
+	for (unsigned long i = 0; i < curveRates.size(); ++i)
+	{
+		vector<double> rates(curveRates);
+		double pvUp = 0.0, pvDown = 0.0;
+		rates[i] = curveRates[i] + bump;
+		UTValuationEngineFactory::newValuationEngineAnalytic(UTModelYieldCurve(curveTimes, rates, UTModelYieldCurve::UT_ZERO_RATE, UTModelYieldCurve::UT_CUBIC_SPLINE), vanillaSwap, true)->calculatePV(pvUp);
+		rates[i] = curveRates[i] - bump;
+		UTValuationEngineFactory::newValuationEngineAnalytic(UTModelYieldCurve(curveTimes, rates, UTModelYieldCurve::UT_ZERO_RATE, UTModelYieldCurve::UT_CUBIC_SPLINE), vanillaSwap, true)->calculatePV(pvDown);
+		double bumped = (pvUp - pvDown) / (2.0 * bump);
+		if (fabs(rateSensitivities[i] - bumped) > 1.0e-3 * (1.0 + fabs(bumped)))
+		{
+			throw runtime_error("yieldCurveInterpolationTest: the AAD sensitivities through the spline are not the bumped ones.");
+		}
+	}
+
+	// The calibration with each interpolation reprices the swaps
+	vector<double> swapMaturities{ 1.0, 2.0, 3.0, 5.0, 7.0, 10.0 };
+	vector<double> swapRates{ 0.011, 0.014, 0.018, 0.022, 0.025, 0.027 };
+	for (int j = 0; j < 3; ++j)
+	{
+		for (int m = 0; m < 3; ++m)
+		{
+			if (interpolatees[j] == UTModelYieldCurve::UT_MINUS_LOG_DF && methods[m] == UTModelYieldCurve::UT_FLAT)
+				continue;
+
+			auto calibratedCurve(UTModelFactory::newModelYieldCurve(swapMaturities, swapRates, methods[m], interpolatees[j]));
+			for (unsigned long i = 0; i < swapMaturities.size(); ++i)
+			{
+				UTProductSwapVanilla swap(0, swapMaturities[i], swapRates[i], 0.5, 0.5, 10000.0, UT_PayReceive::UT_RECEIVE);
+				double pv = 0.0;
+				UTValuationEngineFactory::newValuationEngineAnalytic(*calibratedCurve, swap, true)->calculatePV(pv);
+				if (fabs(pv) > 1.0e-8)
+				{
+					throw runtime_error("yieldCurveInterpolationTest: the calibrated curve does not reprice the swaps.");
+				}
+			}
+		}
+	}
+
+	// The cost of the lookup
+	const unsigned long numberOfFlows = 200000;
+	for (int m = 0; m < 3; ++m)
+	{
+		UTModelYieldCurve yieldCurve(curveTimes, curveRates, UTModelYieldCurve::UT_ZERO_RATE, methods[m]);
+		auto start = chrono::steady_clock::now();
+		double sum = 0.0;
+		for (unsigned long k = 0; k < numberOfFlows; ++k)
+			sum += yieldCurve.df(12.0 * k / numberOfFlows);
+		double lookupTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cout << methodNames[m] << " zero rates: " << numberOfFlows << " discount factors in " << lookupTime * 1.0e3 << " ms (sum " << sum << ").\n";
+	}
+}
+
+void yieldCurveBootstrapTest()
+{
+	// 60 swaps, every 6 months up to 30 years
+	vector<double> swapMaturities, swapRates;
+	for (unsigned long i = 0; i < 60; ++i)
+	{
+		swapMaturities.push_back(0.5 * (i + 1));
+		swapRates.push_back(0.005 + 0.025 * (1.0 - exp(-0.1 * swapMaturities.back())));
+	}
+
+	// The bootstrap of the factory
+	const int numberOfRuns = 20;
+	unique_ptr<UTModelYieldCurve> yieldCurve;
+	auto start = chrono::steady_clock::now();
+	for (int run = 0; run < numberOfRuns; ++run)
+		yieldCurve = UTModelFactory::newModelYieldCurve(swapMaturities, swapRates);
+	double bootstrapTime = chrono::duration<double>(chrono::steady_clock::now() - start).count() / numberOfRuns;
+
+	// The bisection on the PV of an engine built at each iteration
+	UTModelYieldCurve engineCurve(swapMaturities, swapRates);
+	start = chrono::steady_clock::now();
+	for (unsigned int i = 0; i < swapMaturities.size(); ++i)
+	{
+		UTProductSwapVanilla vanillaSwap(0, swapMaturities[i], swapRates[i], 0.5, 0.5, 10000.0, UT_PayReceive::UT_RECEIVE);
+		UTSolveForModelComponent2 solver(engineCurve, vanillaSwap, 0.0, i);
+		bisection(solver, -0.1, 1.0);
+	}
+	double engineTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	for (unsigned int i = 0; i < swapMaturities.size(); ++i)
+	{
+		UTProductSwapVanilla vanillaSwap(0, swapMaturities[i], swapRates[i], 0.5, 0.5, 10000.0, UT_PayReceive::UT_RECEIVE);
+		double pv = 0.0;
+		UTValuationEngineFactory::newValuationEngineAnalytic(*yieldCurve, vanillaSwap, true)->calculatePV(pv);
+		if (fabs(pv) > 1.0e-8 || fabs(yieldCurve->ratePillars()[i] - engineCurve.ratePillars()[i]) > 1.0e-12)
+		{
+			throw runtime_error("yieldCurveBootstrapTest: the bootstrap does not reprice the swaps.");
+		}
+	}
+
+	// The other interpolations
+	start = chrono::steady_clock::now();
+	auto linearCurve(UTModelFactory::newModelYieldCurve(swapMaturities, swapRates, UTModelYieldCurve::UT_LINEAR, UTModelYieldCurve::UT_ZERO_RATE));
+	double linearTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	start = chrono::steady_clock::now();
+	auto splineCurve(UTModelFactory::newModelYieldCurve(swapMaturities, swapRates, UTModelYieldCurve::UT_CUBIC_SPLINE, UTModelYieldCurve::UT_ZERO_RATE));
+	double splineTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	for (unsigned int i = 0; i < swapMaturities.size(); ++i)
+	{
+		UTProductSwapVanilla vanillaSwap(0, swapMaturities[i], swapRates[i], 0.5, 0.5, 10000.0, UT_PayReceive::UT_RECEIVE);
+		double linearPv = 0.0, splinePv = 0.0;
+		UTValuationEngineFactory::newValuationEngineAnalytic(*linearCurve, vanillaSwap, true)->calculatePV(linearPv);
+		UTValuationEngineFactory::newValuationEngineAnalytic(*splineCurve, vanillaSwap, true)->calculatePV(splinePv);
+		if (fabs(linearPv) > 1.0e-8 || fabs(splinePv) > 1.0e-8)
+		{
+			throw runtime_error("yieldCurveBootstrapTest: the bootstrap does not reprice the swaps with the linear or spline interpolation.");
+		}
+	}
+
+	// The spline bootstrap of annual swaps (the coupons between the pillars move with all of them) cut after 2 passes has not settled:
+	// it throws instead of returning a curve which does not reprice the swaps
+	vector<double> annualMaturities, annualRates;
+	for (unsigned long i = 1; i < swapMaturities.size(); i += 2)
+	{
+		annualMaturities.push_back(swapMaturities[i]);
+		annualRates.push_back(swapRates[i]);
+	}
+	UTModelYieldCurve cutCurve(annualMaturities, annualRates, UTModelYieldCurve::UT_ZERO_RATE, UTModelYieldCurve::UT_CUBIC_SPLINE);
+	UTSolveForYieldCurve solver(cutCurve, annualMaturities, annualRates);
+	bool thrown = false;
+	try
+	{
+		solver.bootstrap(0, 2);
+	}
+	catch (const runtime_error&)
+	{
+		thrown = true;
+	}
+	if (!thrown)
+	{
+		throw runtime_error("yieldCurveBootstrapTest: the bootstrap cut before convergence does not throw.");
+	}
+
+	cout << "60 pillar bootstrap: Newton on the cashflows " << bootstrapTime * 1.0e6 << " us, bisection on the engines " << engineTime * 1.0e6
+		<< " us (linear zero rates " << linearTime * 1.0e6 << " us, spline " << splineTime * 1.0e6 << " us).\n";
+}
+
+namespace
+{
+	// The live curve with its publication open to the timing of liveYieldCurveTest
+	class UTModelYieldCurveLivePublisher : public UTModelYieldCurveLive
+	{
+	public:
+		UTModelYieldCurveLivePublisher(const vector<double>& swapMaturities, const vector<double>& swapRates)
+			: UTModelYieldCurveLive(swapMaturities, swapRates) {}
+
+		using UTModelYieldCurveLive::publish;
+	};
+}
+
+void liveYieldCurveTest()
+{
+	// 60 swaps, every 6 months up to 30 years
+	vector<double> swapMaturities, swapRates;
+	for (unsigned long i = 0; i < 60; ++i)
+	{
+		swapMaturities.push_back(0.5 * (i + 1));
+		swapRates.push_back(0.005 + 0.025 * (1.0 - exp(-0.1 * swapMaturities.back())));
+	}
+
+	// A market data stream of single quote ticks (within 2bp of the initial quotes), written to a stream and replayed from it
+	const unsigned long numberOfTicks = 20000;
+	stringstream ticks;
+	{
+		UTRandomParkMiller generator(2);
+		vector<double> variates(2);
+		vector<double> quotes(swapRates);
+		for (unsigned long k = 0; k < numberOfTicks; ++k)
+		{
+			generator.nextUniformVector(variates);
+			unsigned long i = static_cast<unsigned long>(variates[0] * quotes.size()) % quotes.size();
+			quotes[i] = swapRates[i] + 0.0004 * (variates[1] - 0.5);
+			ticks.precision(17);
+			ticks << i << " " << quotes[i] << "\n";
+		}
+	}
+
+	vector<unsigned long> tickPillars;
+	vector<double> tickRates;
+	{
+		unsigned long i;
+		double rate;
+		while (ticks >> i >> rate)
+		{
+			tickPillars.push_back(i);
+			tickRates.push_back(rate);
+		}
+	}
+
+	UTModelYieldCurveLivePublisher liveCurve(swapMaturities, swapRates);
+
+	// A reader takes the versions while they are published
+	atomic<bool> done(false);
+	atomic<unsigned long> numberOfReads(0);
+	atomic<bool> readError(false);
+	thread reader([&]()
+	{
+		unsigned long lastVersion = 0;
+		while (!done.load())
+		{
+			shared_ptr<const UTModelYieldCurveLive::UTVersion> latest(liveCurve.latest());
+			if (latest->number < lastVersion || latest->curve.ratePillars().size() != swapMaturities.size() || !(latest->curve.df(10.0) > 0.0))
+				readError = true;
+			lastVersion = latest->number;
+			++numberOfReads;
+		}
+	});
+
+	auto start = chrono::steady_clock::now();
+	for (unsigned long k = 0; k < tickPillars.size(); ++k)
+	{
+		liveCurve.updateQuote(tickPillars[k], tickRates[k]);
+		swapRates[tickPillars[k]] = tickRates[k];
+	}
+	double updateTime = chrono::duration<double>(chrono::steady_clock::now() - start).count() / tickPillars.size();
+
+	done = true;
+	reader.join();
+
+	if (readError || liveCurve.version() != numberOfTicks)
+	{
+		throw runtime_error("liveYieldCurveTest: a reader did not get a consistent version of the curve.");
+	}
+
+	// The last version is the curve calibrated to the last quotes
+	auto yieldCurve(UTModelFactory::newModelYieldCurve(swapMaturities, swapRates));
+	shared_ptr<const UTModelYieldCurve> lastCurve(liveCurve.curve());
+	for (unsigned long i = 0; i < swapMaturities.size(); ++i)
+	{
+		UTProductSwapVanilla vanillaSwap(0, swapMaturities[i], swapRates[i], 0.5, 0.5, 10000.0, UT_PayReceive::UT_RECEIVE);
+		double pv = 0.0;
+		UTValuationEngineFactory::newValuationEngineAnalytic(*lastCurve, vanillaSwap, true)->calculatePV(pv);
+		if (fabs(pv) > 1.0e-8 || fabs(lastCurve->ratePillars()[i] - yieldCurve->ratePillars()[i]) > 1.0e-12)
+		{
+			throw runtime_error("liveYieldCurveTest: the live curve is not the curve calibrated to the last quotes.");
+		}
+	}
+
+	// A quote 50bp above the others moves the forward rate of its pillar so far that the next pillar would need a rate below -10%:
+	// the update throws, publishes nothing and rolls back the quote and the curve which the next updates start from
+	shared_ptr<const UTModelYieldCurveLive::UTVersion> before(liveCurve.latest());
+	bool thrown = false;
+	try
+	{
+		liveCurve.updateQuote(30, 0.03);
+	}
+	catch (const runtime_error&)
+	{
+		thrown = true;
+	}
+	if (!thrown || liveCurve.latest() != before)
+	{
+		throw runtime_error("liveYieldCurveTest: the update to a quote which cannot be calibrated should throw and publish nothing.");
+	}
+
+	liveCurve.updateQuote(59, swapRates[59] + 0.0001);
+	swapRates[59] += 0.0001;
+	yieldCurve = UTModelFactory::newModelYieldCurve(swapMaturities, swapRates);
+	for (unsigned long i = 0; i < swapMaturities.size(); ++i)
+	{
+		if (fabs(liveCurve.curve()->ratePillars()[i] - yieldCurve->ratePillars()[i]) > 1.0e-12)
+		{
+			throw runtime_error("liveYieldCurveTest: the update which failed was not rolled back.");
+		}
+	}
+
+	// The other interpolations, on the first ticks
+	const UTModelYieldCurve::UT_InterpolationMethod methods[] = { UTModelYieldCurve::UT_LINEAR, UTModelYieldCurve::UT_CUBIC_SPLINE };
+	for (UTModelYieldCurve::UT_InterpolationMethod method : methods)
+	{
+		vector<double> quotes(swapMaturities.size());
+		for (unsigned long i = 0; i < swapMaturities.size(); ++i)
+			quotes[i] = 0.005 + 0.025 * (1.0 - exp(-0.1 * swapMaturities[i]));
+
+		UTModelYieldCurveLive otherCurve(swapMaturities, quotes, method, UTModelYieldCurve::UT_ZERO_RATE);
+		for (unsigned long k = 0; k < 100; ++k)
+		{
+			otherCurve.updateQuote(tickPillars[k], tickRates[k]);
+			quotes[tickPillars[k]] = tickRates[k];
+		}
+
+		auto otherYieldCurve(UTModelFactory::newModelYieldCurve(swapMaturities, quotes, method, UTModelYieldCurve::UT_ZERO_RATE));
+		for (unsigned long i = 0; i < swapMaturities.size(); ++i)
+		{
+			if (fabs(otherCurve.curve()->ratePillars()[i] - otherYieldCurve->ratePillars()[i]) > 1.0e-10)
+			{
+				throw runtime_error("liveYieldCurveTest: the live curve is not the curve calibrated to the last quotes (linear or spline zero rates).");
+			}
+		}
+	}
+
+	// The same ticks without a reader sharing the cores
+	start = chrono::steady_clock::now();
+	for (unsigned long k = 0; k < tickPillars.size(); ++k)
+		liveCurve.updateQuote(tickPillars[k], tickRates[k]);
+	double updateTimeAlone = chrono::duration<double>(chrono::steady_clock::now() - start).count() / tickPillars.size();
+
+	// The publication of a version: a copy of the 60 pillars and of their interpolation in a single allocation, stored atomically
+	const unsigned long lastVersion = liveCurve.version();
+	start = chrono::steady_clock::now();
+	for (unsigned long run = 1; run <= 1000; ++run)
+		liveCurve.publish(lastVersion + run);
+	double publishTime = chrono::duration<double>(chrono::steady_clock::now() - start).count() / 1000;
+	if (publishTime > 1.0e-5 || liveCurve.version() != lastVersion + 1000)
+	{
+		throw runtime_error("liveYieldCurveTest: the publication of a version should take less than 10 us.");
+	}
+
+	// The full bootstrap for comparison
+	start = chrono::steady_clock::now();
+	for (int run = 0; run < 20; ++run)
+		yieldCurve = UTModelFactory::newModelYieldCurve(swapMaturities, swapRates);
+	double bootstrapTime = chrono::duration<double>(chrono::steady_clock::now() - start).count() / 20;
+
+	// The target of an update is 10 us: reported, not asserted, as the time depends on the machine
+	cout << tickPillars.size() << " ticks on a 60 pillar curve: " << updateTime * 1.0e6 << " us per update with a reader, "
+		<< updateTimeAlone * 1.0e6 << " us without (publication " << publishTime * 1.0e6 << " us, full bootstrap " << bootstrapTime * 1.0e6 << " us), " << numberOfReads.load() << " reads of the published versions.\n";
+	cout << "Update target 10 us: " << (updateTimeAlone <= 1.0e-5 ? "met" : "missed") << " without a reader, " << (updateTime <= 1.0e-5 ? "met" : "missed") << " with one.\n";
+}
+
+void volCalibrationClosedFormTest()
+{
+	// 40 maturities, every 3 months up to 10 years, on a skewed term structure
+	vector<double> optionMaturities, impVols;
+	for (unsigned long i = 0; i < 40; ++i)
+	{
+		optionMaturities.push_back(0.25 * (i + 1));
+		impVols.push_back(0.15 + 0.1 * exp(-0.5 * optionMaturities.back()));
+	}
+	double spotPrice = 100.0;
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve());
+
+	// The forward variances of the factory
+	const int numberOfRuns = 100;
+	unique_ptr<UTModelBlackSholesDynamics> volModel;
+	vector<double> residuals;
+	auto start = chrono::steady_clock::now();
+	for (int run = 0; run < numberOfRuns; ++run)
+		volModel = UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVols, pYieldCurve,
+			UTModelBlackSholesDynamics::UT_FLAT, UTModelBlackSholesDynamics::UT_INST_VOL, &residuals);
+	double closedFormTime = chrono::duration<double>(chrono::steady_clock::now() - start).count() / numberOfRuns;
+
+	// The bisection on the PV of an engine built at each iteration
+	UTModelBlackSholesDynamics engineModel(spotPrice, optionMaturities, impVols);
+	engineModel.setModelYieldCurve(*pYieldCurve);
+	start = chrono::steady_clock::now();
+	for (unsigned int i = 0; i < optionMaturities.size(); ++i)
+	{
+		double maturity = optionMaturities[i];
+		double fwdPrice = engineModel.forwardPrice(maturity);
+		UTProductEuropeanOptionCall callOption(maturity, 1.0, UT_BuySell::UT_BUY, fwdPrice);
+		UTEuropeanOptionLogNormal black(fwdPrice, fwdPrice, maturity, impVols[i]);
+		UTSolveForModelComponent2 solver(engineModel, callOption, black.premium(UT_CallPut::UT_CALL) * engineModel.df(maturity), i);
+		bisection(solver, 0.00001, 3.0);
+	}
+	double engineTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	double maxResidual = 0.0;
+	for (unsigned int i = 0; i < optionMaturities.size(); ++i)
+	{
+		maxResidual = max(maxResidual, fabs(residuals[i]));
+		if (fabs(volModel->vol(optionMaturities[i]) - engineModel.vol(optionMaturities[i])) > 1.0e-10)
+		{
+			throw runtime_error("volCalibrationClosedFormTest: the forward variances do not match the bisection on the engines.");
+		}
+	}
+	if (maxResidual > 1.0e-10)
+	{
+		throw runtime_error("volCalibrationClosedFormTest: the calibrated model does not reprice the ATM calls.");
+	}
+
+	// The safeguarded Newton for the interpolations with no closed form
+	vector<double> newtonResiduals;
+	auto newtonModel(UTModelFactory::newModelBlackSholesDynamics(spotPrice, optionMaturities, impVols, pYieldCurve,
+		UTModelBlackSholesDynamics::UT_LINEAR, UTModelBlackSholesDynamics::UT_VARIANCE, &newtonResiduals));
+	for (unsigned int i = 0; i < optionMaturities.size(); ++i)
+	{
+		if (fabs(newtonResiduals[i]) > 1.0e-10 || fabs(newtonModel->logVariance(0.0, optionMaturities[i]) - impVols[i] * impVols[i] * optionMaturities[i]) > 1.0e-12)
+		{
+			throw runtime_error("volCalibrationClosedFormTest: the Newton calibration does not reprice the ATM calls.");
+		}
+	}
+
+	// A decreasing total variance is a calendar arbitrage
+	vector<double> arbitrageVols{ 0.3, 0.2 };
+	vector<double> arbitrageMaturities{ 1.0, 2.0 };
+	bool thrown = false;
+	try
+	{
+		UTModelFactory::newModelBlackSholesDynamics(spotPrice, arbitrageMaturities, arbitrageVols, pYieldCurve);
+	}
+	catch (const runtime_error&)
+	{
+		thrown = true;
+	}
+	if (!thrown)
+	{
+		throw runtime_error("volCalibrationClosedFormTest: the calendar arbitrage is not detected.");
+	}
+
+	cout << "40 pillar vol calibration: forward variances " << closedFormTime * 1.0e6 << " us, bisection on the engines " << engineTime * 1.0e6
+		<< " us, max ATM call residual " << maxResidual << ".\n";
+}
+
+void blackBatchTest()
+{
+	// A book of calls, puts and straddles, with some expired, zero vol and zero strike options
+	const unsigned long numberOfOptions = 1000000;
+	vector<double> forwards(numberOfOptions), strikes(numberOfOptions), timesToExpiry(numberOfOptions), sigmas(numberOfOptions);
+	vector<UT_CallPut> callPuts(numberOfOptions);
+	UTRandomParkMiller generator(4);
+	vector<double> variates(4);
+	for (unsigned long i = 0; i < numberOfOptions; ++i)
+	{
+		generator.nextUniformVector(variates);
+		forwards[i] = 50.0 + 100.0 * variates[0];
+		strikes[i] = i % 101 == 0 ? 0.0 : 50.0 + 100.0 * variates[1];
+		timesToExpiry[i] = i % 97 == 0 ? -0.1 : 3.0 * variates[2];
+		sigmas[i] = i % 89 == 0 ? 0.0 : 0.05 + 0.5 * variates[3];
+		callPuts[i] = i % 3 == 0 ? UT_CallPut::UT_CALL : i % 3 == 1 ? UT_CallPut::UT_PUT : UT_CallPut::UT_STRADDLE;
+	}
+
+	vector<double> premiums(numberOfOptions), deltas(numberOfOptions), gammas(numberOfOptions), vegas(numberOfOptions), thetas(numberOfOptions);
+	auto start = chrono::steady_clock::now();
+	UTEuropeanOptionLogNormal::blackBatch(&forwards[0], &strikes[0], &timesToExpiry[0], &sigmas[0], &callPuts[0], numberOfOptions,
+		&premiums[0], &deltas[0], &gammas[0], &vegas[0], &thetas[0]);
+	double batchTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	// The pricer objects
+	double maxError = 0.0;
+	start = chrono::steady_clock::now();
+	for (unsigned long i = 0; i < numberOfOptions; ++i)
+	{
+		UTEuropeanOptionLogNormal option(forwards[i], strikes[i], timesToExpiry[i], sigmas[i]);
+		double error = fabs(option.premium(callPuts[i]) - premiums[i]) + fabs(option.delta(callPuts[i]) - deltas[i])
+			+ fabs(option.gamma(callPuts[i]) - gammas[i]) + fabs(option.vega(callPuts[i]) - vegas[i]) + fabs(option.theta(callPuts[i]) - thetas[i]);
+		if (!(error < 1.0e-10))
+		{
+			throw runtime_error("blackBatchTest: the batch pricer does not match the pricer objects.");
+		}
+		maxError = max(maxError, error);
+	}
+	double objectTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	cout << "1M options: batch " << numberOfOptions / batchTime * 1.0e-6 << "M options/s, pricer objects " << numberOfOptions / objectTime * 1.0e-6
+		<< "M options/s, max difference " << maxError << ".\n";
+}
+
+void bachelierBatchTest()
+{
+	// A grid of normal vol options on rates, some of them negative, with some expired and zero vol options
+	const unsigned long numberOfOptions = 1000000;
+	vector<double> forwards(numberOfOptions), strikes(numberOfOptions), timesToExpiry(numberOfOptions), sigmas(numberOfOptions);
+	vector<UT_CallPut> callPuts(numberOfOptions);
+	UTRandomParkMiller generator(4);
+	vector<double> variates(4);
+	for (unsigned long i = 0; i < numberOfOptions; ++i)
+	{
+		generator.nextUniformVector(variates);
+		forwards[i] = -0.01 + 0.06 * variates[0];
+		strikes[i] = -0.01 + 0.06 * variates[1];
+		timesToExpiry[i] = i % 97 == 0 ? -0.1 : 10.0 * variates[2];
+		sigmas[i] = i % 89 == 0 ? 0.0 : 0.002 + 0.01 * variates[3];
+		callPuts[i] = i % 3 == 0 ? UT_CallPut::UT_CALL : i % 3 == 1 ? UT_CallPut::UT_PUT : UT_CallPut::UT_STRADDLE;
+	}
+
+	vector<double> premiums(numberOfOptions), deltas(numberOfOptions), gammas(numberOfOptions), vegas(numberOfOptions), thetas(numberOfOptions);
+	const int numberOfRuns = 10;
+	auto start = chrono::steady_clock::now();
+	for (int run = 0; run < numberOfRuns; ++run)
+		UTEuropeanOptionNormal::bachelierBatch(&forwards[0], &strikes[0], &timesToExpiry[0], &sigmas[0], &callPuts[0], numberOfOptions,
+			&premiums[0], &deltas[0], &gammas[0], &vegas[0], &thetas[0]);
+	double batchTime = chrono::duration<double>(chrono::steady_clock::now() - start).count() / numberOfRuns;
+
+	// The same memory traffic without the calculations: 4 doubles and the type read, 5 doubles written per option
+	// (the premiums are read too, so that the runs are not merged by the compiler: their cache lines are read anyway to be written)
+	start = chrono::steady_clock::now();
+	for (int run = 0; run < numberOfRuns; ++run)
+		for (unsigned long i = 0; i < numberOfOptions; ++i)
+		{
+			double sum = forwards[i] + strikes[i] + timesToExpiry[i] + sigmas[i] + static_cast<int>(callPuts[i]) + premiums[i];
+			premiums[i] = deltas[i] = gammas[i] = vegas[i] = thetas[i] = sum;
+		}
+	double copyTime = chrono::duration<double>(chrono::steady_clock::now() - start).count() / numberOfRuns;
+
+	UTEuropeanOptionNormal::bachelierBatch(&forwards[0], &strikes[0], &timesToExpiry[0], &sigmas[0], &callPuts[0], numberOfOptions,
+		&premiums[0], &deltas[0], &gammas[0], &vegas[0], &thetas[0]);
+
+	// The pricer objects
+	double maxError = 0.0;
+	start = chrono::steady_clock::now();
+	for (unsigned long i = 0; i < numberOfOptions; ++i)
+	{
+		UTEuropeanOptionNormal option(forwards[i], strikes[i], timesToExpiry[i], sigmas[i]);
+		double error = fabs(option.premium(callPuts[i]) - premiums[i]) + fabs(option.delta(callPuts[i]) - deltas[i])
+			+ fabs(option.gamma(callPuts[i]) - gammas[i]) * 1.0e-4 + fabs(option.vega(callPuts[i]) - vegas[i]) + fabs(option.theta(callPuts[i]) - thetas[i]);
+		if (!(error < 1.0e-12))
+		{
+			throw runtime_error("bachelierBatchTest: the batch pricer does not match the pricer objects.");
+		}
+		maxError = max(maxError, error);
+	}
+	double objectTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	cout << "1M normal vol options: batch " << numberOfOptions / batchTime * 1.0e-6 << "M options/s, memory traffic alone " << numberOfOptions / copyTime * 1.0e-6
+		<< "M options/s, pricer objects " << numberOfOptions / objectTime * 1.0e-6 << "M options/s, max difference " << maxError << ".\n";
+}
+
+void impliedVolatilityTest()
+{
+	// The exact premiums (erfc, not the approximation of cumulativeNormal) of out of the money options on a grid of strikes, expiries and vols
+	auto exactCumulativeNormal = [](double x) { return 0.5 * erfc(-x / sqrt(2.0)); };
+	vector<double> forwards, strikes, timesToExpiry, blackPremiums, bachelierPremiums, blackSigmas, bachelierSigmas;
+	vector<UT_CallPut> callPuts;
+	for (double moneyness = -3.0; moneyness <= 3.0; moneyness += 0.05)
+		for (double timeToExpiry = 0.1; timeToExpiry <= 10.0; timeToExpiry *= 1.5)
+			for (double sigma = 0.05; sigma <= 1.0; sigma *= 1.25)
+			{
+				double forward = 100.0;
+				double stdDev = sigma * sqrt(timeToExpiry);
+				double strike = forward * exp(moneyness * stdDev);
+				double omega = strike >= forward ? 1.0 : -1.0;
+				double d1 = log(forward / strike) / stdDev + 0.5 * stdDev;
+				double blackPremium = omega * (forward * exactCumulativeNormal(omega * d1) - strike * exactCumulativeNormal(omega * (d1 - stdDev)));
+
+				// The normal vol: the same stdDev in price
+				double normalStdDev = stdDev * forward;
+				double d = (forward - strike) / normalStdDev;
+				double bachelierPremium = omega * (forward - strike) * exactCumulativeNormal(omega * d) + normalStdDev * exp(-0.5 * d * d) / sqrt(2.0 * 3.14159265358979324);
+
+				forwards.push_back(forward);
+				strikes.push_back(strike);
+				timesToExpiry.push_back(timeToExpiry);
+				callPuts.push_back(omega > 0.0 ? UT_CallPut::UT_CALL : UT_CallPut::UT_PUT);
+				blackPremiums.push_back(blackPremium);
+				bachelierPremiums.push_back(bachelierPremium);
+				blackSigmas.push_back(sigma);
+				bachelierSigmas.push_back(sigma * forward);
+			}
+
+	// The batch solvers
+	const unsigned long numberOfQuotes = forwards.size();
+	vector<double> sigmas(numberOfQuotes);
+	unique_ptr<bool[]> valid(new bool[numberOfQuotes]);
+	auto start = chrono::steady_clock::now();
+	UTEuropeanOptionLogNormal::blackImpliedSigmaBatch(&blackPremiums[0], &forwards[0], &strikes[0], &timesToExpiry[0], &callPuts[0], numberOfQuotes, &sigmas[0], valid.get());
+	double blackTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	double blackError = 0.0;
+	for (unsigned long i = 0; i < numberOfQuotes; ++i)
+		blackError = max(blackError, valid[i] ? fabs(sigmas[i] / blackSigmas[i] - 1.0) : 1.0);
+
+	start = chrono::steady_clock::now();
+	UTEuropeanOptionNormal::bachelierImpliedSigmaBatch(&bachelierPremiums[0], &forwards[0], &strikes[0], &timesToExpiry[0], &callPuts[0], numberOfQuotes, &sigmas[0], valid.get());
+	double bachelierTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	// (the premiums of the far strikes are below the smallest double for the normal vols)
+	double bachelierError = 0.0;
+	for (unsigned long i = 0; i < numberOfQuotes; ++i)
+		if (bachelierPremiums[i] > 1.0e-200)
+			bachelierError = max(bachelierError, valid[i] ? fabs(sigmas[i] / bachelierSigmas[i] - 1.0) : 1.0);
+
+	if (!(blackError < 1.0e-12 && bachelierError < 1.0e-12))
+	{
+		throw runtime_error("impliedVolatilityTest: the implied sigmas do not match.");
+	}
+
+	// The number of Householder steps
+	vector<unsigned long> blackSteps(5, 0), bachelierSteps(5, 0);
+	for (unsigned long i = 0; i < numberOfQuotes; ++i)
+	{
+		unsigned long iterations;
+		UTEuropeanOptionLogNormal::blackImpliedSigma(blackPremiums[i], forwards[i], strikes[i], timesToExpiry[i], callPuts[i], &iterations);
+		++blackSteps[min(iterations, 4UL)];
+		if (bachelierPremiums[i] > 1.0e-200)
+		{
+			UTEuropeanOptionNormal::bachelierImpliedSigma(bachelierPremiums[i], forwards[i], strikes[i], timesToExpiry[i], callPuts[i], &iterations);
+			++bachelierSteps[min(iterations, 4UL)];
+		}
+	}
+
+	if (blackSteps[3] + blackSteps[4] > 0 || bachelierSteps[3] + bachelierSteps[4] > 0)
+	{
+		throw runtime_error("impliedVolatilityTest: the first guesses should leave two Householder steps at most.");
+	}
+
+	// The quotes with no implied sigma: puts above the strike, and below the intrinsic value
+	double noSigma[2];
+	bool noSigmaValid[2];
+	double badPremiums[2] = { 100.0, 1.0 };
+	double badStrikes[2] = { 90.0, 150.0 };
+	vector<UT_CallPut> puts(2, UT_CallPut::UT_PUT);
+	UTEuropeanOptionLogNormal::blackImpliedSigmaBatch(badPremiums, &forwards[0], badStrikes, &timesToExpiry[0], &puts[0], 2, noSigma, noSigmaValid);
+	if (noSigmaValid[0] || noSigmaValid[1])
+	{
+		throw runtime_error("impliedVolatilityTest: a premium out of the bounds has an implied sigma.");
+	}
+
+	// In situ: the solver is the first guess of the Newton on premium(), and a deep out of the money quote is found
+	UTEuropeanOptionLogNormal deepOption(100.0, 400.0, 1.0, 0.2);
+	double deepSigma = deepOption.impliedSigma(UTEuropeanOptionLogNormal(100.0, 400.0, 1.0, 0.8).premium(UT_CallPut::UT_CALL), UT_CallPut::UT_CALL);
+	if (fabs(deepSigma - 0.8) > 1.0e-12)
+	{
+		throw runtime_error("impliedVolatilityTest: the in situ implied sigma of a deep out of the money option is wrong.");
+	}
+
+	cout << numberOfQuotes << " quotes: lognormal " << blackTime / numberOfQuotes * 1.0e9 << " ns/quote (max relative error " << blackError
+		<< "), normal " << bachelierTime / numberOfQuotes * 1.0e9 << " ns/quote (max relative error " << bachelierError << ").\n";
+	cout << "Householder steps (1, 2, 3, 4 or more): lognormal " << blackSteps[1] << " " << blackSteps[2] << " " << blackSteps[3] << " " << blackSteps[4]
+		<< ", normal " << bachelierSteps[1] << " " << bachelierSteps[2] << " " << bachelierSteps[3] << " " << bachelierSteps[4] << ".\n";
+}
+
+void volSurfaceTest()
+{
+	// A snapshot of 50k quotes: a call and a put on 1250 strikes for each of 20 expiries, with exact premiums (erfc)
+	// on a skewed smile whose total variance is proportional to the time (no arbitrage)
+	auto exactCumulativeNormal = [](double x) { return 0.5 * erfc(-x / sqrt(2.0)); };
+	auto trueVariance = [](double logMoneyness) { return 0.04 + 0.1 * (-0.4 * logMoneyness + sqrt(logMoneyness * logMoneyness + 0.01)); };
+	const double spot = 100.0;
+	shared_ptr<const UTModelYieldCurve> pYieldCurve(new UTModelYieldCurve(0.02));
+
+	const unsigned long numberOfExpiries = 20, numberOfStrikes = 1250;
+	vector<double> premiums, forwards, strikes, timesToExpiry;
+	vector<UT_CallPut> callPuts;
+	for (unsigned long e = 0; e < numberOfExpiries; ++e)
+	{
+		double timeToExpiry = 0.25 * (e + 1);
+		double forward = spot / pYieldCurve->df(timeToExpiry);
+		for (unsigned long k = 0; k < numberOfStrikes; ++k)
+		{
+			double logMoneyness = (-4.0 + 7.0 * k / (numberOfStrikes - 1)) * 0.25 * sqrt(timeToExpiry);
+			double strike = forward * exp(logMoneyness);
+			double stdDev = sqrt(trueVariance(logMoneyness) * timeToExpiry);
+
+			// The expiry of 2 years is quoted 20% below in variance: below the smile of 1.75 years (calendar arbitrage)
+			if (e == 7)
+				stdDev *= sqrt(0.8);
+
+			double d1 = -logMoneyness / stdDev + 0.5 * stdDev;
+			for (double omega = -1.0; omega <= 1.0; omega += 2.0)
+			{
+				premiums.push_back(omega * (forward * exactCumulativeNormal(omega * d1) - strike * exactCumulativeNormal(omega * (d1 - stdDev))));
+				forwards.push_back(forward);
+				strikes.push_back(strike);
+				timesToExpiry.push_back(timeToExpiry);
+				callPuts.push_back(omega > 0.0 ? UT_CallPut::UT_CALL : UT_CallPut::UT_PUT);
+			}
+		}
+	}
+	const unsigned long numberOfQuotes = premiums.size();
+
+	// Some bad quotes: 20% too expensive (above the hull), and below the intrinsic value (no implied vol)
+	vector<unsigned long> badQuotes;
+	for (unsigned long i = 101; i < numberOfQuotes; i += 997)
+	{
+		badQuotes.push_back(i);
+		premiums[i] = callPuts[i] == UT_CallPut::UT_CALL && strikes[i] < forwards[i] ? 0.5 * (forwards[i] - strikes[i]) : 1.2 * premiums[i];
+	}
+
+	// Under-priced calls near the money (30% off their time value): below the hull, where they would push their neighbours out
+	vector<unsigned long> cheapQuotes;
+	for (unsigned long e = 1; e < numberOfExpiries; e += 4)
+	{
+		unsigned long i = 2 * (e * numberOfStrikes + 650 + 10 * e) + 1;
+		cheapQuotes.push_back(i);
+		double intrinsicValue = max(forwards[i] - strikes[i], 0.0);
+		premiums[i] = intrinsicValue + 0.7 * (premiums[i] - intrinsicValue);
+	}
+
+	// The surface on one thread and on all of them (at least 4): the same result
+	vector<bool> accepted, acceptedParallel;
+	auto start = chrono::steady_clock::now();
+	auto surface(UTModelFactory::newVolSurface(&premiums[0], &forwards[0], &strikes[0], &timesToExpiry[0], &callPuts[0], numberOfQuotes, 1, &accepted));
+	double serialTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	unsigned long numberOfThreads = max(thread::hardware_concurrency(), 4U);
+	start = chrono::steady_clock::now();
+	auto parallelSurface(UTModelFactory::newVolSurface(&premiums[0], &forwards[0], &strikes[0], &timesToExpiry[0], &callPuts[0], numberOfQuotes, numberOfThreads, &acceptedParallel));
+	double parallelTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	if (acceptedParallel != accepted || parallelSurface->expiries() != surface->expiries() || parallelSurface->vol(120.0, 1.3, 101.0) != surface->vol(120.0, 1.3, 101.0))
+	{
+		throw runtime_error("volSurfaceTest: the surface depends on the number of threads.");
+	}
+
+	// The bad quotes and the expiry with a calendar arbitrage are rejected, the other quotes are kept
+	unsigned long numberOfRejected = 0;
+	for (unsigned long i = 0; i < numberOfQuotes; ++i)
+		numberOfRejected += accepted[i] ? 0 : 1;
+	for (unsigned long i : badQuotes)
+	{
+		if (accepted[i])
+		{
+			throw runtime_error("volSurfaceTest: a bad quote is in the surface.");
+		}
+	}
+	if (surface->expiries().size() != numberOfExpiries - 1 || find(surface->expiries().begin(), surface->expiries().end(), 2.0) != surface->expiries().end())
+	{
+		throw runtime_error("volSurfaceTest: the expiry with a calendar arbitrage is in the surface.");
+	}
+	if (numberOfRejected > 2 * numberOfStrikes + 4 * badQuotes.size() + 2 * cheapQuotes.size())
+	{
+		throw runtime_error("volSurfaceTest: too many quotes are rejected.");
+	}
+
+	// The under-priced quotes are rejected as outliers, and the quotes of the strikes next to them are kept
+	for (unsigned long i : cheapQuotes)
+	{
+		if (accepted[i] || !accepted[i - 2] || !accepted[i - 3] || !accepted[i + 1] || !accepted[i + 2])
+		{
+			throw runtime_error("volSurfaceTest: an under-priced quote is in the surface, or it pushes its neighbours out.");
+		}
+	}
+
+	// The lookups, inside the quoted strikes
+	const unsigned long numberOfLookups = 1000000;
+	vector<double> lookupStrikes(numberOfLookups), lookupTimes(numberOfLookups), lookupForwards(numberOfLookups);
+	UTRandomParkMiller generator(4);
+	vector<double> variates(4);
+	for (unsigned long i = 0; i < numberOfLookups; ++i)
+	{
+		generator.nextUniformVector(variates);
+		lookupTimes[i] = 0.25 + 4.75 * variates[0];
+		lookupForwards[i] = spot / pYieldCurve->df(lookupTimes[i]);
+		lookupStrikes[i] = lookupForwards[i] * exp((-0.9 + 1.8 * variates[1]) * 0.25 * sqrt(lookupTimes[i]));
+	}
+
+	vector<double> lookupVols(numberOfLookups);
+	start = chrono::steady_clock::now();
+	for (unsigned long i = 0; i < numberOfLookups; ++i)
+		lookupVols[i] = surface->vol(lookupStrikes[i], lookupTimes[i], lookupForwards[i]);
+	double lookupTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	double lookupError = 0.0;
+	for (unsigned long i = 0; i < numberOfLookups; ++i)
+		lookupError = max(lookupError, fabs(lookupVols[i] - sqrt(trueVariance(log(lookupStrikes[i] / lookupForwards[i])))));
+	if (!(lookupError < 1.0e-4))
+	{
+		throw runtime_error("volSurfaceTest: the smile of the surface is not the one of the quotes.");
+	}
+
+	// The model and the pricers on the surface: a call of 120 at 3.1 years
+	auto volModel(UTModelFactory::newModelBlackSholesDynamics(spot, surface, pYieldCurve));
+	UTProductEuropeanOptionCall callOption(3.1, 1.0, UT_BuySell::UT_BUY, 120.0);
+	auto pricer(UTValuationEngineFactory::newValuationEngineAnalytic(*volModel, callOption));
+	double enginePv = 0.0;
+	pricer->calculatePV(enginePv);
+
+	double forward = volModel->forwardPrice(3.1);
+	double surfacePv = UTEuropeanOptionLogNormal(*surface, forward, 120.0, 3.1).premium(UT_CallPut::UT_CALL) * volModel->df(3.1);
+	double smilePv = UTEuropeanOptionLogNormal(forward, 120.0, 3.1, sqrt(trueVariance(log(120.0 / forward)))).premium(UT_CallPut::UT_CALL) * volModel->df(3.1);
+	if (fabs(enginePv - surfacePv) > 1.0e-12 || fabs(enginePv - smilePv) > 1.0e-3)
+	{
+		throw runtime_error("volSurfaceTest: the engine on the model does not price with the smile of the surface.");
+	}
+
+	// The smile is sticky strike: the AAD rate sensitivity (the vol of the strike is a constant on the tape) is the one of a bumped curve
+	vector<double> rateSensitivities, volSensitivities;
+	UTValuationEngineFactory::newValuationEngineAnalytic(*volModel, callOption, true)->calculatePillarSensitivities(rateSensitivities, volSensitivities);
+
+	const double bump = 1.0e-6;
+	double pvUp = 0.0, pvDown = 0.0;
+	shared_ptr<const UTModelYieldCurve> curveUp(new UTModelYieldCurve(0.02 + bump));
+	shared_ptr<const UTModelYieldCurve> curveDown(new UTModelYieldCurve(0.02 - bump));
+	UTValuationEngineFactory::newValuationEngineAnalytic(*UTModelFactory::newModelBlackSholesDynamics(spot, surface, curveUp), callOption, true)->calculatePV(pvUp);
+	UTValuationEngineFactory::newValuationEngineAnalytic(*UTModelFactory::newModelBlackSholesDynamics(spot, surface, curveDown), callOption, true)->calculatePV(pvDown);
+	double bumpedSensitivity = (pvUp - pvDown) / (2.0 * bump);
+	if (rateSensitivities.size() != 1 || fabs(rateSensitivities[0] - bumpedSensitivity) > 1.0e-4 * (1.0 + fabs(bumpedSensitivity)))
+	{
+		throw runtime_error("volSurfaceTest: the AAD rate sensitivity on the vol surface is not the bumped one.");
+	}
+
+	// The Monte Carlo engine does not simulate the smile: it does not take a model with a surface
+	bool thrown = false;
+	try
+	{
+		UTRandomParkMiller pathGenerator;
+		UTValuationEngineFactory::newValuationEngineMonteCarlo(*volModel, callOption, pathGenerator, 1000);
+	}
+	catch (const runtime_error&)
+	{
+		thrown = true;
+	}
+	if (!thrown)
+	{
+		throw runtime_error("volSurfaceTest: the Monte Carlo engine takes a model with a vol surface.");
+	}
+
+	cout << numberOfQuotes << " quotes: surface on 1 thread " << serialTime * 1.0e3 << " ms, on " << numberOfThreads << " threads " << parallelTime * 1.0e3
+		<< " ms, " << numberOfRejected << " quotes rejected.\n";
+	cout << "lookups " << lookupTime / numberOfLookups * 1.0e9 << " ns (max vol error " << lookupError << "), call of 120 at 3.1y: engine " << enginePv
+		<< ", true smile " << smilePv << ", rate sensitivity (AAD / bump) " << rateSensitivities[0] << " / " << bumpedSensitivity << ".\n";
+}
+
+void varianceLookupTest()
+{
+	// 30 vol pillars, on a 40 pillar curve
+	vector<double> volTimes, vols, curveTimes, curveRates;
+	for (unsigned long i = 0; i < 30; ++i)
+	{
+		volTimes.push_back(0.25 * (i + 1));
+		vols.push_back(0.15 + 0.1 * cos(0.3 * i) * cos(0.3 * i));
+	}
+	for (unsigned long i = 0; i < 40; ++i)
+	{
+		curveTimes.push_back(0.25 * (i + 1));
+		curveRates.push_back(0.01 + 0.0005 * i);
+	}
+	UTModelBlackSholesDynamics volModel(100.0, volTimes, vols);
+	volModel.setModelYieldCurve(UTModelYieldCurve(curveTimes, curveRates));
+
+	// The table against the walk along the time line (the template version)
+	for (unsigned long k = 0; k < 2000; ++k)
+	{
+		double startTime = 0.0047 * k;
+		double endTime = startTime + 0.013 * (k % 97);
+		double walk = volModel.logVariance(startTime, endTime, volModel.volPillars());
+		if (fabs(volModel.logVariance(startTime, endTime) - walk) > 1.0e-14 * (1.0 + walk))
+		{
+			throw runtime_error("varianceLookupTest: the cumulative variance is not the walk along the time line.");
+		}
+	}
+
+	// Batch drifts and standard deviations of a monthly time line against the scalar functions
+	const unsigned long numberOfTimes = 120;
+	vector<double> times(numberOfTimes), drifts(numberOfTimes), standardDeviations(numberOfTimes);
+	for (unsigned long i = 0; i < numberOfTimes; ++i)
+		times[i] = (i + 1) / 12.0;
+
+	const int numberOfRuns = 2000;
+	double scalarDrift = 0.0;
+	auto start = chrono::steady_clock::now();
+	for (int run = 0; run < numberOfRuns; ++run)
+	{
+		for (unsigned long i = 0; i < numberOfTimes; ++i)
+		{
+			double previousTime = i > 0 ? times[i - 1] : 0.0;
+			scalarDrift += volModel.logDrift(previousTime, times[i]) + sqrt(volModel.logVariance(previousTime, times[i]));
+		}
+	}
+	double scalarTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	start = chrono::steady_clock::now();
+	for (int run = 0; run < numberOfRuns; ++run)
+		volModel.logDriftsAndStandardDeviations(&times[0], &drifts[0], &standardDeviations[0], numberOfTimes);
+	double batchTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	for (unsigned long i = 0; i < numberOfTimes; ++i)
+	{
+		double previousTime = i > 0 ? times[i - 1] : 0.0;
+		if (fabs(drifts[i] - volModel.logDrift(previousTime, times[i])) > 1.0e-14 || fabs(standardDeviations[i] - sqrt(volModel.logVariance(previousTime, times[i]))) > 1.0e-14)
+		{
+			throw runtime_error("varianceLookupTest: the batch drifts are not the scalar ones.");
+		}
+	}
+
+	cout << "drifts and standard deviations of " << numberOfTimes << " steps: scalar " << scalarTime / numberOfRuns * 1.0e6 << " us, batch " << batchTime / numberOfRuns * 1.0e6
+		<< " us (" << scalarDrift / numberOfRuns << ").\n";
+}
+
 void testConstWrapper()
 {
 	UTWrapper<UTModelBlackSholesDynamics> aaa(new UTModelBlackSholesDynamics);
@@ -173,6 +2080,26 @@ void randomNumberTest()
 
 	}
 
+	// The jump ahead gives the same numbers as the sequential generation
+	UTRandomParkMiller generator3(numberOfDim);
+	UTRandomParkMiller generator4(numberOfDim);
+	generator3.skip(numbeOfPaths);
+	for (unsigned long i = 0; i < numbeOfPaths; ++i)
+		generator4.nextUniformVector(variates);
+
+	vector<double> variates3(numberOfDim);
+	generator3.nextUniformVector(variates3);
+	generator4.nextUniformVector(variates);
+	cout << "after skipping " << numbeOfPaths << " paths: " << variates3[0] << " (jump ahead), " << variates[0] << " (sequential).\n";
+
+	// A large jump is immediate, and a jump by the period leaves the generator unchanged
+	generator3.reset();
+	generator4.reset();
+	generator3.skip(1073741823UL);  // 2 * 1073741823 = 2147483646 = m - 1 integers
+	generator3.nextUniformVector(variates3);
+	generator4.nextUniformVector(variates);
+	cout << "after skipping the period: " << variates3[0] << " (jump ahead), " << variates[0] << " (start of the sequence).\n";
+
 }
 void volModelCalibration()
 {
@@ -14,6 +14,33 @@ void testConstWrapper();
 void pricingTest();
 void yieldCurveCalibration();
 void volModelCalibration();
+void parallelMonteCarloTest();
+void monteCarloStatisticsTest();
+void controlVariateTest();
+void sobolTest();
+void brownianBridgeTest();
+void philoxTest();
+void mathFunctionsTest();
+void zeroAllocationTest();
+void portfolioTest();
+void strikeGridTest();
+void resumableRunTest();
+void greeksTest();
+void aadTest();
+void yieldCurveLookupTest();
+void yieldCurveInterpolationTest();
+void yieldCurveBootstrapTest();
+void liveYieldCurveTest();
+void volCalibrationClosedFormTest();
+void blackBatchTest();
+void bachelierBatchTest();
+void impliedVolatilityTest();
+void volSurfaceTest();
+void varianceLookupTest();
+
+// The number of heap allocations of the program so far (see zeroAllocationTest): UTTestAllocations.cpp replaces the global
+// operator new, in its own file so that the compiler does not inline it into the code of the tests.
+unsigned long numberOfHeapAllocations();
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,52 @@
+/* UTTestAllocations.cpp
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "UTTest.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Count the heap allocations of the program (see zeroAllocationTest)
+namespace
+{
+	atomic<unsigned long> ourNumberOfAllocations(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+unsigned long numberOfHeapAllocations()
+{
+	return ourNumberOfAllocations;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void* operator new(size_t size)
+{
+	++ourNumberOfAllocations;
+	if (void* p = malloc(size > 0 ? size : 1))
+		return p;
+	throw bad_alloc();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The sized version, called instead of the one above when the size is known
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
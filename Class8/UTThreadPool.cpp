@@ -0,0 +1,123 @@
+/* UTThreadPool.cpp
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#include "UTThreadPool.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+UTThreadPool::~UTThreadPool()
+{
+	{
+		lock_guard<mutex> lock(myMutex);
+		myStop = true;
+	}
+	myTasksReady.notify_all();
+
+	for (thread& worker : myThreads)
+		worker.join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+UTThreadPool::UTThreadPool(unsigned long numberOfThreads)
+	: myTask(nullptr),
+	myNumberOfTasks(0),
+	myNextTask(0),
+	myTasksLeft(0),
+	myStop(false)
+{
+	if (numberOfThreads == 0)
+	{
+		numberOfThreads = thread::hardware_concurrency();
+	}
+
+	// The calling thread is the first one
+	for (unsigned long t = 1; t < numberOfThreads; ++t)
+		myThreads.emplace_back(&UTThreadPool::work, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+UTThreadPool& UTThreadPool::pool()
+{
+	static UTThreadPool ourPool;
+	return ourPool;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTThreadPool::run(unsigned long numberOfTasks, const function<void(unsigned long)>& task)
+{
+	if (numberOfTasks == 0)
+	{
+		return;
+	}
+
+	lock_guard<mutex> runLock(myRunMutex);
+	unique_lock<mutex> lock(myMutex);
+
+	myTask = &task;
+	myNumberOfTasks = numberOfTasks;
+	myNextTask = 0;
+	myTasksLeft = numberOfTasks;
+	myErrors.assign(numberOfTasks, exception_ptr());
+	myTasksReady.notify_all();
+
+	// The calling thread takes its share, then waits for the tasks still running on the pool
+	runTasks(lock);
+	myTasksDone.wait(lock, [this]() { return myTasksLeft == 0; });
+	myTask = nullptr;
+
+	for (unsigned long t = 0; t < numberOfTasks; ++t)
+	{
+		if (myErrors[t])
+			rethrow_exception(myErrors[t]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTThreadPool::work()
+{
+	unique_lock<mutex> lock(myMutex);
+	while (true)
+	{
+		myTasksReady.wait(lock, [this]() { return myStop || myNextTask < myNumberOfTasks; });
+		if (myStop)
+		{
+			return;
+		}
+
+		runTasks(lock);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTThreadPool::runTasks(unique_lock<mutex>& lock)
+{
+	while (myNextTask < myNumberOfTasks)
+	{
+		unsigned long t = myNextTask++;
+		const function<void(unsigned long)>& task = *myTask;
+
+		lock.unlock();
+		exception_ptr error;
+		try
+		{
+			task(t);
+		}
+		catch (...)
+		{
+			error = current_exception();
+		}
+		lock.lock();
+
+		myErrors[t] = error;
+		if (--myTasksLeft == 0)
+			myTasksDone.notify_all();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,79 @@
+/* UTThreadPool.h
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#ifndef UT_THREAD_POOL_H
+#define UT_THREAD_POOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// UTThreadPool
+//
+// Threads started once and reused by the calculations which run a few tasks in parallel (see UTModelFactory::newVolSurface
+// and UTValuationEngineMonteCarlo::run), instead of starting and joining threads at each calculation.
+// A run allocates no memory once the pool has run as many tasks, provided the task fits in the small buffer of std::function.
+// run() hands out the tasks to the threads of the pool and to the calling thread, and returns when they are all done.
+// One run at a time: the runs of several threads wait for each other, and a task must not call run() on its own pool.
+//
+class UTThreadPool
+{
+public:
+
+	// Destructor: the threads finish their task and stop.
+	~UTThreadPool();
+
+	// Constructor: the calling thread and numberOfThreads - 1 threads of the pool (0: all the hardware threads)
+	explicit UTThreadPool(unsigned long numberOfThreads = 0);
+
+	// The pool of the process, started at its first use with all the hardware threads
+	static UTThreadPool& pool();
+
+	// Run task(t) for t < numberOfTasks, in any order, and wait for them.
+	// The exception of a task is rethrown once all of them are done (the one of the first task if several throw).
+	void run(unsigned long numberOfTasks, const std::function<void(unsigned long)>& task);
+
+	// The number of threads running the tasks, the calling one included
+	unsigned long numberOfThreads() const { return myThreads.size() + 1; }
+
+private:
+
+	// Not copyable: the threads refer to the pool
+	UTThreadPool(const UTThreadPool&);
+	UTThreadPool& operator=(const UTThreadPool&);
+
+	// The loop of the threads of the pool
+	void work();
+
+	// Run the tasks left of the current run (the lock is released while a task runs)
+	void runTasks(std::unique_lock<std::mutex>& lock);
+
+	std::vector<std::thread> myThreads;
+
+	// The current run: its tasks, the next one to hand out and the number of them not done yet, with their exceptions
+	std::mutex myMutex;
+	std::condition_variable myTasksReady;
+	std::condition_variable myTasksDone;
+	const std::function<void(unsigned long)>* myTask;
+	unsigned long myNumberOfTasks;
+	unsigned long myNextTask;
+	unsigned long myTasksLeft;
+	std::vector<std::exception_ptr> myErrors;
+	bool myStop;
+
+	// The runs one at a time
+	std::mutex myRunMutex;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // UT_THREAD_POOL_H
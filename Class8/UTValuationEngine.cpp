@@ -14,10 +14,33 @@
 #include "UTModelYieldCurve.hpp"
 #include "UTModelBlackSholesDynamics.hpp"
 #include "UTEuropeanOptionLogNormal.hpp"
+#include "UTAad.hpp"
 #include <stdexcept>
 
 using namespace std;
 
+namespace
+{
+	// The PV of a European call or put from the given pillars of the model, for any number type
+	template <class T>
+	T europeanOptionValue(const UTModelBlackSholesDynamics& model, double expiry, double notional, double strike, UT_CallPut callPut, const UTModelYieldCurve::UTInterpolation<T>& curve, const vector<T>& vols)
+	{
+		// An expired option is worth nothing
+		if (expiry < 0.0)
+		{
+			return T(0.0);
+		}
+
+		// The smile of the vol surface does not move with the pillars (sticky strike)
+		T stdDev(0.0);
+		if (expiry > 0.0)
+			stdDev = model.volSurface() ? T(model.vol(expiry, strike) * sqrt(expiry)) : sqrt(model.logVariance(0.0, expiry, vols));
+		T premium = UTEuropeanOptionLogNormal::blackPremium(model.forwardPrice(expiry, curve), strike, stdDev, callPut);
+
+		return notional * premium * model.df(expiry, curve);
+	}
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -29,11 +52,68 @@ UTValuationEngineBase::UTValuationEngineBase(const UTModelBase & model)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void UTValuationEngineBase::calculatePV( double& resultPv )
+void UTValuationEngineBase::calculatePV(double&)
 {
 	throw runtime_error("UTValuationEngineBase::calculatePV() base class function cannot be called.");
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineBase::calculatePVAad(const UTAadPillars&, UTAadNumber&)
+{
+	throw runtime_error("UTValuationEngineBase::calculatePVAad() the valuation engine cannot calculate the PV on the AAD tape.");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineBase::calculatePillarSensitivities(vector<double>& rateSensitivities, vector<double>& volSensitivities)
+{
+	const vector<double>& ratePillars = myModelBase.ratePillars();
+	const vector<double>& volPillars = myModelBase.volPillars();
+
+	// The pillars are the inputs of the tape
+	UTAadTape& tape = UTAadTape::tape();
+	tape.clear();
+
+	UTAadPillars pillars;
+	vector<UTAadNumber>& rates = pillars.rates;
+	vector<UTAadNumber>& vols = pillars.vols;
+
+	rates.resize(ratePillars.size());
+	for (unsigned long i = 0; i < rates.size(); ++i)
+		rates[i] = UTAadNumber::newInput(ratePillars[i]);
+
+	vols.resize(volPillars.size());
+	for (unsigned long i = 0; i < vols.size(); ++i)
+		vols[i] = UTAadNumber::newInput(volPillars[i]);
+
+	// The interpolation of the yield curve, recorded once for all the discount factors
+	if (const UTModelYieldCurve* yieldCurve = myModelBase.yieldCurve())
+	{
+		yieldCurve->calculateInterpolation(rates, pillars.curve);
+	}
+
+	// Forward sweep: the PV on the tape
+	UTAadNumber pv(0.0);
+	calculatePVAad(pillars, pv);
+
+	if (rateSensitivities.size() < rates.size())
+		rateSensitivities.resize(rates.size());
+	if (volSensitivities.size() < vols.size())
+		volSensitivities.resize(vols.size());
+
+	// One reverse sweep gives all the sensitivities (a PV which does not depend on the pillars is a constant)
+	if (pv.isConstant())
+	{
+		return;
+	}
+
+	tape.computeAdjoints(pv.index());
+
+	for (unsigned long i = 0; i < rates.size(); ++i)
+		rateSensitivities[i] += rates[i].adjoint();
+	for (unsigned long i = 0; i < vols.size(); ++i)
+		volSensitivities[i] += vols[i].adjoint();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 //UTValuationEngineCashflowBase
@@ -75,6 +155,17 @@ UTValuationEngineAnalyticLinearBase::calculatePV(double& resultPv)
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Calculates the PV of the Product on the AAD tape and accumulate it
+void
+UTValuationEngineAnalyticLinearBase::calculatePVAad(const UTAadPillars& pillars, UTAadNumber& resultPv)
+{
+	for (unsigned int i = 0; i < size(); ++i)
+	{
+		subValuationEngine(i).calculatePVAad(pillars, resultPv);
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 //  UTValuationEngineAnalyticYieldCurveCashflowBullet
@@ -120,6 +211,18 @@ UTValuationEngineAnalyticYieldCurveCashflowBullet::calculatePV(double& resultPv
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Accumulates the PV of the current product on the AAD tape
+void
+UTValuationEngineAnalyticYieldCurveCashflowBullet::calculatePVAad(const UTAadPillars& pillars, UTAadNumber& resultPv)
+{
+	double payTime = myProductCashflow.paymentTime();
+	if (payTime >= 0.0)
+	{
+		resultPv += myPayment * myModel.df(payTime, pillars.curve);
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 //
@@ -170,6 +273,18 @@ UTValuationEngineAnalyticYieldCurveCashflowRateFixed::calculatePV( double& resul
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Accumulates the PV of the current product on the AAD tape
+void
+UTValuationEngineAnalyticYieldCurveCashflowRateFixed::calculatePVAad(const UTAadPillars& pillars, UTAadNumber& resultPv)
+{
+	const double paymentTime = myProductCashflow.paymentTime();
+	if (paymentTime >= 0.0)
+	{
+		resultPv += myFlowPayment * myModel.df(paymentTime, pillars.curve);
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 //
@@ -230,6 +345,28 @@ UTValuationEngineAnalyticYieldCurveCashflowRateFloat::calculatePV(double& result
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Accumulates the PV of the current product on the AAD tape: the forward rate depends on the pillars too
+void
+UTValuationEngineAnalyticYieldCurveCashflowRateFloat::calculatePVAad(const UTAadPillars& pillars, UTAadNumber& resultPv)
+{
+	const double paymentTime = myProductCashflow.paymentTime();
+	if (paymentTime < 0.0)
+	{
+		return;
+	}
+
+	UTAadNumber forwardRate = myModel.forwardRate(myProductCashflow.startTime(), myProductCashflow.endTime(), pillars.curve);
+
+	double adjustedNotional = myProductCashflow.notional() * myProductCashflow.accrued();
+	if (myProductCashflow.payReceive() == UT_PayReceive::UT_PAY)
+	{
+		adjustedNotional *= -1.0;
+	}
+
+	resultPv += adjustedNotional * (forwardRate + myProductCashflow.spread()) * myModel.df(paymentTime, pillars.curve);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 //UTValuationEngineEuropeanOptionBase
@@ -265,7 +402,7 @@ UTValuationEngineAnalyticBlackSholesDynamicsEuropeanOptionCall::UTValuationEngin
 {
 	double expiry = myProduct.expiryTime();
 
-	UTEuropeanOptionLogNormal black(myModel.forwardPrice(expiry), myProduct.strike(), expiry, myModel.vol(expiry));
+	UTEuropeanOptionLogNormal black(myModel.forwardPrice(expiry), myProduct.strike(), expiry, myModel.vol(expiry, myProduct.strike()));
 
 	myPayment = product.notional() * black.premium(UT_CallPut::UT_CALL);
 	myPaymentDf = myModel.df(expiry);
@@ -273,6 +410,14 @@ UTValuationEngineAnalyticBlackSholesDynamicsEuropeanOptionCall::UTValuationEngin
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Accumulates the PV of the current product on the AAD tape
+void
+UTValuationEngineAnalyticBlackSholesDynamicsEuropeanOptionCall::calculatePVAad(const UTAadPillars& pillars, UTAadNumber& resultPv)
+{
+	resultPv += europeanOptionValue(myModel, myProduct.expiryTime(), myProduct.notional(), myProduct.strike(), UT_CallPut::UT_CALL, pillars.curve, pillars.vols);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 //UTValuationEngineAnalyticBlackSholesDynamicsEuropeanOptionPut
@@ -286,7 +431,7 @@ UTValuationEngineAnalyticBlackSholesDynamicsEuropeanOptionPut::UTValuationEngine
 {
 	double expiry = myProduct.expiryTime();
 
-	UTEuropeanOptionLogNormal black(myModel.forwardPrice(expiry), myProduct.strike(), expiry, myModel.vol(expiry));
+	UTEuropeanOptionLogNormal black(myModel.forwardPrice(expiry), myProduct.strike(), expiry, myModel.vol(expiry, myProduct.strike()));
 
 	myPayment = product.notional() * black.premium(UT_CallPut::UT_PUT);
 	myPaymentDf = myModel.df(expiry);
@@ -294,6 +439,14 @@ UTValuationEngineAnalyticBlackSholesDynamicsEuropeanOptionPut::UTValuationEngine
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Accumulates the PV of the current product on the AAD tape
+void
+UTValuationEngineAnalyticBlackSholesDynamicsEuropeanOptionPut::calculatePVAad(const UTAadPillars& pillars, UTAadNumber& resultPv)
+{
+	resultPv += europeanOptionValue(myModel, myProduct.expiryTime(), myProduct.notional(), myProduct.strike(), UT_CallPut::UT_PUT, pillars.curve, pillars.vols);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 //UTValuationEngineAnalyticBlackSholesDynamicsPathDependentAsianGeometric
@@ -311,49 +464,47 @@ UTValuationEngineAnalyticBlackSholesDynamicsPathDependentAsianGeometric::UTValua
 	}
 
 	// Calculate all the quantities including PV. 
+	myPaymentDf = myModel.df(myProduct.expiryTime());
+	myValue = value(myModel.yieldCurve()->interpolation(), myModel.volPillars());
+	myPayment = myValue / myPaymentDf;
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <class T>
+T UTValuationEngineAnalyticBlackSholesDynamicsPathDependentAsianGeometric::value(const UTModelYieldCurve::UTInterpolation<T>& curve, const vector<T>& vols) const
+{
 	double expiry = myProduct.expiryTime();
 	auto timeLine = myProduct.timeLine();
 	auto numberOfaverage = timeLine.size();
 
 	// Calculate today's "average foward"
-	double tmp = 1.0;
-	double diagonalVolSum = 0;
+	T tmp(1.0);
+	T diagonalVolSum(0.0);
 	for (unsigned long i = 0; i < numberOfaverage; ++i)
 	{
-		tmp *= myModel.forwardPrice(timeLine[i]);
-		diagonalVolSum += model.logVariance(0.0, timeLine[i]);
+		tmp *= myModel.forwardPrice(timeLine[i], curve);
+		diagonalVolSum += myModel.logVariance(0.0, timeLine[i], vols);
 	}
-	double averageFwd = pow(tmp, 1.0 / numberOfaverage);
+	T averageFwd = pow(tmp, 1.0 / numberOfaverage);
 
-	double nonDiagonalVolSum = 0;
+	T nonDiagonalVolSum(0.0);
 	for (unsigned long i = 0; i < numberOfaverage; ++i)
 	{
 		for (unsigned long j = 0; j < i; ++j)
 		{
-			nonDiagonalVolSum += 2.0* model.logVariance(0.0, timeLine[j]);
+			nonDiagonalVolSum += 2.0* myModel.logVariance(0.0, timeLine[j], vols);
 		}
 	}
 
-	double totalVolSum = diagonalVolSum + nonDiagonalVolSum;
-	double vol = sqrt(totalVolSum / expiry) / numberOfaverage;
-	double dividend = 0.5 *  diagonalVolSum / numberOfaverage  * (1.0 / numberOfaverage - 1) + 0.5*nonDiagonalVolSum / numberOfaverage / numberOfaverage;
-	double forward = averageFwd * exp(dividend);
+	T totalVolSum = diagonalVolSum + nonDiagonalVolSum;
+	T stdDev = sqrt(totalVolSum) / numberOfaverage;
+	T dividend = 0.5 *  diagonalVolSum / numberOfaverage  * (1.0 / numberOfaverage - 1) + 0.5*nonDiagonalVolSum / numberOfaverage / numberOfaverage;
+	T forward = averageFwd * exp(dividend);
 
-	UTEuropeanOptionLogNormal black(forward, myProduct.strike(), expiry, vol);
-
-	if (product.callPut() == UT_CallPut:: UT_CALL)
-	{
-		myPayment = product.notional() * static_cast<int>(product.buySell())* black.premium(UT_CallPut:: UT_CALL);
-
-	}
-	else
-	{
-		myPayment = product.notional() * static_cast<int>(product.buySell())*black.premium(UT_CallPut::UT_PUT);
-
-	}
-	myPaymentDf = myModel.df(expiry);
-	myValue = myPayment * myPaymentDf;
+	T premium = UTEuropeanOptionLogNormal::blackPremium(forward, myProduct.strike(), stdDev, myProduct.callPut());
 
+	return myProduct.notional() * static_cast<int>(myProduct.buySell()) * premium * myModel.df(expiry, curve);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -366,5 +517,13 @@ UTValuationEngineAnalyticBlackSholesDynamicsPathDependentAsianGeometric::calcula
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Accumulates the PV of the current product on the AAD tape
+void
+UTValuationEngineAnalyticBlackSholesDynamicsPathDependentAsianGeometric::calculatePVAad(const UTAadPillars& pillars, UTAadNumber& resultPv)
+{
+	resultPv += value(pillars.curve, pillars.vols);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
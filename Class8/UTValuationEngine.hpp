@@ -9,6 +9,8 @@
 
 #include <memory>
 #include <vector>
+#include "UTAad.hpp"
+#include "UTModelYieldCurve.hpp"
 
 // Forward declaration
 class UTModelBase;
@@ -27,6 +29,16 @@ class UTProductPathDependentAsian;
 class UTValuationEngineBase;
 class UTRandomBase;
 
+///////////////////////////////////////////////////////////////////////////////
+// The pillars of the model on the AAD tape (see UTValuationEngineBase::calculatePillarSensitivities), and the interpolation
+// of its yield curve recorded once from the rates: all the discount factors of the calculation share it.
+struct UTAadPillars
+{
+	std::vector<UTAadNumber> rates;
+	std::vector<UTAadNumber> vols;
+	UTModelYieldCurve::UTInterpolation<UTAadNumber> curve;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 class UTValuationEngineBase
@@ -43,6 +55,13 @@ public:
 	// Calculates the PV of the Product and accumulate it in the ResultPV object.
 	virtual void calculatePV( double& result );
 
+	// Calculates the PV of the Product on the AAD tape (see UTAad.hpp) from the given pillars of the model (see UTModelBase::ratePillars), and accumulate it.
+	virtual void calculatePVAad(const UTAadPillars& pillars, UTAadNumber& result);
+
+	// Calculates the sensitivities of the PV to all the rate and vol pillars of the model in one reverse sweep of the AAD tape, and accumulate them
+	// (the vectors are resized to the number of pillars if needed).
+	void calculatePillarSensitivities(std::vector<double>& rateSensitivities, std::vector<double>& volSensitivities);
+
 	// Accessors
 	const UTModelBase  & modelBase() const { return myModelBase; }
 
@@ -69,6 +88,9 @@ public:
 	// Calculates the PV of the Product and accumulate it in the ResultPV object.
 	virtual void calculatePV(double& result);
 
+	// The same on the AAD tape
+	virtual void calculatePVAad(const UTAadPillars& pillars, UTAadNumber& result);
+
 protected:
 
 
@@ -135,6 +157,9 @@ public:
 	// Calculates the PV of the Product and accumulate it in the ResultPV object, in all the currencies it contains -- NO heap allocation
 	virtual void calculatePV(double& resultPv);
 
+	// The same on the AAD tape
+	virtual void calculatePVAad(const UTAadPillars& pillars, UTAadNumber& resultPv);
+
 
 private:
 
@@ -163,6 +188,9 @@ public:
 	// Calculates the PV of the Product and accumulate it in the ResultPV object, in all the currencies it contains -- NO heap allocation
 	virtual void calculatePV(double& resultPv);
 
+	// The same on the AAD tape
+	virtual void calculatePVAad(const UTAadPillars& pillars, UTAadNumber& resultPv);
+
 
 private:
 
@@ -193,6 +221,9 @@ public:
 	// Calculates the PV of the Product and accumulate it in the ResultPV object, in all the currencies it contains -- NO heap allocation
 	virtual void calculatePV(double& resultPv);
 
+	// The same on the AAD tape
+	virtual void calculatePVAad(const UTAadPillars& pillars, UTAadNumber& resultPv);
+
 
 private:
 
@@ -253,6 +284,8 @@ public:
 		const UTModelBlackSholesDynamics & model,
 		const UTProductEuropeanOptionCall  & product);
 
+	// The PV on the AAD tape
+	virtual void calculatePVAad(const UTAadPillars& pillars, UTAadNumber& result);
 
 private:
 
@@ -274,6 +307,8 @@ public:
 		const UTModelBlackSholesDynamics & model,
 		const UTProductEuropeanOptionPut  & product);
 
+	// The PV on the AAD tape
+	virtual void calculatePVAad(const UTAadPillars& pillars, UTAadNumber& result);
 
 private:
 
@@ -298,8 +333,14 @@ public:
 	// Calculates the PV of the Product and accumulate it
 	virtual void calculatePV(double& result);
 
+	// The same on the AAD tape
+	virtual void calculatePVAad(const UTAadPillars& pillars, UTAadNumber& result);
+
 private:
 
+	// The PV from the given pillars of the model, for any number type
+	template <class T> T value(const UTModelYieldCurve::UTInterpolation<T>& curve, const std::vector<T>& vols) const;
+
 	// References to the model and the product
 	const UTModelBlackSholesDynamics   & myModel;
 	const UTProductPathDependentAsian   & myProduct;
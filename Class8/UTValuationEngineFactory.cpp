@@ -42,13 +42,13 @@ unique_ptr<UTValuationEngineBase> UTValuationEngineFactory::newValuationEngineAn
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-unique_ptr<UTValuationEngineBase> UTValuationEngineFactory::newValuationEngineMonteCarlo(const UTModelBase& model, const UTProductBase& product, const UTWrapper<UTRandomBase> & generator, unsigned long numberOfPaths, bool bThrow)
+unique_ptr<UTValuationEngineBase> UTValuationEngineFactory::newValuationEngineMonteCarlo(const UTModelBase& model, const UTProductBase& product, const UTWrapper<UTRandomBase> & generator, unsigned long numberOfPaths, bool bThrow, unsigned long numberOfThreads, UT_PathConstruction pathConstruction)
 {
 	unique_ptr<UTValuationEngineBase> pValuationEngine(nullptr);
 
 	if (model.classTag() == "Black Sholes Dynamics Model")
 	{
-		pValuationEngine.reset(new UTValuationEngineMonteCarloBlackSholesDynamics(dynamic_cast<const UTModelBlackSholesDynamics&>(model), product, generator, numberOfPaths));
+		pValuationEngine.reset(new UTValuationEngineMonteCarloBlackSholesDynamics(dynamic_cast<const UTModelBlackSholesDynamics&>(model), product, generator, numberOfPaths, numberOfThreads, 0.0, UT_ErrorType::UT_ABSOLUTE, nullptr, pathConstruction));
 	}
 	else
 	{
@@ -63,6 +63,111 @@ unique_ptr<UTValuationEngineBase> UTValuationEngineFactory::newValuationEngineMo
 	return pValuationEngine;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+unique_ptr<UTValuationEngineBase> UTValuationEngineFactory::newValuationEngineMonteCarloGreeks(const UTModelBase& model, const UTProductBase& product, const UTWrapper<UTRandomBase> & generator, unsigned long numberOfPaths, unsigned long numberOfThreads, bool bThrow)
+{
+	unique_ptr<UTValuationEngineBase> pValuationEngine(nullptr);
+
+	if (model.classTag() == "Black Sholes Dynamics Model")
+	{
+		pValuationEngine.reset(new UTValuationEngineMonteCarloBlackSholesDynamics(dynamic_cast<const UTModelBlackSholesDynamics&>(model), product, generator, numberOfPaths, numberOfThreads, 0.0, UT_ErrorType::UT_ABSOLUTE, nullptr, UT_PathConstruction::UT_INCREMENTAL, true));
+	}
+	else
+	{
+		if (bThrow)
+		{
+			throw runtime_error("UTValuationEngineFactory::The input model cannnot value the product by Monte Carlo.");
+
+		}
+
+	}
+
+	return pValuationEngine;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+unique_ptr<UTValuationEngineBase> UTValuationEngineFactory::newValuationEngineMonteCarloControlVariate(const UTModelBase& model, const UTProductBase& product, const shared_ptr<const UTProductBase>& controlProduct, const UTWrapper<UTRandomBase> & generator, unsigned long numberOfPaths, unsigned long numberOfThreads, bool bThrow)
+{
+	unique_ptr<UTValuationEngineBase> pValuationEngine(nullptr);
+
+	if (model.classTag() == "Black Sholes Dynamics Model")
+	{
+		pValuationEngine.reset(new UTValuationEngineMonteCarloBlackSholesDynamics(dynamic_cast<const UTModelBlackSholesDynamics&>(model), product, generator, numberOfPaths, numberOfThreads, 0.0, UT_ErrorType::UT_ABSOLUTE, controlProduct));
+	}
+	else
+	{
+		if (bThrow)
+		{
+			throw runtime_error("UTValuationEngineFactory::The input model cannnot value the product by Monte Carlo.");
+
+		}
+
+	}
+
+	return pValuationEngine;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+unique_ptr<UTValuationEngineBase> UTValuationEngineFactory::newValuationEngineMonteCarloControlVariate(const UTModelBase& model, const UTProductBase& product, const UTWrapper<UTRandomBase> & generator, unsigned long numberOfPaths, unsigned long numberOfThreads, bool bThrow)
+{
+	return newValuationEngineMonteCarloControlVariate(model, product, newControlVariate(product, bThrow), generator, numberOfPaths, numberOfThreads, bThrow);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+shared_ptr<const UTProductBase> UTValuationEngineFactory::newControlVariate(const UTProductBase& product, bool bThrow)
+{
+	shared_ptr<const UTProductBase> pControlProduct(nullptr);
+
+	if (product.classTag() == "Asian Option")
+	{
+		// The geometric Asian option on the same averaging dates has a closed form
+		const UTProductPathDependentAsian& asianOption = dynamic_cast<const UTProductPathDependentAsian&>(product);
+
+		pControlProduct = make_shared<UTProductPathDependentAsian>(
+			asianOption.averageStartTime(),
+			asianOption.expiryTime(),
+			asianOption.numberOfAverage(),
+			asianOption.notional(),
+			asianOption.callPut(),
+			asianOption.buySell(),
+			asianOption.strike(),
+			UT_AverageType::UT_GEOMETRIC);
+	}
+	else
+	{
+		if (bThrow)
+		{
+			throw runtime_error("UTValuationEngineFactory::The input product has no built-in control variate.");
+
+		}
+
+	}
+
+	return pControlProduct;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+unique_ptr<UTValuationEngineBase> UTValuationEngineFactory::newValuationEngineMonteCarloToTolerance(const UTModelBase& model, const UTProductBase& product, const UTWrapper<UTRandomBase> & generator, double targetError, UT_ErrorType errorType, unsigned long maxNumberOfPaths, unsigned long numberOfThreads, bool bThrow)
+{
+	unique_ptr<UTValuationEngineBase> pValuationEngine(nullptr);
+
+	if (model.classTag() == "Black Sholes Dynamics Model")
+	{
+		pValuationEngine.reset(new UTValuationEngineMonteCarloBlackSholesDynamics(dynamic_cast<const UTModelBlackSholesDynamics&>(model), product, generator, maxNumberOfPaths, numberOfThreads, targetError, errorType));
+	}
+	else
+	{
+		if (bThrow)
+		{
+			throw runtime_error("UTValuationEngineFactory::The input model cannnot value the product by Monte Carlo.");
+
+		}
+
+	}
+
+	return pValuationEngine;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 unique_ptr<UTValuationEngineBase> UTValuationEngineFactory::newValuationEngineAnalyticYieldCurve(const UTModelYieldCurve& model, const UTProductBase& product, bool bThrow)
@@ -119,6 +224,10 @@ unique_ptr<UTValuationEngineBase> UTValuationEngineFactory::newValuationEngineAn
 	{
 		pValuationEngine.reset(new UTValuationEngineAnalyticLinearBase(model, dynamic_cast<const UTProductEuropeanOptionStraddle&>(product)));
 	}
+	else if (product.classTag() == "Portfolio" || product.classTag() == "Strike Grid")
+	{
+		pValuationEngine.reset(new UTValuationEngineAnalyticLinearBase(model, dynamic_cast<const UTProductLinearBase&>(product)));
+	}
 	else if (product.classTag() == "Asian Option")
 	{
 		pValuationEngine.reset( new UTValuationEngineAnalyticBlackSholesDynamicsPathDependentAsianGeometric(model, dynamic_cast<const UTProductPathDependentAsian&>(product)));
@@ -10,6 +10,7 @@
 #include <memory>
 #include <vector>
 
+#include "UTEnum.hpp"
 #include "UTValuationEngine.hpp"
 #include "UTWrapper.hpp"
 
@@ -31,8 +32,24 @@ public:
 	// Analytic + BlackSholes Dynamics Model
 	static std::unique_ptr<UTValuationEngineBase> newValuationEngineAnalyticBlackSholesDynamics(const UTModelBlackSholesDynamics& model, const UTProductBase& product, bool bThrow = false);
 
-	// Generic Valuation Engine for Monte Carlo method
-	static std::unique_ptr<UTValuationEngineBase> newValuationEngineMonteCarlo(const UTModelBase& model, const UTProductBase& product, const UTWrapper<UTRandomBase> & generator, unsigned long numberOfPaths, bool bThrow = false);
+	// Generic Valuation Engine for Monte Carlo method (numberOfThreads = 0 means all the hardware threads).
+	// The number of threads and the path construction come after bThrow, so that the calls written before them keep their meaning.
+	static std::unique_ptr<UTValuationEngineBase> newValuationEngineMonteCarlo(const UTModelBase& model, const UTProductBase& product, const UTWrapper<UTRandomBase> & generator, unsigned long numberOfPaths, bool bThrow = false, unsigned long numberOfThreads = 1, UT_PathConstruction pathConstruction = UT_PathConstruction::UT_INCREMENTAL);
+
+	// Generic Valuation Engine for Monte Carlo method which also calculates the delta and the vega in the same pass (see UTValuationEngineMonteCarlo::calculateGreeks)
+	static std::unique_ptr<UTValuationEngineBase> newValuationEngineMonteCarloGreeks(const UTModelBase& model, const UTProductBase& product, const UTWrapper<UTRandomBase> & generator, unsigned long numberOfPaths, unsigned long numberOfThreads = 1, bool bThrow = false);
+
+	// Generic Valuation Engine for Monte Carlo method with a control variate (any product on the same time line which can be valued analytically)
+	static std::unique_ptr<UTValuationEngineBase> newValuationEngineMonteCarloControlVariate(const UTModelBase& model, const UTProductBase& product, const std::shared_ptr<const UTProductBase>& controlProduct, const UTWrapper<UTRandomBase> & generator, unsigned long numberOfPaths, unsigned long numberOfThreads = 1, bool bThrow = false);
+
+	// Generic Valuation Engine for Monte Carlo method with the built-in control variate of the product
+	static std::unique_ptr<UTValuationEngineBase> newValuationEngineMonteCarloControlVariate(const UTModelBase& model, const UTProductBase& product, const UTWrapper<UTRandomBase> & generator, unsigned long numberOfPaths, unsigned long numberOfThreads = 1, bool bThrow = false);
+
+	// The built-in control variate of the product (the geometric Asian for the Asian option), nullptr if there is none
+	static std::shared_ptr<const UTProductBase> newControlVariate(const UTProductBase& product, bool bThrow = false);
+
+	// Generic Valuation Engine for Monte Carlo method, which stops as soon as the standard error reaches targetError (maxNumberOfPaths is the path budget)
+	static std::unique_ptr<UTValuationEngineBase> newValuationEngineMonteCarloToTolerance(const UTModelBase& model, const UTProductBase& product, const UTWrapper<UTRandomBase> & generator, double targetError, UT_ErrorType errorType, unsigned long maxNumberOfPaths, unsigned long numberOfThreads = 1, bool bThrow = false);
 
 };
 
@@ -8,14 +8,41 @@
 #include "UTProductCashflow.hpp"
 #include "UTProductSwap.hpp"
 #include "UTProductEuropeanOption.hpp"
+#include "UTProductPortfolio.hpp"
 #include "UTRandomBase.hpp"
+#include "UTValuationEngineFactory.hpp"
 #include "UTModelYieldCurve.hpp"
 #include "UTModelBlackSholesDynamics.hpp"
 #include "UTEuropeanOptionLogNormal.hpp"
+#include "UTThreadPool.hpp"
+#include <algorithm>
+#include <thread>
+#include <istream>
+#include <ostream>
+#include <string>
 
 
 using namespace std;
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Static data.
+
+// The number of paths in one block of the simulation
+const unsigned long UTValuationEngineMonteCarlo::ourPathsPerBlock = 256;
+
+// The relative bump of the pathwise Greeks
+const double UTValuationEngineMonteCarlo::ourGreekBump = 1.0e-5;
+
+namespace
+{
+	// The Greeks calculated in the Monte Carlo pass
+	const unsigned long ourDelta = 0;
+	const unsigned long ourVega = 1;
+	const unsigned long ourGamma = 2;
+	const unsigned long ourNumberOfGreekStatistics = 6;  // delta, vega and gamma, pathwise and likelihood ratio
+}
+
 
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -25,53 +52,529 @@ UTValuationEngineMonteCarlo::UTValuationEngineMonteCarlo(
 	const UTModelBase & model,
 	const UTProductBase & product,
 	const UTWrapper<UTRandomBase> & generator,
-	unsigned long numberOfPaths )
+	unsigned long numberOfPaths,
+	unsigned long numberOfThreads,
+	const shared_ptr<const UTProductBase> & controlProduct,
+	bool calculateGreeks)
 	: UTValuationEngineBase(model),
 	myProductBase(product),
 	myGenerator(generator),
 	myNumberOfPaths(numberOfPaths),
-	myDf(product.cashflowPayTimes().size())
+	myNumberOfThreads(numberOfThreads),
+	myFirstPath(0),
+	myDf(product.cashflowPayTimes().size()),
+	myControlProduct(controlProduct),
+	myControlValue(0.0),
+	myPortfolio(nullptr)
 {
 
-	for (unsigned long i = 0; i < myDf.size(); ++i)
+	if (!myDf.empty())
 	{
-		myDf[i] = modelBase().df(myProductBase.cashflowPayTimes()[i]);
+		modelBase().df(&myProductBase.cashflowPayTimes()[0], &myDf[0], myDf.size());
+	}
+
+	if (myControlProduct)
+	{
+		// The control variate is valued on the same paths: it must observe the spot at the same times
+		if (myControlProduct->timeLine() != myProductBase.timeLine())
+		{
+			throw runtime_error("UTValuationEngineMonteCarlo: the control variate must have the same time line as the product.");
+		}
+
+		// Its analytic value
+		unique_ptr<UTValuationEngineBase> pricer(UTValuationEngineFactory::newValuationEngineAnalytic(model, *myControlProduct, true));
+		pricer->calculatePV(myControlValue);
+
+		myControlDf.resize(myControlProduct->cashflowPayTimes().size());
+		if (!myControlDf.empty())
+		{
+			modelBase().df(&myControlProduct->cashflowPayTimes()[0], &myControlDf[0], myControlDf.size());
+		}
+	}
+
+	// A portfolio (or a strike grid): each product has its own statistics
+	myPortfolio = dynamic_cast<const UTProductPortfolio*>(&myProductBase);
+	if (myPortfolio)
+	{
+		myProductStatistics.resize(myPortfolio->size());
+	}
+
+	if (calculateGreeks)
+	{
+		myGreekStatistics.resize(ourNumberOfGreekStatistics);
+	}
+
+	// Zero means "as many threads as the hardware supports"
+	if (myNumberOfThreads == 0)
+	{
+		myNumberOfThreads = thread::hardware_concurrency();
+		if (myNumberOfThreads == 0)
+			myNumberOfThreads = 1;
 	}
-	
-	myCashflows.resize(product.cashflowPayTimes().size());
 
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //return PV from one spot path
-double UTValuationEngineMonteCarlo::pvFromSinglePath(const vector<double> &spotValues) const
+double UTValuationEngineMonteCarlo::pvFromSinglePath(const UTProductBase & product, const vector<double> &df, const UTPathView &spotValues, vector<UTCashflows_t> &cashflows) const
 {
 	// Get the payoffs from spot prices
-	unsigned long numberOfFlows = myProductBase.payoffs(spotValues, myCashflows);
+	unsigned long numberOfFlows = product.payoffs(spotValues, cashflows);
 	double pv = 0.0;
 	for (unsigned i = 0; i < numberOfFlows; ++i)
 	{
-		pv += myCashflows[i].second * myDf[myCashflows[i].first];
+		pv += cashflows[i].second * df[cashflows[i].first];
 	}
 	return pv;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+double UTValuationEngineMonteCarlo::pathwiseDerivative(const UTPathView &spotValues, const vector<double> &tangents, UTWorkspace & workspace) const
+{
+	unsigned long numberOfTimes = spotValues.size();
+
+	double largestTangent = 0.0;
+	for (unsigned long i = 0; i < numberOfTimes; ++i)
+	{
+		if (fabs(tangents[i]) > largestTangent)
+			largestTangent = fabs(tangents[i]);
+	}
+
+	if (largestTangent == 0.0)
+	{
+		return 0.0;
+	}
+
+	// The path does not move, only the payoff is valued again on the bumped spots
+	const double bump = ourGreekBump / largestTangent;
+	vector<double> &bumpedSpots = workspace.bumpedSpots;
+
+	for (unsigned long i = 0; i < numberOfTimes; ++i)
+		bumpedSpots[i] = spotValues[i] * exp(bump * tangents[i]);
+	double pvUp = pvFromSinglePath(myProductBase, myDf, bumpedSpots, workspace.cashflows);
+
+	for (unsigned long i = 0; i < numberOfTimes; ++i)
+		bumpedSpots[i] = spotValues[i] * exp(-bump * tangents[i]);
+	double pvDown = pvFromSinglePath(myProductBase, myDf, bumpedSpots, workspace.cashflows);
+
+	return (pvUp - pvDown) / (2.0 * bump);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarlo::getLogPathDerivatives(const UTPathView &, vector<double> &, vector<double> &, double &, double &, double &) const
+{
+	throw runtime_error("UTValuationEngineMonteCarlo: the model of the engine cannot calculate the Greeks.");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+unsigned long UTValuationEngineMonteCarlo::greekIndex(unsigned long greek, UT_GreekMethod method)
+{
+	if (method == UT_GreekMethod::UT_PATHWISE)
+		return 2 * greek;
+	else if (method == UT_GreekMethod::UT_LIKELIHOOD_RATIO)
+		return 2 * greek + 1;
+
+	throw runtime_error("UTValuationEngineMonteCarlo: invalid Greek method.");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const UTStatisticsMonteCarlo & UTValuationEngineMonteCarlo::deltaStatistics(UT_GreekMethod method) const
+{
+	if (!hasGreeks())
+	{
+		throw runtime_error("UTValuationEngineMonteCarlo: the engine does not calculate the Greeks.");
+	}
+	return myGreekStatistics[greekIndex(ourDelta, method)];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const UTStatisticsMonteCarlo & UTValuationEngineMonteCarlo::vegaStatistics(UT_GreekMethod method) const
+{
+	if (!hasGreeks())
+	{
+		throw runtime_error("UTValuationEngineMonteCarlo: the engine does not calculate the Greeks.");
+	}
+	return myGreekStatistics[greekIndex(ourVega, method)];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const UTStatisticsMonteCarlo & UTValuationEngineMonteCarlo::gammaStatistics(UT_GreekMethod method) const
+{
+	if (!hasGreeks())
+	{
+		throw runtime_error("UTValuationEngineMonteCarlo: the engine does not calculate the Greeks.");
+	}
+	if (numberOfFixedTimes() > 0)
+	{
+		throw runtime_error("UTValuationEngineMonteCarlo: no gamma for a product with fixings at the spot date.");
+	}
+	return myGreekStatistics[greekIndex(ourGamma, method)];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarlo::mergeBlock(unsigned long blockIndex)
+{
+	myControlVariateStatistics.merge(myBlockStatistics[blockIndex]);
+
+	unsigned long numberOfProducts = myProductStatistics.size();
+	for (unsigned long k = 0; k < numberOfProducts; ++k)
+	{
+		myProductStatistics[k].merge(myBlockProductStatistics[blockIndex * numberOfProducts + k]);
+	}
+
+	unsigned long numberOfGreeks = myGreekStatistics.size();
+	for (unsigned long g = 0; g < numberOfGreeks; ++g)
+	{
+		myGreekStatistics[g].merge(myBlockGreekStatistics[blockIndex * numberOfGreeks + g]);
+	}
+
+	if (myControlProduct)
+	{
+		myStatistics = myControlVariateStatistics.controlledStatistics(myControlValue);
+	}
+	else
+	{
+		myStatistics = myControlVariateStatistics.uncontrolledStatistics();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarlo::resetStatistics()
+{
+	myStatistics.reset();
+	myControlVariateStatistics.reset();
+	for (unsigned long k = 0; k < myProductStatistics.size(); ++k)
+		myProductStatistics[k].reset();
+	for (unsigned long g = 0; g < myGreekStatistics.size(); ++g)
+		myGreekStatistics[g].reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarlo::prepareWorkspaces(unsigned long numberOfWorkspaces)
+{
+	if (myWorkspaces.size() < numberOfWorkspaces)
+		myWorkspaces.resize(numberOfWorkspaces);
+
+	unsigned long numberOfTimes = myProductBase.timeLine().size();
+	unsigned long numberOfFlows = myDf.size() > myControlDf.size() ? myDf.size() : myControlDf.size();
+
+	for (unsigned long t = 0; t < numberOfWorkspaces; ++t)
+	{
+		UTWorkspace& workspace = myWorkspaces[t];
+		if (!workspace.spotBlock.empty())
+			continue;
+
+		workspace.generator = myGenerator;
+		workspace.variates.resize(myGenerator->dimensionality());
+		workspace.spotBlock.resize(numberOfTimes * ourPathsPerBlock);
+		workspace.cashflows.resize(numberOfFlows);
+
+		if (hasGreeks())
+		{
+			workspace.deltaTangents.resize(numberOfTimes);
+			workspace.vegaTangents.resize(numberOfTimes);
+			workspace.fixedTangents.resize(numberOfTimes);
+			workspace.bumpedSpots.resize(numberOfTimes);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarlo::runBlocks(UTWorkspace & workspace, unsigned long firstBlock, unsigned long lastBlock, unsigned long blockIndex)
+{
+	// Move the own generator onto the first path of the range
+	UTRandomBase& generator = *workspace.generator;
+	generator.reset();
+	generator.skip(myFirstPath + firstBlock * ourPathsPerBlock);
+
+	unsigned long numberOfTimes = myProductBase.timeLine().size();
+	unsigned long numberOfProducts = myProductStatistics.size();
+	unsigned long numberOfGreeks = myGreekStatistics.size();
+	unsigned long numberOfFixed = numberOfGreeks > 0 ? numberOfFixedTimes() : 0;
+
+	for (unsigned long block = firstBlock; block < lastBlock; ++block)
+	{
+		unsigned long firstPath = myFirstPath + block * ourPathsPerBlock;
+		unsigned long numberOfPaths = firstPath + ourPathsPerBlock < myNumberOfPaths ? ourPathsPerBlock : myNumberOfPaths - firstPath;
+
+		getPathBlock(generator, numberOfPaths, workspace.variates, workspace.spotBlock);  //virtual function!! (once per block)
+
+		unsigned long index = blockIndex + block - firstBlock;
+		UTStatisticsMonteCarloControlVariate& statistics = myBlockStatistics[index];
+		UTStatisticsMonteCarlo* productStatistics = numberOfProducts > 0 ? &myBlockProductStatistics[index * numberOfProducts] : nullptr;
+		UTStatisticsMonteCarlo* greekStatistics = numberOfGreeks > 0 ? &myBlockGreekStatistics[index * numberOfGreeks] : nullptr;
+
+		statistics.reset();
+		for (unsigned long k = 0; k < numberOfProducts; ++k)
+			productStatistics[k].reset();
+		for (unsigned long g = 0; g < numberOfGreeks; ++g)
+			greekStatistics[g].reset();
+
+		for (unsigned long i = 0; i < numberOfPaths; ++i)
+		{
+			// The path i is the column i of the block
+			UTPathView spotPrices(&workspace.spotBlock[i], numberOfTimes, ourPathsPerBlock);
+
+			double pv = pvFromSinglePath(myProductBase, myDf, spotPrices, workspace.cashflows);
+
+			// Portfolio: the PV of each product from its range of the cashflows
+			for (unsigned long k = 0; k < numberOfProducts; ++k)
+			{
+				double productPv = 0.0;
+				for (unsigned long j = myPortfolio->cashflowOffset(k); j < myPortfolio->cashflowOffset(k + 1); ++j)
+					productPv += workspace.cashflows[j].second * myDf[workspace.cashflows[j].first];
+
+				productStatistics[k].addOneResult(productPv);
+			}
+
+			// Greeks on the same path: pathwise by valuing the payoff again along the tangents, likelihood ratio by weighting the PV with the scores
+			if (numberOfGreeks > 0)
+			{
+				double deltaScore = 0.0;
+				double vegaScore = 0.0;
+				double gammaScore = 0.0;
+				getLogPathDerivatives(spotPrices, workspace.deltaTangents, workspace.vegaTangents, deltaScore, vegaScore, gammaScore);
+
+				double pathwiseDelta = pathwiseDerivative(spotPrices, workspace.deltaTangents, workspace);
+
+				// The fixings at the spot itself are not random: the likelihood ratio delta takes their pathwise derivative
+				double fixedDelta = 0.0;
+				if (numberOfFixed > 0)
+				{
+					fill(workspace.fixedTangents.begin(), workspace.fixedTangents.end(), 0.0);
+					copy(workspace.deltaTangents.begin(), workspace.deltaTangents.begin() + numberOfFixed, workspace.fixedTangents.begin());
+					fixedDelta = pathwiseDerivative(spotPrices, workspace.fixedTangents, workspace);
+				}
+
+				// Lognormal paths: the pathwise delta is h(path) / spot, so its derivative to the spot is (score - 1 / spot) times itself,
+				// with 1 / spot the delta tangent (no gamma if there are fixings at the spot, see gammaStatistics)
+				double pathwiseGamma = numberOfFixed > 0 ? 0.0 : pathwiseDelta * (deltaScore - workspace.deltaTangents[0]);
+				double likelihoodRatioGamma = numberOfFixed > 0 ? 0.0 : pv * gammaScore;
+
+				greekStatistics[greekIndex(ourDelta, UT_GreekMethod::UT_PATHWISE)].addOneResult(pathwiseDelta);
+				greekStatistics[greekIndex(ourVega, UT_GreekMethod::UT_PATHWISE)].addOneResult(pathwiseDerivative(spotPrices, workspace.vegaTangents, workspace));
+				greekStatistics[greekIndex(ourGamma, UT_GreekMethod::UT_PATHWISE)].addOneResult(pathwiseGamma);
+				greekStatistics[greekIndex(ourDelta, UT_GreekMethod::UT_LIKELIHOOD_RATIO)].addOneResult(pv * deltaScore + fixedDelta);
+				greekStatistics[greekIndex(ourVega, UT_GreekMethod::UT_LIKELIHOOD_RATIO)].addOneResult(pv * vegaScore);
+				greekStatistics[greekIndex(ourGamma, UT_GreekMethod::UT_LIKELIHOOD_RATIO)].addOneResult(likelihoodRatioGamma);
+			}
+
+			double controlPv = myControlProduct ? pvFromSinglePath(*myControlProduct, myControlDf, spotPrices, workspace.cashflows) : 0.0;
+
+			statistics.addOneResult(pv, controlPv);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarlo::simulateBlocks(unsigned long firstBlock, unsigned long lastBlock)
+{
+	unsigned long numberOfBlocks = lastBlock - firstBlock;
+	myBlockStatistics.resize(numberOfBlocks);
+	myBlockProductStatistics.resize(numberOfBlocks * myProductStatistics.size());
+	myBlockGreekStatistics.resize(numberOfBlocks * myGreekStatistics.size());
+
+	// No point to have more threads than blocks
+	unsigned long numberOfThreads = myNumberOfThreads < numberOfBlocks ? myNumberOfThreads : numberOfBlocks;
+
+	prepareWorkspaces(numberOfThreads > 1 ? numberOfThreads : 1);
+
+	if (numberOfThreads <= 1)
+	{
+		runBlocks(myWorkspaces[0], firstBlock, lastBlock, 0);
+		return;
+	}
+
+	// Each task takes a contiguous range of blocks, with its own workspace. The tasks run on the threads of the pool, started once,
+	// and capture a pointer and a reference only, which std::function holds without allocating: the run allocates no memory.
+	struct UTBlocks
+	{
+		unsigned long first;
+		unsigned long number;
+		unsigned long numberOfTasks;
+	};
+	const UTBlocks blocks = { firstBlock, numberOfBlocks, numberOfThreads };
+
+	UTThreadPool::pool().run(numberOfThreads, [this, &blocks](unsigned long t)
+	{
+		unsigned long offset = blocks.number * t / blocks.numberOfTasks;
+		unsigned long size = blocks.number * (t + 1) / blocks.numberOfTasks - offset;
+
+		runBlocks(myWorkspaces[t], blocks.first + offset, blocks.first + offset + size, offset);
+	});
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void UTValuationEngineMonteCarlo::run()
 {
-	// temporary spot prices from one path
-	vector<double> spotPrices(myProductBase.timeLine().size());
+	unsigned long numberOfBlocks = (myNumberOfPaths + ourPathsPerBlock - 1) / ourPathsPerBlock;
+
+	myFirstPath = 0;
+	simulateBlocks(0, numberOfBlocks);
 
-	// Do the monte carlo simulation
-	double sum = 0.0;
-	for (unsigned i = 0; i < myNumberOfPaths; ++i)
+	// The reduction is always done in the block order
+	resetStatistics();
+	for (unsigned long block = 0; block < numberOfBlocks; ++block)
 	{
-		getSinglePath(spotPrices);  //virtual function!!
-		sum += pvFromSinglePath(spotPrices);
-		
+		mergeBlock(block);
 	}
 
-	myValue = sum / myNumberOfPaths;
+	myValue = myStatistics.mean();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarlo::runToTolerance(double targetError, UT_ErrorType errorType)
+{
+	unsigned long numberOfBlocks = (myNumberOfPaths + ourPathsPerBlock - 1) / ourPathsPerBlock;
+
+	// A few blocks per thread in each round (the blocks after the stopping point of the last round are wasted)
+	const unsigned long blocksPerRound = 4 * myNumberOfThreads;
+
+	myFirstPath = 0;
+	resetStatistics();
+	unsigned long firstBlock = 0;
+	while (firstBlock < numberOfBlocks)
+	{
+		unsigned long lastBlock = firstBlock + blocksPerRound < numberOfBlocks ? firstBlock + blocksPerRound : numberOfBlocks;
+
+		simulateBlocks(firstBlock, lastBlock);
+
+		// Merge in the block order and check the error after each block
+		for (unsigned long block = firstBlock; block < lastBlock; ++block)
+		{
+			mergeBlock(block - firstBlock);
+
+			if (myStatistics.numberOfSamples() > 1 && myStatistics.standardError(errorType) <= targetError)
+			{
+				myValue = myStatistics.mean();
+				return;
+			}
+		}
+
+		firstBlock = lastBlock;
+	}
+
+	// The path budget is used up before reaching the target error
+	myValue = myStatistics.mean();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarlo::runMore(unsigned long numberOfPaths)
+{
+	// The new blocks start after the paths already simulated
+	myFirstPath = numberOfSimulatedPaths();
+	myNumberOfPaths = myFirstPath + numberOfPaths;
+
+	unsigned long numberOfBlocks = (numberOfPaths + ourPathsPerBlock - 1) / ourPathsPerBlock;
+
+	simulateBlocks(0, numberOfBlocks);
+
+	for (unsigned long block = 0; block < numberOfBlocks; ++block)
+	{
+		mergeBlock(block);
+	}
+
+	myValue = myStatistics.mean();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The checkpoint: a header, then the statistics (see UTStatisticsMonteCarlo::save)
+
+namespace
+{
+	const unsigned long long ourCheckpointTag = 0x34304B4843434D55ULL;  // "UMCCHK04"
+
+	void writeCount(ostream& os, unsigned long long value)
+	{
+		os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	unsigned long long readCount(istream& is)
+	{
+		unsigned long long value = 0;
+		if (!is.read(reinterpret_cast<char*>(&value), sizeof(value)))
+		{
+			throw runtime_error("UTValuationEngineMonteCarlo: cannot read the checkpoint.");
+		}
+		return value;
+	}
+
+	void writeString(ostream& os, const string& value)
+	{
+		writeCount(os, value.size());
+		os.write(value.data(), value.size());
+	}
+
+	string readString(istream& is)
+	{
+		string value(readCount(is), ' ');
+		if (!value.empty() && !is.read(&value[0], value.size()))
+		{
+			throw runtime_error("UTValuationEngineMonteCarlo: cannot read the checkpoint.");
+		}
+		return value;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarlo::saveCheckpoint(ostream& os) const
+{
+	writeCount(os, ourCheckpointTag);
+	writeCount(os, myProductBase.timeLine().size());
+	writeCount(os, myControlProduct ? 1 : 0);
+	writeCount(os, myProductStatistics.size());
+	writeCount(os, myGreekStatistics.size());
+	writeString(os, myGenerator->classTag());
+	writeCount(os, myGenerator->seed());
+	writeCount(os, static_cast<unsigned long long>(pathConstruction()));
+
+	myControlVariateStatistics.save(os);
+	for (unsigned long k = 0; k < myProductStatistics.size(); ++k)
+		myProductStatistics[k].save(os);
+	for (unsigned long g = 0; g < myGreekStatistics.size(); ++g)
+		myGreekStatistics[g].save(os);
+
+	if (!os)
+	{
+		throw runtime_error("UTValuationEngineMonteCarlo: cannot write the checkpoint.");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarlo::loadCheckpoint(istream& is)
+{
+	if (readCount(is) != ourCheckpointTag)
+	{
+		throw runtime_error("UTValuationEngineMonteCarlo: the stream is not a Monte Carlo checkpoint.");
+	}
+
+	// The checkpoint must come from the same simulation
+	if (readCount(is) != myProductBase.timeLine().size() || readCount(is) != (myControlProduct ? 1ULL : 0ULL) || readCount(is) != myProductStatistics.size() || readCount(is) != myGreekStatistics.size())
+	{
+		throw runtime_error("UTValuationEngineMonteCarlo: the checkpoint does not match the product of the engine.");
+	}
+
+	// Its paths must be the first ones of the stream of the generator of the engine, which continues it
+	if (readString(is) != myGenerator->classTag() || readCount(is) != myGenerator->seed())
+	{
+		throw runtime_error("UTValuationEngineMonteCarlo: the checkpoint does not come from the same generator and seed.");
+	}
+
+	// and its paths must be built in the same way from them
+	if (readCount(is) != static_cast<unsigned long long>(pathConstruction()))
+	{
+		throw runtime_error("UTValuationEngineMonteCarlo: the checkpoint does not come from the same path construction.");
+	}
+
+	myControlVariateStatistics.load(is);
+	for (unsigned long k = 0; k < myProductStatistics.size(); ++k)
+		myProductStatistics[k].load(is);
+	for (unsigned long g = 0; g < myGreekStatistics.size(); ++g)
+		myGreekStatistics[g].load(is);
+
+	myStatistics = myControlProduct ? myControlVariateStatistics.controlledStatistics(myControlValue) : myControlVariateStatistics.uncontrolledStatistics();
+	myNumberOfPaths = numberOfSimulatedPaths();
+	myValue = myStatistics.mean();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -83,6 +586,24 @@ UTValuationEngineMonteCarlo::calculatePV(double& resultPv)
 	resultPv += myValue;
 
 }
+
+///////////////////////////////////////////////////////////////////////////////
+// Accumulates the Greeks of the current product
+void
+UTValuationEngineMonteCarlo::calculateGreeks(double& delta, double& vega, UT_GreekMethod method) const
+{
+	delta += deltaStatistics(method).mean();
+	vega += vegaStatistics(method).mean();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Accumulates the Greeks of the current product, with the gamma
+void
+UTValuationEngineMonteCarlo::calculateGreeks(double& delta, double& vega, double& gamma, UT_GreekMethod method) const
+{
+	calculateGreeks(delta, vega, method);
+	gamma += gammaStatistics(method).mean();
+}
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 //UTValuationEngineMonteCarloBlackSholesDynamics
@@ -91,49 +612,104 @@ UTValuationEngineMonteCarloBlackSholesDynamics::UTValuationEngineMonteCarloBlack
 	const UTModelBlackSholesDynamics & model,
 	const UTProductBase & product,
 	const UTWrapper<UTRandomBase> & numberGenerator,
-	unsigned long numberOfPaths )
-	: UTValuationEngineMonteCarlo(model, product, numberGenerator, numberOfPaths),
-	myModel(model)
+	unsigned long numberOfPaths,
+	unsigned long numberOfThreads,
+	double targetError,
+	UT_ErrorType errorType,
+	const shared_ptr<const UTProductBase> & controlProduct,
+	UT_PathConstruction pathConstruction,
+	bool calculateGreeks)
+	: UTValuationEngineMonteCarlo(model, product, numberGenerator, numberOfPaths, numberOfThreads, controlProduct, calculateGreeks),
+	myModel(model),
+	myPathConstruction(pathConstruction)
 {
+	// The paths are lognormal with the vols of the term structure: they would not price with the smile of a vol surface
+	if (model.volSurface())
+	{
+		throw runtime_error("UTValuationEngineMonteCarloBlackSholesDynamics: the paths do not follow the smile of the vol surface of the model.");
+	}
+
 	//A bit of house keeping
 	vector<double> times(product.timeLine());
 	myNumberOfTimes = times.size();
 	myDrifts.resize(myNumberOfTimes);
 	myStandardDeviations.resize(myNumberOfTimes);
-	myVariates.resize(myNumberOfTimes);
+	myVarianceVolDerivatives.resize(myNumberOfTimes);
 	generator()->resetDimensionality(myNumberOfTimes);
 
 
 
-	//Get the log drift and log variance from the model
-	double variance = myModel.logVariance(0.0, times[0]);
-	myStandardDeviations[0] = sqrt(variance);
-	myDrifts[0] = myModel.logDrift(0.0, times[0]);
+	//Get the log drifts and log standard deviations of all the steps from the model at once
+	myModel.logDriftsAndStandardDeviations(&times[0], &myDrifts[0], &myStandardDeviations[0], myNumberOfTimes);
 
+	myNumberOfFixedTimes = 0;
+	while (myNumberOfFixedTimes < myNumberOfTimes && myStandardDeviations[myNumberOfFixedTimes] == 0.0)
+		++myNumberOfFixedTimes;
+
+	myVarianceVolDerivatives[0] = myModel.logVarianceVolDerivative(0.0, times[0]);
 	for (unsigned long i = 1; i < myNumberOfTimes; ++i)
 	{
-		variance = myModel.logVariance(times[i-1], times[i]);
-		myStandardDeviations[i] = sqrt(variance);
-		myDrifts[i] = myModel.logDrift(times[i - 1], times[i]);
+		myVarianceVolDerivatives[i] = myModel.logVarianceVolDerivative(times[i - 1], times[i]);
 	}
 
 	//get the log of spot price from the model
 	myLogSpot = log(myModel.forwardPrice(0.0));
 
-	run();  // do the monter Carlo to calculate PV
+	//The Brownian bridge is built on the cumulative variances, so the paths have the same distribution as the incremental ones
+	if (myPathConstruction == UT_PathConstruction::UT_BROWNIAN_BRIDGE)
+	{
+		vector<double> cumulativeVariances(myNumberOfTimes);
+		myCumulativeDrifts.resize(myNumberOfTimes);
+
+		double cumulativeVariance = 0.0;
+		double cumulativeDrift = 0.0;
+		for (unsigned long i = 0; i < myNumberOfTimes; ++i)
+		{
+			cumulativeVariance += myStandardDeviations[i] * myStandardDeviations[i];
+			cumulativeDrift += myDrifts[i];
+			cumulativeVariances[i] = cumulativeVariance;
+			myCumulativeDrifts[i] = cumulativeDrift;
+		}
+
+		myBrownianBridge = UTBrownianBridge(cumulativeVariances);
+	}
+	else if (myPathConstruction != UT_PathConstruction::UT_INCREMENTAL)
+	{
+		throw runtime_error("UTValuationEngineMonteCarloBlackSholesDynamics: invalid path construction.");
+	}
+
+	// do the monter Carlo to calculate PV
+	if (targetError > 0.0)
+	{
+		runToTolerance(targetError, errorType);
+	}
+	else
+	{
+		run();
+	}
 
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void UTValuationEngineMonteCarloBlackSholesDynamics::getSinglePath(vector<double> &spotValues)
+void UTValuationEngineMonteCarloBlackSholesDynamics::getSinglePath(UTRandomBase& generator, vector<double> &variates, vector<double> &spotValues) const
 {
-	generator()->nextGaussianVector(myVariates);
+	generator.nextGaussianVector(variates);
+
+	if (myPathConstruction == UT_PathConstruction::UT_BROWNIAN_BRIDGE)
+	{
+		myBrownianBridge.buildPath(variates, spotValues);
+
+		for (unsigned i = 0; i < myNumberOfTimes; ++i)
+			spotValues[i] = exp(myLogSpot + myCumulativeDrifts[i] + spotValues[i]);
+
+		return;
+	}
 
 	double logSpot = myLogSpot;
 
 	for (unsigned i = 0; i < myNumberOfTimes; ++i)
 	{
-		logSpot += myDrifts[i] + myStandardDeviations[i] * myVariates[i];
+		logSpot += myDrifts[i] + myStandardDeviations[i] * variates[i];
 		spotValues[i] = exp(logSpot);
 
 	}
@@ -141,5 +717,113 @@ void UTValuationEngineMonteCarloBlackSholesDynamics::getSinglePath(vector<double
 	return;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarloBlackSholesDynamics::getPathBlock(UTRandomBase& generator, unsigned long numberOfPaths, vector<double> &variates, vector<double> &spotBlock) const
+{
+	if (myPathConstruction == UT_PathConstruction::UT_BROWNIAN_BRIDGE)
+	{
+		// Draw the variates path by path (the generator order is the same as getSinglePath).
+		// The i-th variate goes to the row of the time it defines, so the bridge can work in situ
+		for (unsigned long j = 0; j < numberOfPaths; ++j)
+		{
+			generator.nextGaussianVector(variates);
+
+			for (unsigned long i = 0; i < myNumberOfTimes; ++i)
+				spotBlock[myBrownianBridge.bridgeIndex(i) * ourPathsPerBlock + j] = variates[i];
+		}
+
+		myBrownianBridge.buildPathBlock(spotBlock, numberOfPaths, ourPathsPerBlock);
+
+		for (unsigned long i = 0; i < myNumberOfTimes; ++i)
+		{
+			double * row = &spotBlock[i * ourPathsPerBlock];
+			const double logForward = myLogSpot + myCumulativeDrifts[i];
+			for (unsigned long j = 0; j < numberOfPaths; ++j)
+				row[j] = exp(logForward + row[j]);
+		}
+
+		return;
+	}
+
+	// The variates of the whole block, already transposed (the generator order is the same as getSinglePath)
+	generator.nextGaussianBlock(numberOfPaths, spotBlock, ourPathsPerBlock);
+
+	// Log spot prices IN SITU: each time step is a loop across the paths, which can be vectorized
+	double * row = &spotBlock[0];
+	const double drift0 = myDrifts[0];
+	const double stdDev0 = myStandardDeviations[0];
+	for (unsigned long j = 0; j < numberOfPaths; ++j)
+		row[j] = myLogSpot + (drift0 + stdDev0 * row[j]);
+
+	for (unsigned long i = 1; i < myNumberOfTimes; ++i)
+	{
+		const double * previousRow = row;
+		row += ourPathsPerBlock;
+
+		const double drift = myDrifts[i];
+		const double stdDev = myStandardDeviations[i];
+		for (unsigned long j = 0; j < numberOfPaths; ++j)
+			row[j] = previousRow[j] + (drift + stdDev * row[j]);
+	}
+
+	// Finally the exponential of the whole block
+	for (unsigned long i = 0; i < myNumberOfTimes; ++i)
+	{
+		row = &spotBlock[i * ourPathsPerBlock];
+		for (unsigned long j = 0; j < numberOfPaths; ++j)
+			row[j] = exp(row[j]);
+	}
+
+	return;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UTValuationEngineMonteCarloBlackSholesDynamics::getLogPathDerivatives(const UTPathView &spotValues, vector<double> &deltaTangents, vector<double> &vegaTangents, double &deltaScore, double &vegaScore, double &gammaScore) const
+{
+	// The log increment of the step i is drift(i) + stdDev(i) * z(i), with z(i) independent standard normals whatever the path construction.
+	// With v(i) = stdDev(i)^2 and dv(i) its derivative to a parallel shift e of the vols (the drift moves by -dv(i) / 2):
+	//    d log spot(t) / d spot      = 1 / spot
+	//    d log spot(t) / d e         = sum over i <= t of dv(i) * (z(i) / (2 stdDev(i)) - 1/2)
+	//    d log density / d spot      = z(k) / (stdDev(k) * spot), k the first step with a variance
+	//    d log density / d e         = sum over i of dv(i) * ((z(i)^2 - 1) / (2 v(i)) - z(i) / (2 stdDev(i)))
+	//    d2 density / d spot2 / density = (z(k)^2 - 1) / (v(k) * spot^2) - z(k) / (stdDev(k) * spot^2)
+	// The steps with no variance (a time at 0) are deterministic and do not count.
+
+	const double spot = exp(myLogSpot);
+	double previousLogSpot = myLogSpot;
+	double vegaTangent = 0.0;
+	bool firstStep = true;
+
+	deltaScore = 0.0;
+	vegaScore = 0.0;
+	gammaScore = 0.0;
+
+	for (unsigned long i = 0; i < myNumberOfTimes; ++i)
+	{
+		double logSpot = log(spotValues[i]);
+		double stdDev = myStandardDeviations[i];
+
+		if (stdDev > 0.0)
+		{
+			double z = (logSpot - previousLogSpot - myDrifts[i]) / stdDev;
+			double dv = myVarianceVolDerivatives[i];
+
+			vegaTangent += dv * (0.5 * z / stdDev - 0.5);
+			vegaScore += dv * (0.5 * (z * z - 1.0) / (stdDev * stdDev) - 0.5 * z / stdDev);
+
+			if (firstStep)
+			{
+				deltaScore = z / (stdDev * spot);
+				gammaScore = ((z * z - 1.0) / stdDev - z) / (stdDev * spot * spot);
+				firstStep = false;
+			}
+		}
+
+		deltaTangents[i] = 1.0 / spot;
+		vegaTangents[i] = vegaTangent;
+		previousLogSpot = logSpot;
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
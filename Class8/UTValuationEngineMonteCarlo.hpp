@@ -7,13 +7,18 @@
 #ifndef UT_VALUATION_ENGINE_MONTE_CARLO_H
 #define UT_VALUATION_ENGINE_MONTE_CARLO_H
 
+#include <iosfwd>
 #include <memory>
 #include <vector>
 #include "UTWrapper.hpp"
 #include "UTValuationEngine.hpp"
+#include "UTStatisticsMonteCarlo.hpp"
+#include "UTPathView.hpp"
+#include "UTBrownianBridge.hpp"
 
 //forward declarations
 class UTProductBase;
+class UTProductPortfolio;
 class UTRandomBase;
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -33,17 +38,100 @@ public:
 		const UTModelBase & model,
 		const UTProductBase & product,
 		const UTWrapper<UTRandomBase> & generator,
-		unsigned long myNumberOfPaths );
+		unsigned long myNumberOfPaths,
+		unsigned long numberOfThreads = 1,
+		const std::shared_ptr<const UTProductBase> & controlProduct = nullptr,
+		bool calculateGreeks = false);
 
 
 	// Calculates the PV of the Product and accumulate it in the ResultPV object.
 	virtual void calculatePV(double& result);
 
-	// Calculate spot price path of single 
-	virtual void getSinglePath(std::vector<double> &spotValues) = 0;
+	// Calculates the delta and the vega (to a parallel shift of the vols) of the Product and accumulate them, and its gamma for the second form.
+	// They are calculated in the same pass as the PV, so the engine must be built with calculateGreeks.
+	void calculateGreeks(double& delta, double& vega, UT_GreekMethod method = UT_GreekMethod::UT_PATHWISE) const;
+	void calculateGreeks(double& delta, double& vega, double& gamma, UT_GreekMethod method = UT_GreekMethod::UT_PATHWISE) const;
 
+	// Calculate spot price path of single path.
+	// The generator and the variates workspace are given by the caller so that several paths can be simulated concurrently.
+	virtual void getSinglePath(UTRandomBase& generator, std::vector<double> &variates, std::vector<double> &spotValues) const = 0;
+
+	// Calculate spot prices of a block of numberOfPaths (<= ourPathsPerBlock) paths at once.
+	// The block is stored as structure of arrays: spotValues[timeIndex * ourPathsPerBlock + pathIndex], so the loops can be vectorized across the paths.
+	// variates is the workspace for the variates of one path.
+	virtual void getPathBlock(UTRandomBase& generator, unsigned long numberOfPaths, std::vector<double> &variates, std::vector<double> &spotBlock) const = 0;
+
+	// Greeks of one path: the derivatives of the log spots with respect to the spot and to a parallel shift of the vols (the pathwise tangents),
+	// the same derivatives of the log density of the path (the likelihood ratio scores), and the second derivative of the density
+	// with respect to the spot over the density (the gamma score).
+	// The model of the derived class must provide them to calculate the Greeks.
+	virtual void getLogPathDerivatives(const UTPathView &spotValues, std::vector<double> &deltaTangents, std::vector<double> &vegaTangents, double &deltaScore, double &vegaScore, double &gammaScore) const;
+
+	// The number of times at the start of the time line with no variance: their spots are the spot itself and not random,
+	// so the scores do not see them and the likelihood ratio delta adds their pathwise derivative.
+	virtual unsigned long numberOfFixedTimes() const { return 0; }
+
+	// How the paths are built from the variates (see UT_PathConstruction): the same generator gives other paths with another
+	// construction, so it is written in the checkpoints and checked when they are loaded.
+	virtual UT_PathConstruction pathConstruction() const { return UT_PathConstruction::UT_INCREMENTAL; }
+
+	// Do the simulation. The paths are split into blocks of ourPathsPerBlock paths and each of numberOfThreads tasks simulates a contiguous
+	// range of blocks, on the threads of UTThreadPool::pool() (so not from a task of that pool).
+	// The block statistics are merged in the block order, so the result does not depend on the number of threads.
+	// The paths are numbered from the reset() state of the generator. The workspaces are kept between the runs,
+	// so a run does not allocate any memory after the first one, serial or not.
 	void run();
 
+	// Do the simulation until the standard error of the given type reaches targetError, or numberOfPaths (the path budget) is used up.
+	// The error is checked after each block in the block order, so the stopping point does not depend on the number of threads either.
+	void runToTolerance(double targetError, UT_ErrorType errorType = UT_ErrorType::UT_ABSOLUTE);
+
+	// Simulate numberOfPaths more paths, continuing the same random stream after the paths already simulated, and merge them into the statistics.
+	// The statistics are the ones of a single run with all the paths (exactly when the paths already simulated are whole blocks).
+	void runMore(unsigned long numberOfPaths);
+
+	// Binary checkpoint of the simulation: the number of paths simulated (which is the position of the generator), the type and seed of the generator,
+	// the path construction and the statistics. A checkpoint is loaded into an engine with the same model, product, control variate, generator and
+	// path construction as the one which saved it (the generator type and seed and the path construction are checked), typically built with no path,
+	// before runMore() resumes the simulation.
+	void saveCheckpoint(std::ostream& os) const;
+	void loadCheckpoint(std::istream& is);
+
+	// Accessors
+	unsigned long numberOfPaths() const { return myNumberOfPaths; }
+	unsigned long numberOfSimulatedPaths() const { return myControlVariateStatistics.numberOfSamples(); }
+	unsigned long numberOfThreads() const { return myNumberOfThreads; }
+
+	// The statistics of the path PVs of the last run (mean, standard error, confidence interval...)
+	// With a control variate, these are the statistics of the controlled estimator.
+	const UTStatisticsMonteCarlo & statistics() const { return myStatistics; }
+
+	// The control variate: a product valued on the same paths, whose analytic value is known (nullptr if no control variate)
+	const std::shared_ptr<const UTProductBase> & controlProduct() const { return myControlProduct; }
+	double controlValue() const { return myControlValue; }
+
+	// The joint statistics of the product and the control variate (beta, uncontrolled statistics...)
+	const UTStatisticsMonteCarloControlVariate & controlVariateStatistics() const { return myControlVariateStatistics; }
+
+	// For a portfolio (UTProductPortfolio or UTProductStrikeGrid), the statistics of the PV of each product of the portfolio (empty otherwise).
+	// All the products are valued on the same paths; statistics() are the ones of the total.
+	const std::vector<UTStatisticsMonteCarlo> & productStatistics() const { return myProductStatistics; }
+
+	// The statistics of the path estimators of the Greeks (uncontrolled), if the engine calculates them.
+	bool hasGreeks() const { return !myGreekStatistics.empty(); }
+	const UTStatisticsMonteCarlo & deltaStatistics(UT_GreekMethod method = UT_GreekMethod::UT_PATHWISE) const;
+	const UTStatisticsMonteCarlo & vegaStatistics(UT_GreekMethod method = UT_GreekMethod::UT_PATHWISE) const;
+
+	// The gamma: pathwise is the pathwise delta of the path weighted by the score (the payoff may have kinks but no jumps),
+	// likelihood ratio is the PV weighted by the gamma score. Both need a variance before the first time (numberOfFixedTimes() == 0):
+	// the second derivative of a payoff on a fixing at the spot itself has no estimator on the path.
+	const UTStatisticsMonteCarlo & gammaStatistics(UT_GreekMethod method = UT_GreekMethod::UT_PATHWISE) const;
+
+	static const unsigned long ourPathsPerBlock;
+
+	// The relative bump of the pathwise Greeks: the payoff is valued on the path moved by ourGreekBump along the largest tangent.
+	static const double ourGreekBump;
+
 protected:
 
 	// Accessors from derived classes
@@ -52,18 +140,75 @@ protected:
 
 private:
 
-	double pvFromSinglePath(const std::vector<double> &spotValues) const;
+	// The workspace of one thread: its own copy of the generator and the buffers of one block
+	struct UTWorkspace
+	{
+		UTWrapper<UTRandomBase> generator;
+		std::vector<double> variates;
+		std::vector<double> spotBlock;
+		std::vector<UTCashflows_t> cashflows;
+
+		// Greeks only
+		std::vector<double> deltaTangents;
+		std::vector<double> vegaTangents;
+		std::vector<double> fixedTangents;
+		std::vector<double> bumpedSpots;
+	};
+
+	double pvFromSinglePath(const UTProductBase & product, const std::vector<double> &df, const UTPathView &spotValues, std::vector<UTCashflows_t> &cashflows) const;
+
+	// Pathwise derivative of the PV of one path along the tangents, by a central difference of the payoff on the same path.
+	double pathwiseDerivative(const UTPathView &spotValues, const std::vector<double> &tangents, UTWorkspace & workspace) const;
+
+	// Index of the statistics of a Greek in myGreekStatistics
+	static unsigned long greekIndex(unsigned long greek, UT_GreekMethod method);
+
+	// Reset the statistics of the estimator before a run
+	void resetStatistics();
+
+	// Merge the statistics of one block (its index in myBlockStatistics) and update the statistics of the estimator
+	void mergeBlock(unsigned long blockIndex);
+
+	// Allocate the workspaces of numberOfWorkspaces threads (only the first time)
+	void prepareWorkspaces(unsigned long numberOfWorkspaces);
+
+	// Simulate the blocks [firstBlock, lastBlock) in parallel into myBlockStatistics.
+	void simulateBlocks(unsigned long firstBlock, unsigned long lastBlock);
+
+	// Simulate the blocks [firstBlock, lastBlock) with the given workspace, whose generator is moved onto the first path of firstBlock.
+	// blockIndex is the index of the statistics of firstBlock in myBlockStatistics.
+	void runBlocks(UTWorkspace & workspace, unsigned long firstBlock, unsigned long lastBlock, unsigned long blockIndex);
 
 	const UTProductBase & myProductBase;
 	UTWrapper<UTRandomBase>  myGenerator;
 	unsigned long myNumberOfPaths;
+	unsigned long myNumberOfThreads;
+	unsigned long myFirstPath;  // the path of the first block of the current run
 	std::vector<double>myTimeLine;
 	std::vector<double>myDf;
 
-	mutable std::vector<UTCashflows_t>myCashflows;  //workspace
+	// Control variate
+	std::shared_ptr<const UTProductBase> myControlProduct;
+	double myControlValue;
+	std::vector<double>myControlDf;
 
-	// Calculated PV.
+	// Calculated PV and its statistics.
 	double                                          myValue;
+	UTStatisticsMonteCarlo                          myStatistics;
+	UTStatisticsMonteCarloControlVariate            myControlVariateStatistics;
+
+	// Portfolio: the statistics of each product
+	const UTProductPortfolio *                      myPortfolio;
+	std::vector<UTStatisticsMonteCarlo>             myProductStatistics;
+
+	// Greeks: the statistics of the path estimators [greekIndex] (empty if the Greeks are not calculated)
+	std::vector<UTStatisticsMonteCarlo>             myGreekStatistics;
+
+	// Workspaces (one per thread) and statistics of the blocks, kept between the runs
+	std::vector<UTWorkspace>                        myWorkspaces;
+	std::vector<UTStatisticsMonteCarloControlVariate> myBlockStatistics;
+	std::vector<UTStatisticsMonteCarlo>             myBlockProductStatistics;  // [blockIndex * number of products + product]
+	std::vector<UTStatisticsMonteCarlo>             myBlockGreekStatistics;    // [blockIndex * number of greek statistics + greekIndex]
 
 };
 
@@ -79,15 +224,33 @@ public:
 	// Destructor.
 	virtual ~UTValuationEngineMonteCarloBlackSholesDynamics() {};
 
-	// Constructor.
+	// Constructor. The model must not have a vol surface: the paths only follow its term structure of vols.
 	UTValuationEngineMonteCarloBlackSholesDynamics(
 		const UTModelBlackSholesDynamics & model,
 		const UTProductBase & product,
 		const UTWrapper<UTRandomBase> & generator,
-		unsigned long myNumberOfPaths);
+		unsigned long myNumberOfPaths,
+		unsigned long numberOfThreads = 1,
+		double targetError = 0.0,  // if positive, the simulation stops as soon as the standard error reaches it
+		UT_ErrorType errorType = UT_ErrorType::UT_ABSOLUTE,
+		const std::shared_ptr<const UTProductBase> & controlProduct = nullptr,
+		UT_PathConstruction pathConstruction = UT_PathConstruction::UT_INCREMENTAL,
+		bool calculateGreeks = false);
+
+	// Accessors
+	virtual UT_PathConstruction pathConstruction() const { return myPathConstruction; }
+
+	// Calculate spot price path of single path
+	virtual void getSinglePath(UTRandomBase& generator, std::vector<double> &variates, std::vector<double> &spotValues) const;
 
-	// Calculate spot price path of single 
-	virtual void getSinglePath(std::vector<double> &spotValues);
+	// Calculate spot prices of a block of paths
+	virtual void getPathBlock(UTRandomBase& generator, unsigned long numberOfPaths, std::vector<double> &variates, std::vector<double> &spotBlock) const;
+
+	// Greeks of one path from its normalised log increments
+	virtual void getLogPathDerivatives(const UTPathView &spotValues, std::vector<double> &deltaTangents, std::vector<double> &vegaTangents, double &deltaScore, double &vegaScore, double &gammaScore) const;
+
+	// The times at 0 at the start of the time line
+	virtual unsigned long numberOfFixedTimes() const { return myNumberOfFixedTimes; }
 
 protected:
 
@@ -100,7 +263,15 @@ private:
 	std::vector<double> myStandardDeviations;
 	double myLogSpot;
 	unsigned long myNumberOfTimes;
-	std::vector<double> myVariates;
+	unsigned long myNumberOfFixedTimes;
+
+	// Greeks: the derivatives of the variances of the time steps with respect to a parallel shift of the vols
+	std::vector<double> myVarianceVolDerivatives;
+
+	// Brownian bridge on the variance clock: log spot = log spot(0) + cumulative drift + W(cumulative variance)
+	UT_PathConstruction myPathConstruction;
+	UTBrownianBridge myBrownianBridge;
+	std::vector<double> myCumulativeDrifts;
 
 };
 ///////////////////////////////////////////////////////////////////////////////
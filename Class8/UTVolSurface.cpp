@@ -0,0 +1,145 @@
+/* UTVolSurface.cpp
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "UTVolSurface.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+//UTVolSurface
+//
+UTVolSurface::UTVolSurface(
+	const vector<double>&			expiries,
+	const vector<double>&			forwards,
+	const vector<vector<double> >&	logMoneyness,
+	const vector<vector<double> >&	totalVariances)
+	: myExpiries(expiries),
+	myForwards(forwards),
+	myFirstKnots(1, 0)
+{
+	const unsigned long numberOfExpiries = expiries.size();
+	if (numberOfExpiries == 0 || forwards.size() != numberOfExpiries || logMoneyness.size() != numberOfExpiries || totalVariances.size() != numberOfExpiries)
+	{
+		throw runtime_error("UTVolSurface: There should be one forward and one smile per expiry, and at least one expiry.");
+	}
+
+	for (unsigned long i = 0; i < numberOfExpiries; ++i)
+	{
+		if (expiries[i] <= (i > 0 ? expiries[i - 1] : 0.0))
+		{
+			throw runtime_error("UTVolSurface: The expiries should be positive and increasing.");
+		}
+
+		const vector<double>& knots = logMoneyness[i];
+		const vector<double>& variances = totalVariances[i];
+		if (knots.empty() || knots.size() != variances.size())
+		{
+			throw runtime_error("UTVolSurface: Each smile should have one total variance per knot, and at least one knot.");
+		}
+
+		for (unsigned long j = 0; j < knots.size(); ++j)
+		{
+			if (j > 0 && knots[j] <= knots[j - 1])
+			{
+				throw runtime_error("UTVolSurface: The log-moneyness of the knots should be increasing.");
+			}
+			if (!(variances[j] >= 0.0))
+			{
+				throw runtime_error("UTVolSurface: The total variances should be positive.");
+			}
+
+			myLogMoneyness.push_back(knots[j]);
+			myTotalVariances.push_back(variances[j]);
+			mySlopes.push_back(j + 1 < knots.size() ? (variances[j + 1] - variances[j]) / (knots[j + 1] - knots[j]) : 0.0);
+		}
+
+		myFirstKnots.push_back(myLogMoneyness.size());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTVolSurface::smileVariance(unsigned long expiry, double logMoneyness) const
+{
+	const double* first = myLogMoneyness.data() + myFirstKnots[expiry];
+	const double* last = myLogMoneyness.data() + myFirstKnots[expiry + 1];
+
+	// The last knot at or before the log-moneyness (the first one if none)
+	const double* knot = upper_bound(first, last, logMoneyness);
+	if (knot != first)
+		--knot;
+
+	unsigned long i = knot - myLogMoneyness.data();
+	double distance = logMoneyness - *knot;
+
+	return myTotalVariances[i] + (distance > 0.0 ? mySlopes[i] * distance : 0.0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTVolSurface::totalVariance(double logMoneyness, double time) const
+{
+	if (time <= 0.0)
+	{
+		return 0.0;
+	}
+
+	// The first expiry at or after the time
+	unsigned long i = lower_bound(myExpiries.begin(), myExpiries.end(), time) - myExpiries.begin();
+
+	// Flat vol before the first expiry and after the last one
+	if (i == 0)
+	{
+		return smileVariance(0, logMoneyness) * time / myExpiries[0];
+	}
+	if (i == myExpiries.size())
+	{
+		return smileVariance(i - 1, logMoneyness) * time / myExpiries[i - 1];
+	}
+
+	double weight = (time - myExpiries[i - 1]) / (myExpiries[i] - myExpiries[i - 1]);
+
+	return (1.0 - weight) * smileVariance(i - 1, logMoneyness) + weight * smileVariance(i, logMoneyness);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTVolSurface::vol(double strike, double time, double forward) const
+{
+	double logMoneyness = log(strike / forward);
+
+	// At the expiry, the limit of the flat vol before the first expiry
+	if (time <= 0.0)
+	{
+		return sqrt(smileVariance(0, logMoneyness) / myExpiries[0]);
+	}
+
+	return sqrt(totalVariance(logMoneyness, time) / time);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double UTVolSurface::vol(double strike, double time) const
+{
+	// The first expiry at or after the time
+	unsigned long i = lower_bound(myExpiries.begin(), myExpiries.end(), time) - myExpiries.begin();
+
+	// Flat vol before the first expiry and after the last one
+	if (i == 0 || i == myExpiries.size())
+	{
+		unsigned long expiry = i == 0 ? 0 : i - 1;
+		return sqrt(smileVariance(expiry, log(strike / myForwards[expiry])) / myExpiries[expiry]);
+	}
+
+	double weight = (time - myExpiries[i - 1]) / (myExpiries[i] - myExpiries[i - 1]);
+	double variance = (1.0 - weight) * smileVariance(i - 1, log(strike / myForwards[i - 1])) + weight * smileVariance(i, log(strike / myForwards[i]));
+
+	return sqrt(variance / time);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
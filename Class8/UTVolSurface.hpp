@@ -0,0 +1,73 @@
+/* UTVolSurface.h
+*
+* Copyright (c) 2016
+* Diva Analytics
+*/
+
+#ifndef UT_VOL_SURFACE_H
+#define UT_VOL_SURFACE_H
+
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// UTVolSurface
+//
+// An implied (lognormal) vol surface: the smile of each expiry is its total implied variance (sigma^2 T) at knots in
+// the log-moneyness log(K/F), linear between the knots and flat outside. Between the expiries, the total variance at the same
+// log-moneyness is linear in the time (flat vol before the first expiry and after the last one).
+// A lookup is two binary searches (expiry, then knot) and a few multiplications.
+//
+// The surface is immutable once built (see UTModelFactory::newVolSurface for the calibration to option quotes):
+// it is shared between the models and the threads with shared_ptr<const UTVolSurface>.
+//
+class UTVolSurface
+{
+public:
+
+	// Destructor.
+	~UTVolSurface() {}
+
+	// Constructor from the smiles: the expiries (positive and increasing), their forwards, and for each expiry
+	// the log-moneyness of the knots (increasing) and their total variances.
+	UTVolSurface(
+		const std::vector<double>&					expiries,
+		const std::vector<double>&					forwards,
+		const std::vector<std::vector<double> >&	logMoneyness,
+		const std::vector<std::vector<double> >&	totalVariances);
+
+	// The total implied variance sigma^2 T at the log-moneyness log(K/F) and the time
+	double totalVariance(double logMoneyness, double time) const;
+
+	// The implied vol of the strike at the time, for the forward of the time (the one of the model or of the pricer): the smile moves with it
+	double vol(double strike, double time, double forward) const;
+
+	// Sticky strike: the implied vol of the strike at the time, with each smile at the forward of its expiry, whatever the forward of the model.
+	// The vol of a strike does not move with the spot or the rates (as on the AAD tape of the engines, see UTModelBlackSholesDynamics::vol).
+	double vol(double strike, double time) const;
+
+	// Accessors.
+	const std::vector<double>& expiries() const { return myExpiries; }
+	const std::vector<double>& forwards() const { return myForwards; }
+	unsigned long numberOfKnots(unsigned long expiry) const { return myFirstKnots[expiry + 1] - myFirstKnots[expiry]; }
+
+private:
+
+	// The total variance of the smile of the expiry at the log-moneyness
+	double smileVariance(unsigned long expiry, double logMoneyness) const;
+
+	std::vector<double> myExpiries;
+	std::vector<double> myForwards;
+
+	// The knots of all the smiles one after the other: those of the expiry i are from myFirstKnots[i] to myFirstKnots[i + 1],
+	// with the slope of the total variance after each knot (0 after the last one)
+	std::vector<unsigned long> myFirstKnots;
+	std::vector<double> myLogMoneyness;
+	std::vector<double> myTotalVariances;
+	std::vector<double> mySlopes;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // UT_VOL_SURFACE_H